@@ -4,6 +4,7 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 #include "../helpers/overload.h"
 #include "assembly_emitter.h"
@@ -31,16 +32,22 @@ namespace AssemblyEmitter {
     }
 
     // Prints each instruction
-    void emitFromMovInstruction(AAst::MovInstruction& inst, std::ofstream& outputFile) {
-        outputFile << "\tmovq\t" << getOperandString(inst.toMove()) << ", " << getOperandString(inst.destination()) << "\n";
+    void emitFromMovInstruction(AAst::MovInstruction& inst, std::ostream& outputFile) {
+        outputFile << "\tmovl\t" << getOperandString(inst.toMove()) << ", " << getOperandString(inst.destination()) << "\n";
     }
 
-    void emitFromUnopInstruction(AAst::UnopInstruction& inst, std::ofstream& outputFile) {
+    void emitFromUnopInstruction(AAst::UnopInstruction& inst, std::ostream& outputFile) {
         outputFile << "\t" << AAst::unopStrings[inst.unop()] << "\t" << getOperandString(inst.operand()) << "\n";
     }
 
+    // The left operand is the source and the right is the destination, which is also the result
+    void emitFromBinopInstruction(AAst::BinopInstruction& inst, std::ostream& outputFile) {
+        outputFile << "\t" << AAst::binopStrings[inst.binop()] << "\t" << getOperandString(inst.left()) << ", "
+                   << getOperandString(inst.right()) << "\n";
+    }
+
     // Prints the instructions
-    void emitFromInstructions(const AAstInstructionList& instructions, std::ofstream& outputFile) {
+    void emitFromInstructions(const AAstInstructionList& instructions, std::ostream& outputFile) {
         // Interate over the list of instructions and emit the appropriate code.
         // If any fail, return false immediately
         for (const auto& inst : instructions) {
@@ -51,6 +58,16 @@ namespace AssemblyEmitter {
                 [&outputFile](AAst::UnopInstruction& inst) -> void {
                     emitFromUnopInstruction(inst, outputFile);
                 },
+                [&outputFile](AAst::BinopInstruction& inst) -> void {
+                    emitFromBinopInstruction(inst, outputFile);
+                },
+                [&outputFile](AAst::IdivInstruction& inst) -> void {
+                    // Divides edx:eax by the operand, leaving the quotient in eax and the remainder in edx
+                    outputFile << "\tidivl\t" << getOperandString(inst.operand()) << "\n";
+                },
+                [&outputFile](AAst::CdqInstruction& inst) -> void {
+                    outputFile << "\tcdq\n";
+                },
                 [&outputFile](AAst::StackallocInstruction& inst) -> void {
                     // Increment the stack pointer by the final size of the stack
                     outputFile << "\tsubq\t" << "$" << inst.stackSize() << ", %rsp\n";
@@ -71,9 +88,9 @@ namespace AssemblyEmitter {
     }
 
     // Prints the start and end of the function
-    void emitFromFunction(const AAst::Function& function, std::ofstream& outputFile) {
+    void emitFromFunction(const AAst::Function& function, const Sym::SymbolTable& symbols, std::ostream& outputFile) {
         // Print the function identifier
-        const std::string functionName {function.identifier()};
+        const std::string& functionName {symbols.name(function.identifier())};
         outputFile << "\t.globl " << functionName << "\n";
         outputFile << functionName << ":\n";
 
@@ -86,25 +103,32 @@ namespace AssemblyEmitter {
     }
 
     // Prints the start and end of the program to the assembly file
-    void emitFromProgram(AAst::Program& program, std::ofstream& outputFile) {
-        emitFromFunction(program.function(), outputFile);
+    void emitFromProgram(AAst::Program& program, const Sym::SymbolTable& symbols, std::ostream& outputFile) {
+        for (const auto& function : program.functions()) {
+            emitFromFunction(*function, symbols, outputFile);
+        }
 
         // line to ensure the stack is non-executable
-        outputFile << ".section .note.GNU-stack,\"\",@progbits";
+        outputFile << ".section .note.GNU-stack,\"\",@progbits\n";
     }
 
 
     // Loops over an assembly AST and uses it to generate an executable file of assembly code
-    bool emitAssembly(AAst::Program& program, FilePath& filepath) {
+    bool emitAssembly(AAst::Program& program, const Sym::SymbolTable& symbols, FilePath& filepath) {
         // Create outputFile
         std::ofstream outputFile {filepath};
         if (!outputFile) {
-            std::cout << "failed to create assembly file at " << filepath << "\n";
-            return false;
+            throw std::runtime_error("failed to create assembly file at " + filepath.string() + "\n");
         }
 
         // Entry point for tree traversal
-        emitFromProgram(program, outputFile);
+        emitFromProgram(program, symbols, outputFile);
         return true;
     }
+
+    std::string emitAssemblyText(AAst::Program& program, const Sym::SymbolTable& symbols) {
+        std::ostringstream output;
+        emitFromProgram(program, symbols, output);
+        return std::move(output).str();
+    }
 }
\ No newline at end of file
@@ -5,6 +5,7 @@
 #ifndef DCC_ASSEMBLY_EMITTER_H
 #define DCC_ASSEMBLY_EMITTER_H
 #include <filesystem>
+#include <ostream>
 
 #include "../assembly_generator/assembly_ast.h"
 
@@ -15,20 +16,26 @@ namespace AssemblyEmitter {
     std::string getOperandString(AAst::Operand& op);
 
     // Prints each instruction
-    void emitFromMovInstruction(AAst::MovInstruction& inst, std::ofstream& outputFile);
+    void emitFromMovInstruction(AAst::MovInstruction& inst, std::ostream& outputFile);
 
-    void emitFromUnopInstruction(AAst::UnopInstruction& inst, std::ofstream& outputFile);
+    void emitFromUnopInstruction(AAst::UnopInstruction& inst, std::ostream& outputFile);
+
+    void emitFromBinopInstruction(AAst::BinopInstruction& inst, std::ostream& outputFile);
 
     // Prints the instructions
-    void emitFromInstructions(const AAstInstructionList& instructions, std::ofstream& outputFile);
+    void emitFromInstructions(const AAstInstructionList& instructions, std::ostream& outputFile);
 
     // Prints the start and end of the function
-    void emitFromFunction(const AAst::Function& function, std::ofstream& outputFile);
+    void emitFromFunction(const AAst::Function& function, const Sym::SymbolTable& symbols, std::ostream& outputFile);
 
     // Prints the start and end of the program to the assembly file
-    void emitFromProgram(AAst::Program& program, std::ofstream& outputFile);
+    void emitFromProgram(AAst::Program& program, const Sym::SymbolTable& symbols, std::ostream& outputFile);
 
     // Loops over an assembly AST and uses it to generate an executable file of assembly code
-    bool emitAssembly(AAst::Program& program, FilePath& filepath);
+    // Throws std::runtime_error if the file cannot be created
+    bool emitAssembly(AAst::Program& program, const Sym::SymbolTable& symbols, FilePath& filepath);
+
+    // Returns the assembly as text, for piping straight into the assembler without writing a .s file
+    std::string emitAssemblyText(AAst::Program& program, const Sym::SymbolTable& symbols);
 }
 #endif //DCC_ASSEMBLY_EMITTER_H
\ No newline at end of file
@@ -11,6 +11,8 @@
 #include <variant>
 #include <cmath>
 
+#include "../helpers/symbol_table.h"
+
 namespace AAst {
 	enum NodeType {
 		AstT,
@@ -46,7 +48,7 @@ namespace AAst {
 		R11,
 		max_register_count
 	};
-	constexpr std::array<std::string, max_register_count> registerStrings{"eax","edx","r10d","r11"};
+	constexpr std::array<std::string, max_register_count> registerStrings{"eax","edx","r10d","r11d"};
 	constexpr std::array<Register, max_register_count> registers{AX, DX, R10, R11};
 	static_assert(std::size(registerStrings) == max_register_count
 		&& "Register enum and registerStrings are different sizes");
@@ -132,15 +134,16 @@ namespace AAst {
 	};
 
 	// Placeholder for an address relative to the base pointer
+	// Identified by the interned name of the variable it stands in for
 	class PseudoOperand : public Ast {
-		std::string m_pseudoAddress;
+		Sym::SymbolId m_pseudoAddress;
 	public:
 		PseudoOperand() = delete;
-		PseudoOperand(const std::string& pseudoAddress)
+		PseudoOperand(Sym::SymbolId pseudoAddress)
 			: m_pseudoAddress{pseudoAddress}
 		{}
 
-		const std::string& pseudoAddress() const { return m_pseudoAddress; }
+		Sym::SymbolId pseudoAddress() const { return m_pseudoAddress; }
 	};
 
 	// Operand to show the offset of an address from the base pointer
@@ -268,34 +271,40 @@ namespace AAst {
 
 	// Container for pointer to identifier and pointer to list of pointers to instructions
 	class Function : public Ast {
-		std::string m_identifier;
+		Sym::SymbolId m_identifier;
 		InstructionList m_instructions;
+		// Bytes of stack frame, known once pseudoregisters have been replaced
+		int m_stackSize {0};
 	public:
-		Function(const std::string& identifier, InstructionList&& instructions)
+		Function(Sym::SymbolId identifier, InstructionList&& instructions)
 			: m_identifier{identifier}
 			, m_instructions{std::move(instructions)}
 		{}
 
-		const std::string& identifier() const { return m_identifier; }
+		Sym::SymbolId identifier() const { return m_identifier; }
 		InstructionList& instructions() { return m_instructions; }
 		const InstructionList& instructions() const { return m_instructions; }
 
 		void setInstructions(InstructionList&& instructions) { m_instructions = std::move(instructions); }
+
+		int stackSize() const { return m_stackSize; }
+		void setStackSize(int stackSize) { m_stackSize = stackSize; }
 	};
 
 	///////////////
 	/// Program ///
 	///////////////
 
-	// Container for pointer to function
+	// Container for pointers to the functions, in source order
 	class Program : public Ast {
-		std::unique_ptr<Function> m_function;
+		std::vector<std::unique_ptr<Function>> m_functions;
 	public:
-		Program(std::unique_ptr<Function>&& a_function)
-			: m_function{std::move(a_function)}
+		Program(std::vector<std::unique_ptr<Function>>&& functions)
+			: m_functions{std::move(functions)}
 		{}
 
-		Function& function() { return *m_function; }
+		std::vector<std::unique_ptr<Function>>& functions() { return m_functions; }
+		const std::vector<std::unique_ptr<Function>>& functions() const { return m_functions; }
 	};
 }
 #endif //DCC_ASSEMBLY_AST_H
\ No newline at end of file
@@ -1,8 +1,6 @@
 //
 // Created by dunca on 02/11/2025.
 //
-#include <unordered_map>
-
 #include "assembly_generator.h"
 #include "../lexer/tokens.h"
 #include "../tacky/tacky.h"
@@ -27,15 +25,7 @@ namespace AAstGen {
                 return AAst::ImmOperand{ops.constant()};
             }
             else if constexpr (std::is_same_v<T, Tky::VariableValue>) {
-                // Work out if the string matches a register
-                auto regStrPtr {std::find(AAst::registerStrings.begin(),
-                                                  AAst::registerStrings.end(), ops.variable())};
-                if (regStrPtr != AAst::registerStrings.end()) {
-                    auto index {regStrPtr - AAst::registerStrings.begin()};
-                    return AAst::RegisterOperand{AAst::registers[index]};
-                } else {
-                    return AAst::PseudoOperand{ops.variable()};
-                }
+                return AAst::PseudoOperand{ops.variable()};
             }
         };
 
@@ -43,32 +33,25 @@ namespace AAstGen {
     }
 
     AAst::Unop generateUnop(const Tky::Unop& unop) {
-        // Go through the possible Unary operator strings and return the right object
-        const std::string& unopString {unop.unop()};
-        if (unopString == Token::bitwisenotString) {
-            return AAst::NotUnop;
-        }
-        else if (unopString == Token::negateString) {
-            return AAst::NegUnop;
+        switch (unop.unop()) {
+            case Token::Unop::Complement: return AAst::NotUnop;
+            case Token::Unop::Negate: return AAst::NegUnop;
         }
 
-        throw std::runtime_error("Invalid unop in generateUnop: " + unopString);
+        throw std::runtime_error("Invalid unop in generateUnop: " + std::to_string(static_cast<int>(unop.unop())));
     }
 
     AAst::Binop generateBinop(const Tky::Binop& binop) {
-        using namespace Token;
-        const std::string& binopString {binop.binop()};
-        if (binopString == addString) {
-            return AAst::AddBinop;
-        }
-        else if (binopString == negateString) {
-            return AAst::SubBinop;
-        }
-        else if (binopString == multiplyString) {
-            return AAst::MultiplyBinop;
+        // Divide and Remainder go through idiv instead, so have no Binop of their own
+        switch (binop.binop()) {
+            case Token::Binop::Add: return AAst::AddBinop;
+            case Token::Binop::Subtract: return AAst::SubBinop;
+            case Token::Binop::Multiply: return AAst::MultiplyBinop;
+            case Token::Binop::Divide:
+            case Token::Binop::Remainder: break;
         }
 
-        throw std::runtime_error("Invalid binop in generateBinop: " + binopString);
+        throw std::runtime_error("Invalid binop in generateBinop: " + std::to_string(static_cast<int>(binop.binop())));
     }
 
     // Create unique pointer to a Retinstruction
@@ -108,6 +91,18 @@ namespace AAstGen {
         return std::make_unique<AAst::Instruction>(std::move(movInst));
     }
 
+    // Move a value into a specific hardware register
+    std::unique_ptr<AAst::Instruction> generateMovInstruction(const Tky::Value& src, AAst::Register dst) {
+        AAst::MovInstruction movInst {generateOperand(src), AAst::RegisterOperand{dst}};
+        return std::make_unique<AAst::Instruction>(std::move(movInst));
+    }
+
+    // Move a specific hardware register's value out into dst
+    std::unique_ptr<AAst::Instruction> generateMovInstruction(AAst::Register src, const Tky::Value& dst) {
+        AAst::MovInstruction movInst {AAst::RegisterOperand{src}, generateOperand(dst)};
+        return std::make_unique<AAst::Instruction>(std::move(movInst));
+    }
+
     std::unique_ptr<AAst::Instruction> generateUnopInstruction(const Tky::Unop& unop, const Tky::Value& dst) {
         // Construct the unique pointer to the unary operator and the target register
         AAst::Unop unaryOperator {generateUnop(unop)};
@@ -137,35 +132,32 @@ namespace AAstGen {
                 },
                 [&finalInstructions](Tky::BinaryInstruction& inst) {
                     // Work out if it's divide/ modulo or if its add/subtract/multiply
-                    using namespace Token;
-
-                    const std::string& binop {inst.binop().binop()};
-                    Tky::VariableValue registerEax {AAst::registerStrings[AAst::AX]};
+                    Token::Binop binop {inst.binop().binop()};
 
                     // If the binary operator needs to use the idiv command
-                    if (binop == divideString || binop == moduloString) {
+                    if (binop == Token::Binop::Divide || binop == Token::Binop::Remainder) {
                         // Move the dividend into EAX
-                        finalInstructions.push_back(generateMovInstruction(inst.src1(), registerEax));
+                        finalInstructions.push_back(generateMovInstruction(inst.src1(), AAst::AX));
                         // Sign extend the dividend
                         finalInstructions.push_back(generateCdqInstruction());
                         finalInstructions.push_back(generateIdivInstruction(inst.src2()));
 
-                        if (binop == divideString) {
-                            finalInstructions.push_back(generateMovInstruction(inst.src2(), registerEax));
+                        // idiv leaves the quotient in EAX and the remainder in EDX
+                        if (binop == Token::Binop::Divide) {
+                            finalInstructions.push_back(generateMovInstruction(AAst::AX, inst.dst()));
                         }
                         else {
-                            Tky::VariableValue registerEdx {AAst::registerStrings[AAst::DX]};
-                            finalInstructions.push_back(generateMovInstruction(inst.src2(), registerEdx));
+                            finalInstructions.push_back(generateMovInstruction(AAst::DX, inst.dst()));
                         }
                     }
                     else {
+                        // The instruction works in place on its destination, so that starts off as the left value
                         finalInstructions.push_back(generateMovInstruction(inst.src1(), inst.dst()));
-                        finalInstructions.push_back(generateBinopInstruction(inst.binop(), inst.src1(), inst.dst()));
+                        finalInstructions.push_back(generateBinopInstruction(inst.binop(), inst.src2(), inst.dst()));
                     }
                 },
                 [&finalInstructions](Tky::ReturnInstruction& inst) {
-                    Tky::VariableValue registerDst {AAst::registerStrings[AAst::AX]};
-                    finalInstructions.push_back(generateMovInstruction(inst.value(), registerDst));
+                    finalInstructions.push_back(generateMovInstruction(inst.value(), AAst::AX));
                     finalInstructions.push_back(generateRetInstruction());
                 }
             }, *instruction);
@@ -175,7 +167,7 @@ namespace AAstGen {
 
     // Parses functions by looking at the identifier and the accompanying list of instructions
     std::unique_ptr<AAst::Function> generateFunction(const Tky::Function& function) {
-        const std::string& identifier {function.identifier()};
+        Sym::SymbolId identifier {function.identifier()};
 
         // Construct the list of instructions from the contained statement
         AAstInstructionList instructionList {generateInstructionList(function.instructions())};
@@ -183,30 +175,19 @@ namespace AAstGen {
     }
 
     AAst::Program generateProgram(Tky::Program& program) {
-        AAst::Program tmp {generateFunction(program.function())};
-        return tmp;
+        std::vector<std::unique_ptr<AAst::Function>> functions;
+        functions.reserve(program.functions().size());
+        for (const auto& function : program.functions()) {
+            functions.push_back(generateFunction(*function));
+        }
+        return AAst::Program{std::move(functions)};
     }
 
     ///////////////////////////////
     /// Replace Pseudoregisters ///
     ///////////////////////////////
     /// Second compiler pass to replace all pseudoregister nodes with stack nodes
-    /// An unordered_map is used to track what pseudoregister values map to stack values
-
-    using PrToOffsetMap = std::unordered_map<std::string_view, int>;
-
-    // Gets the latest stack offset
-    // if no argument is given, defaults to just returning the current value of the offset
-    int getStackOffset(int offset) {
-        static int stackOffset {0};
-        if (offset >= 0) {
-            return stackOffset;
-        }
-        else {
-            stackOffset += offset;
-            return stackOffset;
-        }
-    }
+    /// Pseudoregisters are SymbolIds, so a vector indexed by them tracks what stack value each maps to
 
     bool isPseudoOperand(AAst::Operand& operand) {
         return std::holds_alternative<AAst::PseudoOperand>(operand);
@@ -216,23 +197,22 @@ namespace AAstGen {
     // that operand.
     template<typename Ti>
     void replacePseudoOperand(Ti& inst, AAst::Operand& (Ti::*getter)(), void (Ti::*setter)(AAst::Operand),
-                               PrToOffsetMap& prToStackOffset) {
+                               PrToOffsetMap& prToStackOffset, Ctx::CompilationContext& context) {
         AAst::Operand& op {(inst.*getter)()};
         if (isPseudoOperand(op)) {
             // Determine if the pseudoOperand has been recorded in the map
+            // Stack offsets are always negative, so 0 marks a pseudoregister that has not been given one yet
             AAst::PseudoOperand& pseudoOp {std::get<AAst::PseudoOperand>(op)};
-            auto pseudoAddressPos {prToStackOffset.find(pseudoOp.pseudoAddress())};
-
-            int stackOffsetValue;
-            // If it has, get the value from the map
-            if (pseudoAddressPos != prToStackOffset.end()) {
-                stackOffsetValue = pseudoAddressPos->second;
+            Sym::SymbolId pseudoAddress {pseudoOp.pseudoAddress()};
+            if (pseudoAddress >= prToStackOffset.offsets.size()) {
+                prToStackOffset.offsets.resize(pseudoAddress + 1, 0);
             }
-            // If it has not, update the latest stackoffset and create a new entry in the map
-            else {
-                int stackOffset {getStackOffset(-4)};
-                prToStackOffset[pseudoOp.pseudoAddress()] = stackOffset;
-                stackOffsetValue = stackOffset;
+
+            int& stackOffsetValue {prToStackOffset.offsets[pseudoAddress]};
+            // If it has not, take the next stack offset and record it
+            if (stackOffsetValue == 0) {
+                stackOffsetValue = context.allocateStack(4);
+                prToStackOffset.assigned.push_back(pseudoAddress);
             }
 
             AAst::StackOperand stackOffsetOp {stackOffsetValue};
@@ -240,48 +220,48 @@ namespace AAstGen {
         }
     }
 
-    void findAndReplacePseudoOperands(AAst::Program& program) {
-        PrToOffsetMap prToStackOffset;
-        AAstInstructionList& mainInstructionList{program.function().instructions()};
-        for (auto& instruction : mainInstructionList) {
+    void findAndReplacePseudoOperands(AAst::Function& function, PrToOffsetMap& prToStackOffset,
+                                      Ctx::CompilationContext& context) {
+        context.beginFunction();
+        for (auto& instruction : function.instructions()) {
             // Check if the instruction type can contain a pseudooperand
             // If it can, send it to the relevant subfunction
             std::visit(Ol::overloaded{
-                [&prToStackOffset](AAst::MovInstruction& inst) -> void {
+                [&prToStackOffset, &context](AAst::MovInstruction& inst) -> void {
                     using AAst::MovInstruction;
 
                     auto toMoveG {&MovInstruction::toMove};
                     auto toMoveS {&MovInstruction::setToMove};
-                    replacePseudoOperand(inst, toMoveG, toMoveS, prToStackOffset);
+                    replacePseudoOperand(inst, toMoveG, toMoveS, prToStackOffset, context);
 
                     auto destinationG {&MovInstruction::destination};
                     auto destinationS {&MovInstruction::setDestination};
-                    replacePseudoOperand(inst, destinationG, destinationS, prToStackOffset);
+                    replacePseudoOperand(inst, destinationG, destinationS, prToStackOffset, context);
                 },
-                [&prToStackOffset](AAst::UnopInstruction& inst) -> void {
+                [&prToStackOffset, &context](AAst::UnopInstruction& inst) -> void {
                     using AAst::UnopInstruction;
 
                     auto operandG {&UnopInstruction::operand};
                     auto operandS {&UnopInstruction::setOperand};
-                    replacePseudoOperand(inst, operandG, operandS, prToStackOffset);
+                    replacePseudoOperand(inst, operandG, operandS, prToStackOffset, context);
                 },
-                [&prToStackOffset](AAst::BinopInstruction& inst) -> void {
+                [&prToStackOffset, &context](AAst::BinopInstruction& inst) -> void {
                     using AAst::BinopInstruction;
 
                     auto leftG {&BinopInstruction::left};
                     auto leftS {&BinopInstruction::setLeft};
-                    replacePseudoOperand(inst, leftG, leftS, prToStackOffset);
+                    replacePseudoOperand(inst, leftG, leftS, prToStackOffset, context);
 
                     auto rightG {&BinopInstruction::right};
                     auto rightS {&BinopInstruction::setRight};
-                    replacePseudoOperand(inst, rightG, rightS, prToStackOffset);
+                    replacePseudoOperand(inst, rightG, rightS, prToStackOffset, context);
                 },
-                [&prToStackOffset](AAst::IdivInstruction& inst) -> void {
+                [&prToStackOffset, &context](AAst::IdivInstruction& inst) -> void {
                     using AAst::IdivInstruction;
 
                     auto operandG {&IdivInstruction::operand};
                     auto operandS {&IdivInstruction::setOperand};
-                    replacePseudoOperand(inst, operandG, operandS, prToStackOffset);
+                    replacePseudoOperand(inst, operandG, operandS, prToStackOffset, context);
                 },
                 [](AAst::CdqInstruction& inst) -> void {
                     // CdqInstructions do not contain pseudoregisters
@@ -294,6 +274,15 @@ namespace AAstGen {
                 }}, *instruction
             );
         }
+        function.setStackSize(context.stackSize());
+        prToStackOffset.clear();
+    }
+
+    void findAndReplacePseudoOperands(AAst::Program& program, Ctx::CompilationContext& context) {
+        PrToOffsetMap prToStackOffset;
+        for (auto& function : program.functions()) {
+            findAndReplacePseudoOperands(*function, prToStackOffset, context);
+        }
     }
 
     //////////////////////////////////////
@@ -302,21 +291,41 @@ namespace AAstGen {
     /// Add instructions to set the stack size and rewrite Mov instrutcions
     /// Mov instructions cannot have a src and dst as stack offsets, so intermediate steps must be added with registers
 
+    bool isStackOperand(AAst::Operand& operand) {
+        return std::holds_alternative<AAst::StackOperand>(operand);
+    }
+
     bool needsRegisterStep(AAst::Instruction& inst) {
         return std::holds_alternative<AAst::MovInstruction>(inst)
-                && std::holds_alternative<AAst::StackOperand>(std::get<AAst::MovInstruction>(inst).toMove())
-                && std::holds_alternative<AAst::StackOperand>(std::get<AAst::MovInstruction>(inst).destination());
+                && isStackOperand(std::get<AAst::MovInstruction>(inst).toMove())
+                && isStackOperand(std::get<AAst::MovInstruction>(inst).destination());
     }
 
-    void getStackSizeAndAddMovRegisters(AAst::Program& program) {
-        // Iterate over the instructions to find out how many new mov instructions need to be added
+    // How many instructions have to be added to make inst one the processor accepts
+    // Only one side of mov, add and sub may be in memory, idiv cannot take an immediate, and imul cannot write to memory
+    int registerStepsNeeded(AAst::Instruction& inst) {
+        if (needsRegisterStep(inst)) {
+            return 1;
+        }
+        if (auto* idiv {std::get_if<AAst::IdivInstruction>(&inst)}) {
+            return std::holds_alternative<AAst::ImmOperand>(idiv->operand()) ? 1 : 0;
+        }
+        if (auto* binop {std::get_if<AAst::BinopInstruction>(&inst)}) {
+            if (binop->binop() == AAst::MultiplyBinop) {
+                return isStackOperand(binop->right()) ? 2 : 0;
+            }
+            return isStackOperand(binop->left()) && isStackOperand(binop->right()) ? 1 : 0;
+        }
+        return 0;
+    }
+
+    void getStackSizeAndAddMovRegisters(AAst::Function& function) {
+        // Iterate over the instructions to find out how many new instructions need to be added
         // Counter starts at 2 because of stackallocinstruction and the final mov instruction before ret
         int newIndicesCounter {2};
-        AAstInstructionList& currentInstructions{program.function().instructions()};
+        AAstInstructionList& currentInstructions{function.instructions()};
         for (auto& inst : currentInstructions) {
-            if (needsRegisterStep(*inst)) {
-                ++newIndicesCounter;
-            }
+            newIndicesCounter += registerStepsNeeded(*inst);
         }
 
         // Create a new vector pre-sized to match the number of added instructions
@@ -324,31 +333,64 @@ namespace AAstGen {
         finalInstructions.reserve(newIndicesCounter + std::ssize(currentInstructions));
 
         // Get the final stackoffset, create a StackAlloc instruction and place it at the start of the instructions
-        AAst::StackallocInstruction finalOffset {getStackOffset()};
+        AAst::StackallocInstruction finalOffset {function.stackSize()};
         finalInstructions.push_back(std::make_unique<AAst::Instruction>(finalOffset));
 
-        // counter to keep track of the last offset
-        int lastOffset{0};
-
         for (auto& inst : currentInstructions) {
-           if (needsRegisterStep(*inst)) {
-               // All modifications are done on the instruction inst points to
-               AAst::MovInstruction& movInst1 {std::get<AAst::MovInstruction>(*inst)};
-               AAst::Operand dst {movInst1.destination()};
-               AAst::RegisterOperand reg {AAst::R10};
-               movInst1.setDestination(reg);
-
-               // Create new MovInstruction
-               AAst::MovInstruction movInst2 {reg, dst};
-
-               // Move inst to the new vector
-               finalInstructions.push_back(std::move(inst));
-               finalInstructions.push_back(std::make_unique<AAst::Instruction>(movInst2));
-           } else {
+           if (registerStepsNeeded(*inst) == 0) {
                finalInstructions.push_back(std::move(inst));
+               continue;
            }
+           // All modifications are done on the instruction inst points to
+           std::visit(Ol::overloaded{
+               [&](AAst::MovInstruction& movInst1) {
+                   // mov src, %r10d then mov %r10d, dst
+                   AAst::Operand dst {movInst1.destination()};
+                   AAst::RegisterOperand reg {AAst::R10};
+                   movInst1.setDestination(reg);
+
+                   AAst::MovInstruction movInst2 {reg, dst};
+                   finalInstructions.push_back(std::move(inst));
+                   finalInstructions.push_back(std::make_unique<AAst::Instruction>(movInst2));
+               },
+               [&](AAst::IdivInstruction& idivInst) {
+                   // mov $imm, %r10d then idiv %r10d
+                   AAst::RegisterOperand reg {AAst::R10};
+                   AAst::MovInstruction movInst {idivInst.operand(), reg};
+                   idivInst.setOperand(reg);
+                   finalInstructions.push_back(std::make_unique<AAst::Instruction>(movInst));
+                   finalInstructions.push_back(std::move(inst));
+               },
+               [&](AAst::BinopInstruction& binopInst) {
+                   if (binopInst.binop() == AAst::MultiplyBinop) {
+                       // mov dst, %r11d then imul src, %r11d then mov %r11d, dst
+                       AAst::Operand dst {binopInst.right()};
+                       AAst::RegisterOperand reg {AAst::R11};
+                       binopInst.setRight(reg);
+                       finalInstructions.push_back(std::make_unique<AAst::Instruction>(AAst::MovInstruction{dst, reg}));
+                       finalInstructions.push_back(std::move(inst));
+                       finalInstructions.push_back(std::make_unique<AAst::Instruction>(AAst::MovInstruction{reg, dst}));
+                   } else {
+                       // mov src, %r10d then add or sub %r10d, dst
+                       AAst::RegisterOperand reg {AAst::R10};
+                       AAst::MovInstruction movInst {binopInst.left(), reg};
+                       binopInst.setLeft(reg);
+                       finalInstructions.push_back(std::make_unique<AAst::Instruction>(movInst));
+                       finalInstructions.push_back(std::move(inst));
+                   }
+               },
+               [&](auto&) {
+                   finalInstructions.push_back(std::move(inst));
+               }
+           }, *inst);
         }
 
-        program.function().setInstructions(std::move(finalInstructions));
+        function.setInstructions(std::move(finalInstructions));
+    }
+
+    void getStackSizeAndAddMovRegisters(AAst::Program& program) {
+        for (auto& function : program.functions()) {
+            getStackSizeAndAddMovRegisters(*function);
+        }
     }
 }
@@ -4,10 +4,11 @@
 
 #ifndef DCC_ASSEMBLY_GENERATOR_H
 #define DCC_ASSEMBLY_GENERATOR_H
-#include <unordered_map>
+#include <vector>
 
 #include "assembly_ast.h"
 #include "../tacky/tacky.h"
+#include "../helpers/compilation_context.h"
 
 namespace AAstGen {
     ////////////////////////////////
@@ -27,6 +28,12 @@ namespace AAstGen {
 
     std::unique_ptr<AAst::Instruction> generateMovInstruction(const Tky::Value& src, const Tky::Value& dst);
 
+    // Move a value into a specific hardware register
+    std::unique_ptr<AAst::Instruction> generateMovInstruction(const Tky::Value& src, AAst::Register dst);
+
+    // Move a specific hardware register's value out into dst
+    std::unique_ptr<AAst::Instruction> generateMovInstruction(AAst::Register src, const Tky::Value& dst);
+
     std::unique_ptr<AAst::Instruction> generateUnopInstruction(const Tky::Unop& unop, const Tky::Value& dst);
 
     using TkyInstructionList = std::vector<std::unique_ptr<Tky::Instruction>>;
@@ -45,20 +52,28 @@ namespace AAstGen {
     /// Replace Pseudoregisters ///
     ///////////////////////////////
     /// Second compiler pass to replace all pseudoregister nodes with stack nodes
-    /// An unordered_map is used to track what pseudoregister values map to stack values
-
-    using PrToOffsetMap = std::unordered_map<std::string_view, int>;
-
-    // Gets the latest stack offset
-    // if no argument is given, defaults to just returning the current value of the offset
-    int getStackOffset(int offset = 1);
+    /// Pseudoregisters are SymbolIds, so a vector indexed by them tracks what stack value each maps to
+    /// Stack slots are handed out by the compilation context, which starts each function's frame off empty, and the
+    /// frame size each function reaches is kept on it
+
+    /// One map serves every function in a program. SymbolIds are numbered across the whole program, so a fresh map per
+    /// function would be as long as every symbol before it. Only the entries a function set are cleared after it
+    struct PrToOffsetMap {
+        // Stack offset by SymbolId, with 0 for none yet
+        std::vector<int> offsets;
+        // SymbolIds given an offset in the current function
+        std::vector<Sym::SymbolId> assigned;
+
+        void clear() {
+            for (Sym::SymbolId id : assigned) {
+                offsets[id] = 0;
+            }
+            assigned.clear();
+        }
+    };
 
     bool isPseudoOperand(AAst::Operand& operand);
 
-    // Check if the pseudoaddress is already mapped to a stack offset
-    // If it is, return that offset, otherwise create a new key/value pair
-    int getStackOffset(AAst::PseudoOperand& pseudoOp, PrToOffsetMap& prToStackOffset);
-
     void replacePseudoOperandInUnop(AAst::UnopInstruction& inst,
                                     PrToOffsetMap& prToStackOffset);
 
@@ -66,16 +81,26 @@ namespace AAstGen {
     void replacePseudoOperandsInMov(AAst::MovInstruction& inst,
                                     PrToOffsetMap& prToStackOffset);
 
-    void findAndReplacePseudoOperands(AAst::Program& program);
+    void findAndReplacePseudoOperands(AAst::Function& function, PrToOffsetMap& prToStackOffset,
+                                      Ctx::CompilationContext& context);
+
+    void findAndReplacePseudoOperands(AAst::Program& program, Ctx::CompilationContext& context);
 
     //////////////////////////////////////
     /// Add stack size and rewrite Mov ///
     //////////////////////////////////////
     /// Add instructions to set the stack size and rewrite Mov instrutcions
     /// Mov instructions cannot have a src and dst as stack offsets, so intermediate steps must be added with registers
+    /// The same goes for add and sub, idiv of an immediate and imul into a stack offset
 
     bool needsRegisterStep(AAst::Instruction& inst);
 
+    // How many instructions have to be added to make inst one the processor accepts
+    int registerStepsNeeded(AAst::Instruction& inst);
+
+    // The stack size is the frame size each function reached while replacing pseudoregisters
+    void getStackSizeAndAddMovRegisters(AAst::Function& function);
+
     void getStackSizeAndAddMovRegisters(AAst::Program& program);
 }
 #endif //DCC_ASSEMBLY_GENERATOR_H
\ No newline at end of file
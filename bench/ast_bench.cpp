@@ -0,0 +1,427 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+// Compares walking an expression as a pointer tree with walking it as a flat post-order array
+//   dcc_ast_bench [--nodes 1M] [--shapes balanced,chain,nested] [--repeat N] [--json] [--label NAME]
+// For each shape builds one expression of about --nodes nodes in an arena, flattens it, and times:
+//   - evaluate, computing the expression's value, recursively over the tree and in one loop over the array
+//   - lower, generating Tacky with TkyGen::parseInstructionList from each form
+// Before reporting, checks that both forms give the same value and exactly the same Tacky. Exits with an error if not
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <pthread.h>
+
+#include "synthetic_source.h"
+#include "../helpers/overload.h"
+#include "../lexer/tokens.h"
+#include "../parser/flat_ast.h"
+#include "../tacky/tacky_generator.h"
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    double secondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    ///////////////
+    /// Options ///
+    ///////////////
+    enum class Shape {
+        Balanced, // A balanced tree of binary operators
+        Chain,    // Binary operators leaning left, as a long run like 1 + 2 + 3 parses
+        Nested,   // Unary operators inside each other
+    };
+
+    constexpr Shape allShapes[] {Shape::Balanced, Shape::Chain, Shape::Nested};
+
+    std::string_view shapeName(Shape shape) {
+        switch (shape) {
+            case Shape::Balanced: return "balanced";
+            case Shape::Chain: return "chain";
+            case Shape::Nested: return "nested";
+        }
+        return "unknown";
+    }
+
+    struct Options {
+        std::size_t nodes {1 << 20};
+        std::vector<Shape> shapes {std::begin(allShapes), std::end(allShapes)};
+        int repeat {5};
+        bool json {false};
+        std::string label;
+    };
+
+    std::vector<std::string_view> splitList(std::string_view list) {
+        std::vector<std::string_view> items;
+        while (!list.empty()) {
+            std::size_t comma {list.find(',')};
+            items.push_back(list.substr(0, comma));
+            list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+        }
+        return items;
+    }
+
+    // Throws std::invalid_argument for anything it does not understand
+    Options parseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i {1}; i < argc; ++i) {
+            std::string_view option {argv[i]};
+            auto value = [&]() -> std::string_view {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument(std::string{option} + " needs a value");
+                }
+                return argv[++i];
+            };
+
+            if (option == "--nodes") {
+                auto nodes {Bench::parseSize(value())};
+                if (!nodes || *nodes < 3 || *nodes > (std::size_t {64} << 20)) {
+                    throw std::invalid_argument("--nodes must be between 3 and 64M");
+                }
+                options.nodes = *nodes;
+            } else if (option == "--shapes") {
+                options.shapes.clear();
+                for (std::string_view item : splitList(value())) {
+                    auto found {std::find_if(std::begin(allShapes), std::end(allShapes),
+                                             [&](Shape shape) { return shapeName(shape) == item; })};
+                    if (found == std::end(allShapes)) {
+                        throw std::invalid_argument("unknown shape " + std::string{item});
+                    }
+                    options.shapes.push_back(*found);
+                }
+            } else if (option == "--repeat") {
+                auto repeat {Bench::parseSize(value())};
+                if (!repeat || *repeat == 0 || *repeat > 100) {
+                    throw std::invalid_argument("--repeat needs a number between 1 and 100");
+                }
+                options.repeat = static_cast<int>(*repeat);
+            } else if (option == "--json") {
+                options.json = true;
+            } else if (option == "--label") {
+                options.label = value();
+            } else {
+                throw std::invalid_argument("unrecognised option " + std::string{option});
+            }
+        }
+        return options;
+    }
+
+    ////////////////
+    /// Building ///
+    ////////////////
+    constexpr Token::Binop g_binops[] {Token::Binop::Add, Token::Binop::Subtract, Token::Binop::Multiply,
+                                       Token::Binop::Divide, Token::Binop::Remainder};
+
+    Ast::ExpressionPtr constant(Mem::Arena& arena, std::size_t& next) {
+        return arena.make<Ast::ConstantExpression>(Ast::IntConstant{static_cast<int>(next++ % 9 + 1)});
+    }
+
+    Ast::ExpressionPtr binop(Mem::Arena& arena, Ast::ExpressionPtr left, Ast::ExpressionPtr right, std::size_t& next) {
+        return arena.make<Ast::BinopExpression>(left, Ast::BinaryOperator{g_binops[next++ % std::size(g_binops)]}, right);
+    }
+
+    Ast::ExpressionPtr balanced(Mem::Arena& arena, std::size_t leaves, std::size_t& next) {
+        if (leaves <= 1) {
+            return constant(arena, next);
+        }
+        Ast::ExpressionPtr left {balanced(arena, leaves / 2, next)};
+        Ast::ExpressionPtr right {balanced(arena, leaves - leaves / 2, next)};
+        return binop(arena, left, right, next);
+    }
+
+    // About nodes nodes in all, counting each operator and constant as one
+    Ast::ExpressionPtr build(Shape shape, std::size_t nodes, Mem::Arena& arena) {
+        std::size_t next {0};
+        switch (shape) {
+            case Shape::Balanced:
+                return balanced(arena, (nodes + 1) / 2, next);
+            case Shape::Chain: {
+                Ast::ExpressionPtr expression {constant(arena, next)};
+                for (std::size_t i {1}; i < (nodes + 1) / 2; ++i) {
+                    expression = binop(arena, expression, constant(arena, next), next);
+                }
+                return expression;
+            }
+            case Shape::Nested: {
+                Ast::ExpressionPtr expression {constant(arena, next)};
+                for (std::size_t i {1}; i < nodes; ++i) {
+                    Token::Unop unop {i % 2 == 0 ? Token::Unop::Negate : Token::Unop::Complement};
+                    expression = arena.make<Ast::UnopExpression>(Ast::UnaryOperator{unop}, expression);
+                }
+                return expression;
+            }
+        }
+        throw std::invalid_argument("unknown shape");
+    }
+
+    //////////////////
+    /// Evaluating ///
+    //////////////////
+    // Wrapping arithmetic, with anything divided by zero coming to zero, so every tree has a value
+    std::uint32_t apply(Token::Binop op, std::uint32_t left, std::uint32_t right) {
+        switch (op) {
+            case Token::Binop::Add: return left + right;
+            case Token::Binop::Subtract: return left - right;
+            case Token::Binop::Multiply: return left * right;
+            case Token::Binop::Divide: return right == 0 ? 0 : left / right;
+            case Token::Binop::Remainder: return right == 0 ? 0 : left % right;
+        }
+        return 0;
+    }
+
+    std::uint32_t apply(Token::Unop op, std::uint32_t operand) {
+        switch (op) {
+            case Token::Unop::Negate: return 0 - operand;
+            case Token::Unop::Complement: return ~operand;
+        }
+        return 0;
+    }
+
+    std::uint32_t evaluateTree(const Ast::ExpressionPtr& expression) {
+        return std::visit(Ol::overloaded{
+            [](Ast::ConstantExpression* constant) -> std::uint32_t {
+                return static_cast<std::uint32_t>(constant->constant().value());
+            },
+            [](Ast::UnopExpression* unop) -> std::uint32_t {
+                return apply(unop->unop().unop(), evaluateTree(unop->expression()));
+            },
+            [](Ast::BinopExpression* binop) -> std::uint32_t {
+                std::uint32_t left {evaluateTree(binop->leftExpression())};
+                return apply(binop->binop().binop(), left, evaluateTree(binop->rightExpression()));
+            },
+        }, expression);
+    }
+
+    std::uint32_t evaluateFlat(const FlatAst::Expression& expression) {
+        std::vector<std::uint32_t> values(expression.size());
+        for (FlatAst::NodeIndex i {0}; i < expression.size(); ++i) {
+            const FlatAst::Node& node {expression[i]};
+            switch (node.kind) {
+                case FlatAst::NodeKind::Constant: values[i] = node.first; break;
+                case FlatAst::NodeKind::Unop: values[i] = apply(node.unop(), values[node.first]); break;
+                case FlatAst::NodeKind::Binop: values[i] = apply(node.binop(), values[node.first], values[node.second]); break;
+            }
+        }
+        return values.back();
+    }
+
+    //////////////
+    /// Checks ///
+    //////////////
+    bool sameValue(const Tky::Value& left, const Tky::Value& right) {
+        if (left.index() != right.index()) {
+            return false;
+        }
+        if (const auto* variable {std::get_if<Tky::VariableValue>(&left)}) {
+            return variable->variable() == std::get<Tky::VariableValue>(right).variable();
+        }
+        return std::get<Tky::ConstantValue>(left).constant() == std::get<Tky::ConstantValue>(right).constant();
+    }
+
+    // Same instructions in the same order, with the same operators, temporaries and constants
+    bool sameTacky(const TkyGen::InstructionList& left, const TkyGen::InstructionList& right) {
+        if (left.size() != right.size()) {
+            return false;
+        }
+        for (std::size_t i {0}; i < left.size(); ++i) {
+            const Tky::Instruction& a {*left[i]};
+            const Tky::Instruction& b {*right[i]};
+            if (a.index() != b.index()) {
+                return false;
+            }
+            if (const auto* unary {std::get_if<Tky::UnaryInstruction>(&a)}) {
+                const auto& other {std::get<Tky::UnaryInstruction>(b)};
+                if (unary->unop().unop() != other.unop().unop() || !sameValue(unary->src(), other.src())
+                    || !sameValue(unary->dst(), other.dst())) {
+                    return false;
+                }
+            } else if (const auto* binary {std::get_if<Tky::BinaryInstruction>(&a)}) {
+                const auto& other {std::get<Tky::BinaryInstruction>(b)};
+                if (binary->binop().binop() != other.binop().binop() || !sameValue(binary->src1(), other.src1())
+                    || !sameValue(binary->src2(), other.src2()) || !sameValue(binary->dst(), other.dst())) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    ///////////////////
+    /// Measurement ///
+    ///////////////////
+    struct Result {
+        Shape shape;
+        std::size_t nodes;
+        double flattenSeconds;
+        double treeEvaluateSeconds;
+        double flatEvaluateSeconds;
+        double treeLowerSeconds;
+        double flatLowerSeconds;
+        bool identical;
+    };
+
+    // Fastest of repeat runs of work
+    double fastest(int repeat, const std::function<void()>& work) {
+        double best {0};
+        for (int run {0}; run < repeat; ++run) {
+            auto start {Clock::now()};
+            work();
+            double seconds {secondsSince(start)};
+            best = run == 0 ? seconds : std::min(best, seconds);
+        }
+        return best;
+    }
+
+    Result measure(Shape shape, const Options& options) {
+        Mem::Arena arena;
+        Ast::ExpressionPtr tree {build(shape, options.nodes, arena)};
+        FlatAst::Expression flat;
+        Result result {shape, 0, 0, 0, 0, 0, 0, true};
+        result.flattenSeconds = fastest(options.repeat, [&]() { flat = FlatAst::flatten(tree); });
+        result.nodes = flat.size();
+
+        std::uint32_t treeValue {0};
+        std::uint32_t flatValue {0};
+        result.treeEvaluateSeconds = fastest(options.repeat, [&]() { treeValue = evaluateTree(tree); });
+        result.flatEvaluateSeconds = fastest(options.repeat, [&]() { flatValue = evaluateFlat(flat); });
+
+        // Each lowering gets a fresh context, so both hand out the same temporaries
+        TkyGen::InstructionList treeTacky;
+        TkyGen::InstructionList flatTacky;
+        result.treeLowerSeconds = fastest(options.repeat, [&]() {
+            Ctx::CompilationContext context;
+            treeTacky.clear();
+            TkyGen::parseInstructionList(tree, treeTacky, context);
+        });
+        result.flatLowerSeconds = fastest(options.repeat, [&]() {
+            Ctx::CompilationContext context;
+            flatTacky.clear();
+            TkyGen::parseInstructionList(flat, flatTacky, context);
+        });
+
+        result.identical = treeValue == flatValue && sameTacky(treeTacky, flatTacky);
+        return result;
+    }
+
+    // Evaluating the tree recurses once per level, so everything runs on a thread with a stack big enough for a chain or
+    // nest a million deep rather than the main thread's 8 MB
+    void runWithLargeStack(const std::function<void()>& work) {
+        constexpr std::size_t stackBytes {std::size_t {4} << 30};
+        pthread_attr_t attributes;
+        pthread_attr_init(&attributes);
+        pthread_attr_setstacksize(&attributes, stackBytes);
+        pthread_t thread;
+        auto run = [](void* argument) -> void* {
+            (*static_cast<const std::function<void()>*>(argument))();
+            return nullptr;
+        };
+        int error {pthread_create(&thread, &attributes, run, const_cast<std::function<void()>*>(&work))};
+        pthread_attr_destroy(&attributes);
+        if (error != 0) {
+            throw std::runtime_error("could not start a thread with a " + Bench::formatSize(stackBytes) + " stack");
+        }
+        pthread_join(thread, nullptr);
+    }
+
+    //////////////
+    /// Output ///
+    //////////////
+    std::string jsonString(std::string_view text) {
+        std::string quoted {"\""};
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+                quoted += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                quoted += ' ';
+            } else {
+                quoted += c;
+            }
+        }
+        return quoted + "\"";
+    }
+
+    void printJson(const Options& options, const std::vector<Result>& results) {
+        std::ostringstream out;
+        out.precision(6);
+        out << "{\n";
+        out << "  \"benchmark\": \"ast\",\n";
+        out << "  \"label\": " << jsonString(options.label) << ",\n";
+        out << "  \"repeat\": " << options.repeat << ",\n";
+        out << "  \"results\": [";
+        for (std::size_t i {0}; i < results.size(); ++i) {
+            const Result& result {results[i]};
+            out << (i == 0 ? "\n" : ",\n") << "    {\"shape\": " << jsonString(shapeName(result.shape))
+                << ", \"nodes\": " << result.nodes << ", \"identical\": " << (result.identical ? "true" : "false")
+                << ", \"flatten_seconds\": " << result.flattenSeconds
+                << ", \"tree_evaluate_seconds\": " << result.treeEvaluateSeconds
+                << ", \"flat_evaluate_seconds\": " << result.flatEvaluateSeconds
+                << ", \"tree_lower_seconds\": " << result.treeLowerSeconds
+                << ", \"flat_lower_seconds\": " << result.flatLowerSeconds << "}";
+        }
+        out << (results.empty() ? "]\n}\n" : "\n  ]\n}\n");
+        std::cout << out.str();
+    }
+
+    void printTable(const std::vector<Result>& results) {
+        std::cout << "Milliseconds per walk, fastest of each\n";
+        std::cout << "\tshape\t\tnodes\tflatten\tevaluate tree/flat\tlower tree/flat\t\tspeedup evaluate/lower\n";
+        for (const Result& result : results) {
+            std::string_view name {shapeName(result.shape)};
+            std::cout << "\t" << name << (name.size() < 8 ? "\t\t" : "\t") << result.nodes << "\t"
+                      << result.flattenSeconds * 1e3 << "\t" << result.treeEvaluateSeconds * 1e3 << " / "
+                      << result.flatEvaluateSeconds * 1e3 << "\t" << result.treeLowerSeconds * 1e3 << " / "
+                      << result.flatLowerSeconds * 1e3 << "\t"
+                      << result.treeEvaluateSeconds / result.flatEvaluateSeconds << "x / "
+                      << result.treeLowerSeconds / result.flatLowerSeconds << "x\n";
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::invalid_argument& error) {
+        std::cerr << "Error: " << error.what() << "\n";
+        return 1;
+    }
+
+    std::vector<Result> results;
+    try {
+        runWithLargeStack([&]() {
+            for (Shape shape : options.shapes) {
+                results.push_back(measure(shape, options));
+            }
+        });
+    } catch (const std::runtime_error& error) {
+        std::cerr << "Error: " << error.what() << "\n";
+        return 1;
+    }
+
+    if (options.json) {
+        printJson(options, results);
+    } else {
+        printTable(results);
+    }
+    for (const Result& result : results) {
+        if (!result.identical) {
+            std::cerr << "Mismatch: the tree and flat forms of the " << shapeName(result.shape)
+                      << " expression give different results\n";
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,136 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+// Checks that compilations with separate contexts do not affect each other
+//   dcc_context_stress [units] [threads]
+// Generates units small programs, compiles every one of them in turn, then compiles them all again at the same time on
+// threads workers. Each unit's assembly must be byte for byte the same both times, and the first unit must come out
+// the same when compiled again after all the others. Exits with 1 and lists the first few differences otherwise
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../tacky/tacky_generator.h"
+#include "../assembly_generator/assembly_generator.h"
+#include "../assembly_emitter/assembly_emitter.h"
+#include "../helpers/compilation_context.h"
+#include "../helpers/thread_pool.h"
+
+namespace {
+    // An expression over every operator the compiler supports, nested up to depth levels
+    void appendExpression(std::string& text, std::mt19937& random, int depth) {
+        std::uniform_int_distribution<int> choice {0, depth > 0 ? 9 : 0};
+        switch (choice(random)) {
+            case 0:
+                // Never 0, so nothing divides by zero
+                text += std::to_string(std::uniform_int_distribution<int>{1, 999}(random));
+                return;
+            case 1:
+                // Bracketed, since two minus signs in a row would lex as --
+                text += "-(";
+                appendExpression(text, random, depth - 1);
+                text += ")";
+                return;
+            case 2:
+                text += "~";
+                appendExpression(text, random, depth - 1);
+                return;
+            case 3:
+                text += "(";
+                appendExpression(text, random, depth - 1);
+                text += ")";
+                return;
+            default: {
+                constexpr std::string_view operators[] {" + ", " - ", " * ", " / ", " % "};
+                appendExpression(text, random, depth - 1);
+                text += operators[std::uniform_int_distribution<int>{0, 4}(random)];
+                appendExpression(text, random, depth - 1);
+                return;
+            }
+        }
+    }
+
+    std::string generateUnit(std::uint32_t seed) {
+        std::mt19937 random {seed};
+        std::string text {"int main(void) {\n    return "};
+        appendExpression(text, random, 2 + static_cast<int>(seed % 6));
+        text += ";\n}\n";
+        return text;
+    }
+
+    // Runs the whole pipeline on text with a fresh context and returns the assembly
+    std::string compile(std::string_view text) {
+        Ctx::CompilationContext context;
+        Lexer::Scanner scanner {text, context.symbols(), context.diagnostics()};
+        Ast::Program abstractSyntaxTree {Parser::parseProgram(scanner)};
+        Tky::Program tackyTree {TkyGen::parseProgram(abstractSyntaxTree, context)};
+        AAst::Program assemblyAbstractSyntaxTree {AAstGen::generateProgram(tackyTree)};
+        AAstGen::findAndReplacePseudoOperands(assemblyAbstractSyntaxTree, context);
+        AAstGen::getStackSizeAndAddMovRegisters(assemblyAbstractSyntaxTree);
+        return AssemblyEmitter::emitAssemblyText(assemblyAbstractSyntaxTree, context.symbols());
+    }
+
+    std::size_t parseCount(const char* argument, std::size_t fallback) {
+        std::string_view text {argument};
+        std::size_t value {};
+        auto [ptr, ec] {std::from_chars(text.data(), text.data() + text.size(), value)};
+        return ec == std::errc{} && ptr == text.data() + text.size() && value > 0 ? value : fallback;
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::size_t units {argc > 1 ? parseCount(argv[1], 4000) : 4000};
+    std::size_t threads {argc > 2 ? parseCount(argv[2], Threads::hardwareThreads()) : Threads::hardwareThreads()};
+
+    std::vector<std::string> sources;
+    sources.reserve(units);
+    for (std::size_t i {0}; i < units; ++i) {
+        sources.push_back(generateUnit(static_cast<std::uint32_t>(i)));
+    }
+
+    auto start {std::chrono::steady_clock::now()};
+    std::vector<std::string> serial;
+    serial.reserve(units);
+    for (const auto& source : sources) {
+        serial.push_back(compile(source));
+    }
+    double serialSeconds {secondsSince(start)};
+
+    start = std::chrono::steady_clock::now();
+    std::vector<std::string> parallel(units);
+    {
+        Threads::ThreadPool pool {threads};
+        Threads::parallelFor(pool, units, [&](std::size_t i) { parallel[i] = compile(sources[i]); });
+    }
+    double parallelSeconds {secondsSince(start)};
+
+    std::size_t mismatches {0};
+    for (std::size_t i {0}; i < units; ++i) {
+        if (serial[i] != parallel[i]) {
+            if (++mismatches <= 5) {
+                std::cout << "unit " << i << " differs between serial and parallel compiles\n" << sources[i];
+            }
+        }
+    }
+    if (compile(sources.front()) != serial.front()) {
+        ++mismatches;
+        std::cout << "unit 0 differs when compiled again after " << units << " other units\n";
+    }
+
+    std::cout << units << " units, serial " << serialSeconds << " s, " << threads << " threads " << parallelSeconds
+              << " s, " << mismatches << " mismatches\n";
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,518 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+// Checks that every phase of the compiler scales linearly with the size of its input
+//   dcc_bench [--series balanced,nested,chain,functions] [--sizes 4K,16K,64K,256K,1M] [--repeat N] [--time-tolerance X]
+//             [--memory-tolerance X] [--json] [--label NAME]
+// Compiles generated programs of growing size through libdcc and records each phase's time and allocated bytes:
+//   - balanced, one expression that is a balanced tree of binary operators, so grows in size but barely in depth
+//   - nested, unary operators and parentheses nested inside each other, so grows in depth
+//   - chain, a long flat run of binary operators, so grows in tokens with every operator at the same level
+//   - functions, many small functions, so grows in the number of functions and the symbols they add
+// Sizes are in tokens. A power law is fitted to each phase's time and bytes against the tokens actually produced,
+// and if any exponent is further above 1 than the tolerance allows, the phase is named and the exit code is 1
+// An O(n log n) phase fits at about 1.08 over the default sizes and O(n^2) at 2, so the default tolerances let
+// n log n through and catch anything worse
+// The fitted exponents are in the JSON with the points they came from, so runs can be compared between versions
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "synthetic_source.h"
+#include "../libdcc/dcc.h"
+
+namespace {
+    ///////////////
+    /// Options ///
+    ///////////////
+    enum class Series {
+        Balanced,
+        Nested,
+        Chain,
+        Functions,
+    };
+
+    constexpr Series allSeries[] {Series::Balanced, Series::Nested, Series::Chain, Series::Functions};
+
+    std::string_view seriesName(Series series) {
+        switch (series) {
+            case Series::Balanced: return "balanced";
+            case Series::Nested: return "nested";
+            case Series::Chain: return "chain";
+            case Series::Functions: return "functions";
+        }
+        return "unknown";
+    }
+
+    struct Options {
+        std::vector<Series> series {std::begin(allSeries), std::end(allSeries)};
+        std::vector<std::size_t> sizes {4 << 10, 16 << 10, 64 << 10, 256 << 10, 1 << 20};
+        int repeat {3};
+        // How far above 1 a fitted exponent may be
+        double timeTolerance {0.25};
+        // Allocated bytes are the same on every run, so memory can be held closer than time
+        double memoryTolerance {0.15};
+        bool json {false};
+        std::string label;
+    };
+
+    std::vector<std::string_view> splitList(std::string_view list) {
+        std::vector<std::string_view> items;
+        while (!list.empty()) {
+            std::size_t comma {list.find(',')};
+            items.push_back(list.substr(0, comma));
+            list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+        }
+        return items;
+    }
+
+    double parseTolerance(std::string_view option, std::string_view text) {
+        try {
+            std::size_t used {0};
+            double tolerance {std::stod(std::string{text}, &used)};
+            if (used == text.size() && tolerance >= 0) {
+                return tolerance;
+            }
+        } catch (const std::exception&) {
+        }
+        throw std::invalid_argument(std::string{option} + " needs a number of at least 0, not " + std::string{text});
+    }
+
+    // Throws std::invalid_argument for anything it does not understand
+    Options parseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i {1}; i < argc; ++i) {
+            std::string_view option {argv[i]};
+            auto value = [&]() -> std::string_view {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument(std::string{option} + " needs a value");
+                }
+                return argv[++i];
+            };
+
+            if (option == "--series") {
+                options.series.clear();
+                for (std::string_view item : splitList(value())) {
+                    auto found {std::find_if(std::begin(allSeries), std::end(allSeries),
+                                             [&](Series series) { return seriesName(series) == item; })};
+                    if (found == std::end(allSeries)) {
+                        throw std::invalid_argument("unknown series " + std::string{item});
+                    }
+                    options.series.push_back(*found);
+                }
+            } else if (option == "--sizes") {
+                options.sizes.clear();
+                for (std::string_view item : splitList(value())) {
+                    auto size {Bench::parseSize(item)};
+                    if (!size || *size < 16 || *size > (std::size_t {16} << 20)) {
+                        throw std::invalid_argument("sizes must be between 16 and 16M tokens, not " + std::string{item});
+                    }
+                    options.sizes.push_back(*size);
+                }
+                if (options.sizes.size() < 3) {
+                    throw std::invalid_argument("--sizes needs at least 3 sizes to fit a curve");
+                }
+            } else if (option == "--repeat") {
+                auto repeat {Bench::parseSize(value())};
+                if (!repeat || *repeat == 0 || *repeat > 100) {
+                    throw std::invalid_argument("--repeat needs a number between 1 and 100");
+                }
+                options.repeat = static_cast<int>(*repeat);
+            } else if (option == "--time-tolerance") {
+                options.timeTolerance = parseTolerance(option, value());
+            } else if (option == "--memory-tolerance") {
+                options.memoryTolerance = parseTolerance(option, value());
+            } else if (option == "--json") {
+                options.json = true;
+            } else if (option == "--label") {
+                options.label = value();
+            } else {
+                throw std::invalid_argument("unrecognised option " + std::string{option});
+            }
+        }
+        std::sort(options.sizes.begin(), options.sizes.end());
+        return options;
+    }
+
+    //////////////////
+    /// Generators ///
+    //////////////////
+    // Each gives a whole program of roughly tokens tokens, with every operand a small non-zero constant
+    constexpr std::string_view g_prefix {"int main(void) {\n    return "};
+    constexpr std::string_view g_suffix {";\n}\n"};
+    constexpr std::string_view g_operators[] {" + ", " * ", " - ", " / ", " % "};
+
+    void appendBalanced(std::string& text, std::size_t leaves, std::size_t& next) {
+        if (leaves <= 1) {
+            text += std::to_string(next++ % 9 + 1);
+            return;
+        }
+        text += '(';
+        appendBalanced(text, leaves / 2, next);
+        text += g_operators[next % std::size(g_operators)];
+        appendBalanced(text, leaves - leaves / 2, next);
+        text += ')';
+    }
+
+    // Each leaf costs about four tokens, its constant, an operator and half of a pair of parentheses
+    std::string balancedProgram(std::size_t tokens) {
+        std::string text {g_prefix};
+        std::size_t next {0};
+        appendBalanced(text, std::max<std::size_t>(tokens / 4, 2), next);
+        return text += g_suffix;
+    }
+
+    // Each level is an operator and a pair of parentheses, alternating - and ~ so no two minuses touch
+    std::string nestedProgram(std::size_t tokens) {
+        std::size_t depth {std::max<std::size_t>(tokens / 3, 1)};
+        std::string text {g_prefix};
+        for (std::size_t level {0}; level < depth; ++level) {
+            text += level % 2 == 0 ? "-(" : "~(";
+        }
+        text += '7';
+        text.append(depth, ')');
+        return text += g_suffix;
+    }
+
+    // Each operand is a constant and an operator
+    std::string chainProgram(std::size_t tokens) {
+        std::size_t operands {std::max<std::size_t>(tokens / 2, 2)};
+        std::string text {g_prefix};
+        for (std::size_t i {0}; i < operands; ++i) {
+            if (i != 0) {
+                text += g_operators[i % std::size(g_operators)];
+            }
+            text += std::to_string(i % 9 + 1);
+        }
+        return text += g_suffix;
+    }
+
+    // Each function is about twenty tokens, with a short expression so most of the growth is in how many there are
+    std::string functionsProgram(std::size_t tokens) {
+        std::size_t functions {std::max<std::size_t>(tokens / 20, 1)};
+        std::string text;
+        for (std::size_t i {1}; i < functions; ++i) {
+            text += "int f" + std::to_string(i) + "(void) {\n    return ";
+            for (std::size_t operand {0}; operand < 4; ++operand) {
+                if (operand != 0) {
+                    text += g_operators[(i + operand) % std::size(g_operators)];
+                }
+                text += std::to_string((i + operand) % 9 + 1);
+            }
+            text += g_suffix;
+        }
+        text += g_prefix;
+        text += '7';
+        return text += g_suffix;
+    }
+
+    std::string program(Series series, std::size_t tokens) {
+        switch (series) {
+            case Series::Balanced: return balancedProgram(tokens);
+            case Series::Nested: return nestedProgram(tokens);
+            case Series::Chain: return chainProgram(tokens);
+            case Series::Functions: return functionsProgram(tokens);
+        }
+        return {};
+    }
+
+    ///////////////////
+    /// Measurement ///
+    ///////////////////
+    struct PhasePoint {
+        std::string name;
+        double seconds;      // Fastest of the repeats
+        std::uint64_t bytes; // Allocated, which is the same on every repeat
+    };
+
+    struct Point {
+        std::size_t requestedTokens;
+        std::uint64_t tokens;
+        std::uint64_t astNodes;
+        std::vector<PhasePoint> phases;
+    };
+
+    // Compiles the program repeat times, keeping the fastest time for each phase
+    // Throws std::runtime_error if it does not compile, since a failed compile would skip phases and skew the fit
+    Point measure(Series series, std::size_t tokens, int repeat) {
+        const std::string source {program(series, tokens)};
+        Dcc::Options options;
+        options.name = std::string{seriesName(series)} + ".c";
+        options.collectStats = true;
+
+        Point point {tokens, 0, 0, {}};
+        for (int run {0}; run < repeat; ++run) {
+            Dcc::Result result {Dcc::compile(source, options)};
+            if (!result.succeeded || !result.stats) {
+                std::string message {"the " + std::string{seriesName(series)} + " program of "
+                                     + Bench::formatSize(tokens) + " tokens did not compile"};
+                if (!result.diagnostics.empty()) {
+                    message += ": " + result.diagnostics.front();
+                }
+                throw std::runtime_error(message);
+            }
+
+            const Dcc::TimeReport& report {*result.stats};
+            point.tokens = report.tokens;
+            point.astNodes = report.astNodes;
+            for (const Driver::Phase& phase : report.phases) {
+                double seconds {std::chrono::duration<double>(phase.time.wall).count()};
+                auto found {std::find_if(point.phases.begin(), point.phases.end(),
+                                         [&](const PhasePoint& known) { return known.name == phase.name; })};
+                if (found == point.phases.end()) {
+                    point.phases.push_back({std::string{phase.name}, seconds, phase.allocations.bytes});
+                } else {
+                    found->seconds = std::min(found->seconds, seconds);
+                }
+            }
+        }
+        return point;
+    }
+
+    ///////////////
+    /// Fitting ///
+    ///////////////
+    // Points below these are mostly timer noise and fixed costs, so are left out of the fit
+    constexpr double g_secondsFloor {0.00025};
+    constexpr double g_bytesFloor {64 << 10};
+
+    struct Fit {
+        bool fitted {false};
+        double exponent {0};
+        // The exponent between each size and the next
+        std::vector<double> steps;
+    };
+
+    // The exponent k for a phase costing c * n^k, as the median of the exponents between neighbouring sizes
+    // A straight least squares line gets pulled up by one step where the input stops fitting in a cache, which is a
+    // fact about the machine. A phase that really scales worse raises every step, so still moves the median
+    Fit fitExponent(const std::vector<std::pair<double, double>>& samples, double floor) {
+        Fit fit;
+        for (std::size_t i {1}; i < samples.size(); ++i) {
+            const auto& [smallTokens, smallValue] {samples[i - 1]};
+            const auto& [largeTokens, largeValue] {samples[i]};
+            if (smallValue >= floor && largeTokens > smallTokens) {
+                fit.steps.push_back(std::log(largeValue / smallValue) / std::log(largeTokens / smallTokens));
+            }
+        }
+        if (fit.steps.size() < 2) {
+            return fit;
+        }
+        std::vector<double> sorted {fit.steps};
+        std::sort(sorted.begin(), sorted.end());
+        std::size_t middle {sorted.size() / 2};
+        fit.fitted = true;
+        fit.exponent = sorted.size() % 2 == 1 ? sorted[middle] : (sorted[middle - 1] + sorted[middle]) / 2;
+        return fit;
+    }
+
+    struct PhaseFit {
+        Series series;
+        std::string phase;
+        Fit time;
+        Fit memory;
+        bool timeFails {false};
+        bool memoryFails {false};
+    };
+
+    struct SeriesResult {
+        Series series;
+        std::vector<Point> points;
+    };
+
+    // Every phase is expected to be linear in the tokens it is given
+    std::vector<PhaseFit> fitPhases(const SeriesResult& result, const Options& options) {
+        std::vector<PhaseFit> fits;
+        for (const Point& point : result.points) {
+            for (const PhasePoint& phase : point.phases) {
+                if (std::none_of(fits.begin(), fits.end(), [&](const PhaseFit& fit) { return fit.phase == phase.name; })) {
+                    fits.push_back({result.series, phase.name, {}, {}});
+                }
+            }
+        }
+
+        for (PhaseFit& fit : fits) {
+            std::vector<std::pair<double, double>> times;
+            std::vector<std::pair<double, double>> bytes;
+            for (const Point& point : result.points) {
+                for (const PhasePoint& phase : point.phases) {
+                    if (phase.name == fit.phase) {
+                        times.emplace_back(static_cast<double>(point.tokens), phase.seconds);
+                        bytes.emplace_back(static_cast<double>(point.tokens), static_cast<double>(phase.bytes));
+                    }
+                }
+            }
+            fit.time = fitExponent(times, g_secondsFloor);
+            fit.memory = fitExponent(bytes, g_bytesFloor);
+            fit.timeFails = fit.time.fitted && fit.time.exponent > 1 + options.timeTolerance;
+            fit.memoryFails = fit.memory.fitted && fit.memory.exponent > 1 + options.memoryTolerance;
+        }
+        return fits;
+    }
+
+    //////////////
+    /// Output ///
+    //////////////
+    std::string jsonString(std::string_view text) {
+        std::string quoted {"\""};
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+                quoted += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                quoted += ' ';
+            } else {
+                quoted += c;
+            }
+        }
+        return quoted + "\"";
+    }
+
+    std::string jsonFit(const Fit& fit) {
+        std::ostringstream out;
+        out << "{\"fitted\": " << (fit.fitted ? "true" : "false");
+        if (fit.fitted) {
+            out << ", \"exponent\": " << fit.exponent;
+        }
+        out << ", \"steps\": [";
+        for (std::size_t i {0}; i < fit.steps.size(); ++i) {
+            out << (i == 0 ? "" : ", ") << fit.steps[i];
+        }
+        out << "]}";
+        return out.str();
+    }
+
+    void printJson(const Options& options, const std::vector<SeriesResult>& results, const std::vector<PhaseFit>& fits,
+                   bool passed) {
+        std::ostringstream out;
+        out.precision(6);
+        out << "{\n";
+        out << "  \"benchmark\": \"dcc\",\n";
+        out << "  \"label\": " << jsonString(options.label) << ",\n";
+        out << "  \"repeat\": " << options.repeat << ",\n";
+        out << "  \"time_tolerance\": " << options.timeTolerance << ",\n";
+        out << "  \"memory_tolerance\": " << options.memoryTolerance << ",\n";
+        out << "  \"passed\": " << (passed ? "true" : "false") << ",\n";
+
+        out << "  \"points\": [";
+        bool first {true};
+        for (const SeriesResult& result : results) {
+            for (const Point& point : result.points) {
+                out << (first ? "\n" : ",\n") << "    {\"series\": " << jsonString(seriesName(result.series))
+                    << ", \"requested_tokens\": " << point.requestedTokens << ", \"tokens\": " << point.tokens
+                    << ", \"ast_nodes\": " << point.astNodes << ", \"phases\": [";
+                for (std::size_t i {0}; i < point.phases.size(); ++i) {
+                    const PhasePoint& phase {point.phases[i]};
+                    out << (i == 0 ? "" : ", ") << "{\"name\": " << jsonString(phase.name) << ", \"seconds\": "
+                        << phase.seconds << ", \"bytes\": " << phase.bytes << "}";
+                }
+                out << "]}";
+                first = false;
+            }
+        }
+        out << (first ? "],\n" : "\n  ],\n");
+
+        out << "  \"fits\": [";
+        for (std::size_t i {0}; i < fits.size(); ++i) {
+            const PhaseFit& fit {fits[i]};
+            out << (i == 0 ? "\n" : ",\n") << "    {\"series\": " << jsonString(seriesName(fit.series))
+                << ", \"phase\": " << jsonString(fit.phase) << ", \"time\": " << jsonFit(fit.time)
+                << ", \"memory\": " << jsonFit(fit.memory) << ", \"passed\": "
+                << (fit.timeFails || fit.memoryFails ? "false" : "true") << "}";
+        }
+        out << (fits.empty() ? "]\n}\n" : "\n  ]\n}\n");
+        std::cout << out.str();
+    }
+
+    std::string formatFit(const Fit& fit) {
+        if (!fit.fitted) {
+            return "-";
+        }
+        std::ostringstream out;
+        out.precision(3);
+        out << std::fixed << fit.exponent;
+        return out.str();
+    }
+
+    void printTable(const std::vector<SeriesResult>& results, const std::vector<PhaseFit>& fits) {
+        for (const SeriesResult& result : results) {
+            std::cout << seriesName(result.series) << "\n";
+            std::cout << "\ttokens\t\tphase ms (KB allocated)\n";
+            for (const Point& point : result.points) {
+                std::cout << "\t" << point.tokens << (point.tokens < 10'000'000 ? "\t\t" : "\t");
+                for (const PhasePoint& phase : point.phases) {
+                    std::cout << phase.name << " " << phase.seconds * 1e3 << " (" << phase.bytes / 1024 << ")  ";
+                }
+                std::cout << "\n";
+            }
+            std::cout << "\n";
+        }
+
+        std::cout << "Fitted exponents, where 1 is linear. - means the phase was too quick or small to fit\n";
+        std::cout << "\tseries\t\ttime\tmemory\tphase\n";
+        for (const PhaseFit& fit : fits) {
+            std::cout << "\t" << seriesName(fit.series) << "\t" << (seriesName(fit.series).size() < 8 ? "\t" : "")
+                      << formatFit(fit.time) << (fit.timeFails ? "!" : "") << "\t" << formatFit(fit.memory)
+                      << (fit.memoryFails ? "!" : "") << "\t" << fit.phase << "\n";
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::invalid_argument& error) {
+        std::cerr << "Error: " << error.what() << "\n";
+        return 1;
+    }
+
+    std::vector<SeriesResult> results;
+    std::vector<PhaseFit> fits;
+    try {
+        for (Series series : options.series) {
+            SeriesResult result {series, {}};
+            for (std::size_t size : options.sizes) {
+                result.points.push_back(measure(series, size, options.repeat));
+            }
+            for (PhaseFit& fit : fitPhases(result, options)) {
+                fits.push_back(std::move(fit));
+            }
+            results.push_back(std::move(result));
+        }
+    } catch (const std::runtime_error& error) {
+        std::cerr << "Error: " << error.what() << "\n";
+        return 1;
+    }
+
+    bool passed {std::none_of(fits.begin(), fits.end(),
+                              [](const PhaseFit& fit) { return fit.timeFails || fit.memoryFails; })};
+    if (options.json) {
+        printJson(options, results, fits, passed);
+    } else {
+        printTable(results, fits);
+    }
+
+    // Failures go to stderr as well, so they are seen even when the JSON is being piped somewhere
+    for (const PhaseFit& fit : fits) {
+        if (fit.timeFails) {
+            std::cerr << "FAIL: " << fit.phase << " on the " << seriesName(fit.series) << " series takes time growing as n^"
+                      << formatFit(fit.time) << ", more than the n^" << 1 + options.timeTolerance << " allowed\n";
+        }
+        if (fit.memoryFails) {
+            std::cerr << "FAIL: " << fit.phase << " on the " << seriesName(fit.series)
+                      << " series allocates memory growing as n^" << formatFit(fit.memory) << ", more than the n^"
+                      << 1 + options.memoryTolerance << " allowed\n";
+        }
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,446 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+// Measures Lexer::lexFile on synthetic preprocessed C
+//   dcc_lexer_bench [--sizes 1K,1M,64M] [--mixes identifiers,operators,literals,long_lines,mixed] [--threads N]
+//                   [--json] [--label NAME] [--skip-checks]
+// Reports tokens/s, bytes/s and heap allocations per token for every size and mix, as a table or as JSON
+// Before timing anything, checks on random input that every vector kernel agrees with the scalar one byte for byte,
+// and that lexing in parallel chunks gives exactly what lexing on one thread does. Exits with an error if not
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "synthetic_source.h"
+#include "../lexer/lexer.h"
+#include "../lexer/simd_scan.h"
+
+// Every heap allocation in the program goes through here, so the lexer's allocations can be counted
+namespace {
+    std::atomic<std::uint64_t> g_allocations {0};
+}
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* memory {std::malloc(size == 0 ? 1 : size)}) {
+        return memory;
+    }
+    throw std::bad_alloc{};
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, std::size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, std::size_t) noexcept { std::free(memory); }
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+    using Lexer::Scan::Kernels;
+
+    double secondsSince(Clock::time_point start) {
+        return std::chrono::duration<double>(Clock::now() - start).count();
+    }
+
+    ///////////////
+    /// Options ///
+    ///////////////
+    struct Options {
+        std::vector<std::size_t> sizes {1 << 10, 1 << 20, 64 << 20};
+        std::vector<Bench::Mix> mixes {std::begin(Bench::allMixes), std::end(Bench::allMixes)};
+        std::size_t threads {1};
+        bool json {false};
+        bool checks {true};
+        std::string label;
+    };
+
+    std::vector<std::string_view> splitList(std::string_view list) {
+        std::vector<std::string_view> items;
+        while (!list.empty()) {
+            std::size_t comma {list.find(',')};
+            items.push_back(list.substr(0, comma));
+            list.remove_prefix(comma == std::string_view::npos ? list.size() : comma + 1);
+        }
+        return items;
+    }
+
+    // Throws std::invalid_argument for anything it does not understand
+    Options parseOptions(int argc, char* argv[]) {
+        Options options;
+        for (int i {1}; i < argc; ++i) {
+            std::string_view option {argv[i]};
+            auto value = [&]() -> std::string_view {
+                if (i + 1 >= argc) {
+                    throw std::invalid_argument(std::string{option} + " needs a value");
+                }
+                return argv[++i];
+            };
+
+            if (option == "--sizes") {
+                options.sizes.clear();
+                for (std::string_view item : splitList(value())) {
+                    auto size {Bench::parseSize(item)};
+                    if (!size || *size == 0 || *size > (std::size_t {1} << 30)) {
+                        throw std::invalid_argument("sizes must be between 1 and 1G, not " + std::string{item});
+                    }
+                    options.sizes.push_back(*size);
+                }
+            } else if (option == "--mixes") {
+                options.mixes.clear();
+                for (std::string_view item : splitList(value())) {
+                    auto mix {Bench::parseMix(item)};
+                    if (!mix) {
+                        throw std::invalid_argument("unknown mix " + std::string{item});
+                    }
+                    options.mixes.push_back(*mix);
+                }
+            } else if (option == "--threads") {
+                auto threads {Bench::parseSize(value())};
+                if (!threads || *threads == 0) {
+                    throw std::invalid_argument("--threads needs a positive number");
+                }
+                options.threads = *threads;
+            } else if (option == "--json") {
+                options.json = true;
+            } else if (option == "--label") {
+                options.label = value();
+            } else if (option == "--skip-checks") {
+                options.checks = false;
+            } else {
+                throw std::invalid_argument("unrecognised option " + std::string{option});
+            }
+        }
+        return options;
+    }
+
+    //////////////
+    /// Checks ///
+    //////////////
+    // Every kernel set this CPU can run, scalar first
+    std::vector<const Kernels*> availableKernels() {
+        std::vector<const Kernels*> kernels {&Lexer::Scan::scalarKernels()};
+        if (const Kernels* sse2 {Lexer::Scan::sse2Kernels()}) {
+            kernels.push_back(sse2);
+        }
+        if (const Kernels* avx2 {Lexer::Scan::avx2Kernels()}) {
+            kernels.push_back(avx2);
+        }
+        return kernels;
+    }
+
+    // Text made of runs of each character class, with the odd byte from anywhere in 0-255 so kernels see
+    // characters just outside each range as well as inside it
+    std::string randomRuns(std::mt19937_64& rng, std::size_t length) {
+        constexpr std::string_view whitespace {" \t\n\v\f\r"};
+        constexpr std::string_view identifier {"abcxyzABCXYZ_0189"};
+        constexpr std::string_view digits {"0123456789"};
+        constexpr std::string_view neighbours {"/:@[`{\x08\x0e\x1f!\x7f\x80\xff"};
+        const std::string_view classes[] {whitespace, identifier, digits, neighbours};
+
+        std::string text;
+        text.reserve(length);
+        while (text.size() < length) {
+            std::string_view chars {classes[rng() % std::size(classes)]};
+            std::size_t run {1 + rng() % 80};
+            for (std::size_t i {0}; i < run && text.size() < length; ++i) {
+                if (rng() % 64 == 0) {
+                    text.push_back(static_cast<char>(rng() % 256));
+                } else {
+                    text.push_back(chars[rng() % chars.size()]);
+                }
+            }
+        }
+        return text;
+    }
+
+    // Compares every kernel against the scalar one from every starting position of many random buffers
+    // Returns the number of mismatches
+    std::uint64_t differentialCheck(const std::vector<const Kernels*>& kernels, std::uint64_t& comparisons) {
+        std::mt19937_64 rng {0xdcc};
+        const Kernels& scalar {Lexer::Scan::scalarKernels()};
+        std::uint64_t mismatches {0};
+
+        for (int round {0}; round < 4000; ++round) {
+            std::string text {randomRuns(rng, rng() % 300)};
+            const char* end {text.data() + text.size()};
+            for (const char* start {text.data()}; start <= end; ++start) {
+                for (const Kernels* candidate : kernels) {
+                    const Lexer::Scan::RunScanner pairs[][2] {
+                        {scalar.whitespace, candidate->whitespace},
+                        {scalar.identifier, candidate->identifier},
+                        {scalar.digits, candidate->digits}
+                    };
+                    for (const auto& pair : pairs) {
+                        ++comparisons;
+                        if (pair[0](start, end) != pair[1](start, end)) {
+                            if (mismatches == 0) {
+                                std::cerr << "Mismatch: " << candidate->name << " at offset " << (start - text.data())
+                                          << " of a " << text.size() << " byte buffer\n";
+                            }
+                            ++mismatches;
+                        }
+                    }
+                }
+            }
+        }
+        return mismatches;
+    }
+
+    // True if both runs gave the same tokens, symbol names and diagnostics
+    bool sameResult(const Token::TokenBuffer& leftTokens, const Sym::SymbolTable& leftSymbols,
+                    const Src::Diagnostics& leftDiagnostics, const Token::TokenBuffer& rightTokens,
+                    const Sym::SymbolTable& rightSymbols, const Src::Diagnostics& rightDiagnostics) {
+        if (leftTokens.size() != rightTokens.size() || leftSymbols.size() != rightSymbols.size()
+            || leftDiagnostics.size() != rightDiagnostics.size()) {
+            return false;
+        }
+        for (Token::TokenBuffer::Index i {0}; i < leftTokens.size(); ++i) {
+            if (!(leftTokens[i] == rightTokens[i]) || leftTokens[i].offset != rightTokens[i].offset) {
+                return false;
+            }
+        }
+        for (Sym::SymbolId id {0}; id < leftSymbols.size(); ++id) {
+            if (leftSymbols.name(id) != rightSymbols.name(id)) {
+                return false;
+            }
+        }
+        for (std::size_t i {0}; i < leftDiagnostics.size(); ++i) {
+            if (leftDiagnostics[i].offset != rightDiagnostics[i].offset
+                || leftDiagnostics[i].message != rightDiagnostics[i].message) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Lexes a mixed input with errors in it on 1 and then several threads, and checks the results match
+    bool chunkedCheck() {
+        std::string withErrors {Bench::syntheticSource(8 << 20, Bench::Mix::Mixed)};
+        for (std::size_t i {withErrors.size() / 7}; i < withErrors.size(); i += withErrors.size() / 7) {
+            withErrors[i] = '$';
+        }
+        const Src::SourceFile file {"synthetic.i", std::move(withErrors)};
+
+        Sym::SymbolTable serialSymbols;
+        Src::Diagnostics serialDiagnostics;
+        Token::TokenBuffer serialTokens {Lexer::lexFile(file, serialSymbols, serialDiagnostics, 1)};
+        for (std::size_t threads : {2, 3, 8}) {
+            Sym::SymbolTable symbols;
+            Src::Diagnostics diagnostics;
+            Token::TokenBuffer tokens {Lexer::lexFile(file, symbols, diagnostics, threads)};
+            if (!sameResult(serialTokens, serialSymbols, serialDiagnostics, tokens, symbols, diagnostics)) {
+                std::cerr << "Mismatch: lexing on " << threads << " threads differs from lexing on 1\n";
+                return false;
+            }
+        }
+        return true;
+    }
+
+    ///////////////////
+    /// Measurement ///
+    ///////////////////
+    struct Result {
+        Bench::Mix mix;
+        std::size_t requestedBytes;
+        std::size_t bytes;
+        std::uint64_t tokens;
+        int iterations;
+        double seconds;            // Per iteration
+        std::uint64_t allocations; // Per iteration
+
+        double tokensPerSecond() const { return static_cast<double>(tokens) / seconds; }
+        double bytesPerSecond() const { return static_cast<double>(bytes) / seconds; }
+        double allocationsPerToken() const {
+            return tokens == 0 ? 0 : static_cast<double>(allocations) / static_cast<double>(tokens);
+        }
+    };
+
+    // Lexes the file repeatedly until at least a fifth of a second has gone by, so tiny inputs still give a
+    // stable figure, and reports the averages of one run
+    Result measure(Bench::Mix mix, std::size_t bytes, std::size_t threads) {
+        const Src::SourceFile file {"synthetic.i", Bench::syntheticSource(bytes, mix)};
+        constexpr double minimumSeconds {0.2};
+
+        Result result {mix, bytes, file.text().size(), 0, 0, 0, 0};
+        std::uint64_t allocations {0};
+        auto start {Clock::now()};
+        do {
+            Sym::SymbolTable symbols;
+            Src::Diagnostics diagnostics;
+            std::uint64_t before {g_allocations.load(std::memory_order_relaxed)};
+            Token::TokenBuffer tokens {Lexer::lexFile(file, symbols, diagnostics, threads)};
+            allocations += g_allocations.load(std::memory_order_relaxed) - before;
+            result.tokens = tokens.size();
+            ++result.iterations;
+        } while (secondsSince(start) < minimumSeconds);
+
+        result.seconds = secondsSince(start) / result.iterations;
+        result.allocations = allocations / static_cast<std::uint64_t>(result.iterations);
+        return result;
+    }
+
+    // Time one kernel over a long unbroken run, in bytes per second
+    double kernelThroughput(Lexer::Scan::RunScanner kernel, const std::string& run) {
+        constexpr int repeats {20};
+        const char* sink {nullptr};
+        auto start {Clock::now()};
+        for (int i {0}; i < repeats; ++i) {
+            sink = kernel(run.data(), run.data() + run.size());
+        }
+        double seconds {secondsSince(start)};
+        if (sink != run.data() + run.size()) {
+            std::cerr << "Kernel stopped early\n";
+        }
+        return static_cast<double>(run.size()) * repeats / seconds;
+    }
+
+    struct KernelResult {
+        std::string_view name;
+        double whitespace;
+        double identifier;
+        double digits;
+    };
+
+    std::vector<KernelResult> measureKernels(const std::vector<const Kernels*>& kernels) {
+        constexpr std::size_t runBytes {16 << 20};
+        const std::string whitespaceRun(runBytes, ' ');
+        const std::string identifierRun(runBytes, 'a');
+        const std::string digitRun(runBytes, '7');
+
+        std::vector<KernelResult> results;
+        for (const Kernels* set : kernels) {
+            results.push_back({set->name, kernelThroughput(set->whitespace, whitespaceRun),
+                               kernelThroughput(set->identifier, identifierRun),
+                               kernelThroughput(set->digits, digitRun)});
+        }
+        return results;
+    }
+
+    //////////////
+    /// Output ///
+    //////////////
+    std::string jsonString(std::string_view text) {
+        std::string quoted {"\""};
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                quoted += '\\';
+                quoted += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                quoted += ' ';
+            } else {
+                quoted += c;
+            }
+        }
+        return quoted + "\"";
+    }
+
+    void printJson(const Options& options, std::uint64_t mismatches, bool chunkedIdentical,
+                   const std::vector<KernelResult>& kernels, const std::vector<Result>& results) {
+        std::ostringstream out;
+        out.precision(6);
+        out << "{\n";
+        out << "  \"benchmark\": \"lexer\",\n";
+        out << "  \"label\": " << jsonString(options.label) << ",\n";
+        out << "  \"kernels\": " << jsonString(Lexer::Scan::bestKernels().name) << ",\n";
+        out << "  \"threads\": " << options.threads << ",\n";
+        out << "  \"checks\": {\"ran\": " << (options.checks ? "true" : "false")
+            << ", \"kernel_mismatches\": " << mismatches
+            << ", \"chunked_identical\": " << (chunkedIdentical ? "true" : "false") << "},\n";
+
+        out << "  \"kernel_bytes_per_second\": [";
+        for (std::size_t i {0}; i < kernels.size(); ++i) {
+            out << (i == 0 ? "\n" : ",\n") << "    {\"name\": " << jsonString(kernels[i].name)
+                << ", \"whitespace\": " << kernels[i].whitespace << ", \"identifier\": " << kernels[i].identifier
+                << ", \"digits\": " << kernels[i].digits << "}";
+        }
+        out << (kernels.empty() ? "],\n" : "\n  ],\n");
+
+        out << "  \"results\": [";
+        for (std::size_t i {0}; i < results.size(); ++i) {
+            const Result& result {results[i]};
+            out << (i == 0 ? "\n" : ",\n") << "    {\"mix\": " << jsonString(Bench::mixName(result.mix))
+                << ", \"requested_bytes\": " << result.requestedBytes << ", \"bytes\": " << result.bytes << ", \"tokens\": " << result.tokens
+                << ", \"iterations\": " << result.iterations << ", \"seconds\": " << result.seconds
+                << ", \"tokens_per_second\": " << result.tokensPerSecond()
+                << ", \"bytes_per_second\": " << result.bytesPerSecond()
+                << ", \"allocations\": " << result.allocations
+                << ", \"allocations_per_token\": " << result.allocationsPerToken() << "}";
+        }
+        out << (results.empty() ? "]\n}\n" : "\n  ]\n}\n");
+        std::cout << out.str();
+    }
+
+    void printTable(const std::vector<KernelResult>& kernels, const std::vector<Result>& results) {
+        if (!kernels.empty()) {
+            std::cout << "Kernel throughput (GB/s) on 16 MB runs\n";
+            for (const KernelResult& kernel : kernels) {
+                std::cout << "\t" << kernel.name << "\twhitespace " << kernel.whitespace / 1e9
+                          << "\tidentifier " << kernel.identifier / 1e9 << "\tdigits " << kernel.digits / 1e9 << "\n";
+            }
+            std::cout << "\n";
+        }
+
+        std::cout << "Lexer::lexFile with " << Lexer::Scan::bestKernels().name << " kernels\n";
+        std::cout << "\tmix\t\tsize\tM tokens/s\tMB/s\tallocs/token\n";
+        for (const Result& result : results) {
+            std::string_view name {Bench::mixName(result.mix)};
+            std::cout << "\t" << name << (name.size() < 8 ? "\t\t" : "\t") << Bench::formatSize(result.requestedBytes) << "\t"
+                      << result.tokensPerSecond() / 1e6 << "\t\t" << result.bytesPerSecond() / 1e6 << "\t"
+                      << result.allocationsPerToken() << "\n";
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::invalid_argument& error) {
+        std::cerr << "Error: " << error.what() << "\n";
+        return 1;
+    }
+
+    std::uint64_t mismatches {0};
+    bool chunkedIdentical {true};
+    std::vector<KernelResult> kernels;
+    if (options.checks) {
+        std::vector<const Kernels*> available {availableKernels()};
+        std::uint64_t comparisons {0};
+        mismatches = differentialCheck(available, comparisons);
+        chunkedIdentical = chunkedCheck();
+        if (!options.json) {
+            std::cout << "Kernel check: " << comparisons << " comparisons, " << mismatches << " mismatches\n";
+            std::cout << "Chunked check: " << (chunkedIdentical ? "identical" : "differs") << "\n\n";
+        }
+        if (mismatches != 0 || !chunkedIdentical) {
+            return 1;
+        }
+        kernels = measureKernels(available);
+    }
+
+    // Each input is generated outside the timed region and freed before the next, so a 1G run only holds one input
+    std::vector<Result> results;
+    for (Bench::Mix mix : options.mixes) {
+        for (std::size_t size : options.sizes) {
+            results.push_back(measure(mix, size, options.threads));
+        }
+    }
+
+    if (options.json) {
+        printJson(options, mismatches, chunkedIdentical, kernels, results);
+    } else {
+        printTable(kernels, results);
+    }
+    return 0;
+}
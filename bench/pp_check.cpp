@@ -0,0 +1,262 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+// Differential check of the built in preprocessor against gcc's
+//   dcc_pp_check [corpus directory]
+// Preprocesses every .c file in the corpus directory, bench/pp_corpus by default, with Pp::preprocessFile and with
+// gcc -E -P, then tokenizes both outputs and compares them token by token. Line breaks and spacing between tokens
+// are not compared, since the two place them differently without changing the meaning
+// Then does the same for long generated chains of macros, each expanding to the next, and fails if doubling a chain's
+// length more than triples the time it takes, as that means some part of expansion is not linear
+// Then preprocesses every .c file in the corpus's errors directory, each of which starts with a comment holding the
+// error gcc gives for it, and checks both gcc and dcc fail on it with an error containing that message
+// Exits with 1 and shows where each file first differs, or if either preprocessor reports an error where it should not
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../preprocessor/preprocessor.h"
+#include "../helpers/process.h"
+
+namespace {
+    constexpr std::string_view g_defaultCorpus {"bench/pp_corpus"};
+
+    // Given to both preprocessors, so the corpus can check -D and -U
+    const std::vector<std::string> g_defines {"FROM_COMMAND_LINE=42", "FLAG_ONLY", "UNDEFINED_ON_COMMAND_LINE"};
+    const std::vector<std::string> g_undefines {"UNDEFINED_ON_COMMAND_LINE"};
+
+    // Just the text of each token, which is everything that matters after preprocessing
+    std::vector<std::string> tokenTexts(std::string_view text) {
+        std::string spliced;
+        std::vector<Pp::TokenizeError> errors;
+        std::vector<std::string> texts;
+        for (const auto& token : Pp::tokenize(text, spliced, errors)) {
+            texts.emplace_back(token.text);
+        }
+        return texts;
+    }
+
+    // Preprocesses file, or text given as standard input if file is empty
+    std::string gccPreprocess(const std::filesystem::path& file, const std::filesystem::path& includePath,
+                              std::string_view text = {}) {
+        // -undef leaves out gcc's target macros, which the built in preprocessor defines differently
+        std::vector<std::string> command {"gcc", "-E", "-P", "-undef", "-I" + includePath.string()};
+        for (const auto& define : g_defines) {
+            command.push_back("-D" + define);
+        }
+        for (const auto& undefine : g_undefines) {
+            command.push_back("-U" + undefine);
+        }
+        if (file.empty()) {
+            command.insert(command.end(), {"-x", "c", "-"});
+        } else {
+            command.push_back(file.string());
+        }
+        Proc::ProcessResult result {Proc::run(command, text)};
+        if (!result.succeeded()) {
+            throw std::runtime_error("gcc -E failed with exit code " + std::to_string(result.exitCode));
+        }
+        return std::move(result.output);
+    }
+
+    // The tokens either side of index, to show where a difference is
+    std::string around(const std::vector<std::string>& tokens, std::size_t index) {
+        std::string text;
+        std::size_t first {index > 5 ? index - 5 : 0};
+        for (std::size_t i {first}; i < std::min(tokens.size(), index + 6); ++i) {
+            text += i == index ? " [" + tokens[i] + "]" : " " + tokens[i];
+        }
+        if (index >= tokens.size()) {
+            text += " [end]";
+        }
+        return text;
+    }
+
+    // Returns false, having said why, if the built in preprocessor failed or its tokens differ from gcc's
+    bool compare(const std::string& name, const Pp::Result& ours, std::string_view gccText) {
+        if (!ours.succeeded()) {
+            std::cout << name << ": dcc reported errors\n";
+            for (const auto& error : ours.errors) {
+                std::cout << "  " << error << "\n";
+            }
+            return false;
+        }
+
+        std::vector<std::string> expected {tokenTexts(gccText)};
+        std::vector<std::string> actual {tokenTexts(ours.text)};
+        auto [expectedAt, actualAt] {std::mismatch(expected.begin(), expected.end(), actual.begin(), actual.end())};
+        if (expectedAt == expected.end() && actualAt == actual.end()) {
+            std::cout << name << ": " << expected.size() << " tokens match\n";
+            return true;
+        }
+        std::size_t index {static_cast<std::size_t>(expectedAt - expected.begin())};
+        std::cout << name << ": differs at token " << index << "\n"
+                  << "  gcc:" << around(expected, index) << "\n"
+                  << "  dcc:" << around(actual, index) << "\n";
+        return false;
+    }
+
+    Pp::Options checkOptions(const std::filesystem::path& includePath) {
+        Pp::Options options;
+        options.includePaths.push_back(includePath);
+        options.defines = g_defines;
+        options.undefines = g_undefines;
+        return options;
+    }
+
+    bool check(const std::filesystem::path& file, const std::filesystem::path& includePath) {
+        Pp::IncludeCache cache;
+        Pp::Result ours {Pp::preprocessFile(file, checkOptions(includePath), cache)};
+        return compare(file.filename().string(), ours, ours.succeeded() ? gccPreprocess(file, includePath) : "");
+    }
+
+    // Returns false, having said why, unless both preprocessors reject the file and dcc's errors hold the message in
+    // its first line comment
+    bool checkError(const std::filesystem::path& file, const std::filesystem::path& includePath) {
+        std::string name {file.filename().string()};
+        std::string expected;
+        {
+            std::ifstream stream {file};
+            std::getline(stream, expected);
+        }
+        if (!expected.starts_with("// ")) {
+            std::cout << name << ": the first line must be a comment holding the expected error\n";
+            return false;
+        }
+        expected.erase(0, 3);
+
+        // Through the shell, to read gcc's errors in place of its output
+        Proc::ProcessResult gcc {Proc::run({"sh", "-c", "gcc -E -P -undef -I\"$1\" \"$2\" 2>&1 >/dev/null", "sh",
+                                            includePath.string(), file.string()})};
+        if (gcc.succeeded()) {
+            std::cout << name << ": gcc accepted it, so it does not check an error\n";
+            return false;
+        }
+        if (gcc.output.find(expected) == std::string::npos) {
+            std::cout << name << ": expected " << expected << ", gcc reported\n" << gcc.output;
+            return false;
+        }
+        Pp::IncludeCache cache;
+        Pp::Result ours {Pp::preprocessFile(file, checkOptions(includePath), cache)};
+        if (ours.succeeded()) {
+            std::cout << name << ": dcc accepted it, expected " << expected << "\n";
+            return false;
+        }
+        if (std::none_of(ours.errors.begin(), ours.errors.end(),
+                         [&](const std::string& error) { return error.find(expected) != std::string::npos; })) {
+            std::cout << name << ": expected " << expected << ", dcc reported\n";
+            for (const auto& error : ours.errors) {
+                std::cout << "  " << error << "\n";
+            }
+            return false;
+        }
+        std::cout << name << ": fails as gcc does\n";
+        return true;
+    }
+
+    // length macros, each expanding to the next, and then a use of the first
+    // Every step adds to the hidesets of the tokens it makes, so these catch hidesets that get slower as they grow
+    std::string objectChain(std::size_t length) {
+        std::string text;
+        for (std::size_t i {0}; i < length; ++i) {
+            text += "#define A" + std::to_string(i) + " A" + std::to_string(i + 1) + "\n";
+        }
+        return text + "#define A" + std::to_string(length) + " 7\nint chained = A0;\n";
+    }
+
+    std::string functionChain(std::size_t length) {
+        std::string text;
+        for (std::size_t i {0}; i < length; ++i) {
+            text += "#define F" + std::to_string(i) + "(x) F" + std::to_string(i + 1) + "(x)\n";
+        }
+        return text + "#define F" + std::to_string(length) + "(x) x\nint chained = F0(7);\n";
+    }
+
+    // Checks a generated chain at two lengths. Returns false if either differs from gcc or the longer one is too slow
+    template <typename Generate>
+    bool checkChain(const std::string& name, std::size_t length, Generate generate,
+                    const std::filesystem::path& includePath) {
+        std::chrono::duration<double> times[2];
+        for (std::size_t run {0}; run < 2; ++run) {
+            std::size_t runLength {length << run};
+            std::string text {generate(runLength)};
+            Pp::IncludeCache cache;
+            auto start {std::chrono::steady_clock::now()};
+            Pp::Result ours {Pp::preprocessText(name, text, checkOptions(includePath), cache)};
+            times[run] = std::chrono::steady_clock::now() - start;
+            if (!compare(name + " of " + std::to_string(runLength), ours,
+                         ours.succeeded() ? gccPreprocess({}, includePath, text) : "")) {
+                return false;
+            }
+        }
+        double growth {times[1].count() / times[0].count()};
+        std::cout << name << ": " << times[0].count() << " s then " << times[1].count() << " s at double the length\n";
+        if (growth > 3) {
+            std::cout << name << ": doubling the length multiplied the time by " << growth << "\n";
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::filesystem::path corpus {argc > 1 ? argv[1] : g_defaultCorpus};
+    std::error_code error;
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator{corpus, error}) {
+        if (entry.path().extension() == ".c") {
+            files.push_back(entry.path());
+        }
+    }
+    if (error || files.empty()) {
+        std::cerr << "No .c files found in " << corpus.string() << "\n";
+        return 1;
+    }
+    std::sort(files.begin(), files.end());
+
+    std::size_t failures {0};
+    for (const auto& file : files) {
+        try {
+            failures += check(file, corpus / "include") ? 0 : 1;
+        } catch (const std::exception& problem) {
+            std::cout << file.string() << ": " << problem.what() << "\n";
+            ++failures;
+        }
+    }
+    try {
+        failures += checkChain("object-like chain", 50000, objectChain, corpus / "include") ? 0 : 1;
+        failures += checkChain("function-like chain", 50000, functionChain, corpus / "include") ? 0 : 1;
+    } catch (const std::exception& problem) {
+        std::cout << "chains: " << problem.what() << "\n";
+        ++failures;
+    }
+
+    std::vector<std::filesystem::path> errorFiles;
+    for (const auto& entry : std::filesystem::directory_iterator{corpus / "errors", error}) {
+        if (entry.path().extension() == ".c") {
+            errorFiles.push_back(entry.path());
+        }
+    }
+    std::sort(errorFiles.begin(), errorFiles.end());
+    for (const auto& file : errorFiles) {
+        try {
+            failures += checkError(file, corpus / "include") ? 0 : 1;
+        } catch (const std::exception& problem) {
+            std::cout << file.string() << ": " << problem.what() << "\n";
+            ++failures;
+        }
+    }
+
+    std::cout << files.size() << " files, 2 chains and " << errorFiles.size() << " errors, " << failures
+              << " differ\n";
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,12 @@
+// Macros from -D and -U, which dcc_pp_check passes to both preprocessors
+int from_define = FROM_COMMAND_LINE;
+
+#ifdef FLAG_ONLY
+int flag = FLAG_ONLY;
+#endif
+
+#ifdef UNDEFINED_ON_COMMAND_LINE
+int should_not_appear;
+#else
+int undefined_on_command_line;
+#endif
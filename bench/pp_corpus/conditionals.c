@@ -0,0 +1,78 @@
+// #if arithmetic, defined, and skipping
+#define FEATURE 1
+#define LEVEL 3
+#define FUNCTION_LIKE(x) x
+
+#if FEATURE
+int feature_on;
+#else
+int feature_off;
+#endif
+
+#if LEVEL > 2 && defined(FEATURE) && defined FUNCTION_LIKE
+int level_high;
+#elif LEVEL > 1
+int level_middle;
+#else
+int level_low;
+#endif
+
+#if !defined(MISSING) || MISSING / 0
+int short_circuit;
+#endif
+
+#if 0 && (1 / 0)
+int never;
+#endif
+
+#if -1 < 0u
+int unsigned_compare_true;
+#else
+int unsigned_compare_false;
+#endif
+
+#if (2 + 3 * 4 - 10 / 2 % 3) == 12 && (1 << 4) == 16 && (~0 & 0xff) == 255 && (6 ^ 3) == 5
+int arithmetic;
+#endif
+
+#if LEVEL == 3 ? FEATURE : 0
+int conditional_operator;
+#endif
+
+#if UNKNOWN_IDENTIFIER
+int unknown_is_zero_wrong;
+#else
+int unknown_is_zero;
+#endif
+
+#if 'A' == 65 && '\n' == 10 && 0x10 == 16 && 010 == 8 && 10L == 10 && 10u == 10
+int constants;
+#endif
+
+#if FUNCTION_LIKE(LEVEL) == 3
+int expanded_in_condition;
+#endif
+
+#ifdef FEATURE
+#  ifndef LEVEL
+int nested_wrong;
+#  elif LEVEL == 3
+int nested_right;
+#  endif
+#endif
+
+#if 0
+#error this group is skipped
+#include "does_not_exist.h"
+#if garbage (((
+#endif
+#else
+int after_skipped;
+#endif
+
+#ifdef FEATURE
+#undef FEATURE
+#endif
+#ifndef FEATURE
+int undefined_now;
+#endif
@@ -0,0 +1,4 @@
+// #if with no expression
+#define EMPTY
+#if EMPTY
+#endif
@@ -0,0 +1,3 @@
+// missing expression between '(' and ')'
+#if ()
+#endif
@@ -0,0 +1,3 @@
+// missing ')' in expression
+#if (1 + 2
+#endif
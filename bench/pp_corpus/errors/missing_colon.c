@@ -0,0 +1,3 @@
+// '?' without following ':'
+#if 1 ? 2
+#endif
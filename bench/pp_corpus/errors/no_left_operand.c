@@ -0,0 +1,3 @@
+// operator '*' has no left operand
+#if * 2
+#endif
@@ -0,0 +1,4 @@
+// operator '*' has no right operand
+#define TIMES 2 *
+#if TIMES
+#endif
@@ -0,0 +1,3 @@
+// operator '&&' has no right operand
+#if defined(__STDC__) && )
+#endif
@@ -0,0 +1,31 @@
+// Function-like macros, argument pre-expansion and the blue paint that stops recursion
+#define ID(x) x
+#define ADD(a, b) ((a) + (b))
+#define FIRST(a, b) a
+#define SECOND(a, b) b
+#define NOTHING() nothing
+#define CALL(f, x) f(x)
+#define RECURSE(x) RECURSE(x + 1)
+#define F(x) G(x) * 2
+#define G(x) F(x) + 1
+#define LPAREN (
+#define TWICE(x) x x
+#define NO_ARGS
+
+int nested = ID(ID(ID(ID(5))));
+int sum = ADD(ADD(1, 2), ADD(3, 4));
+int parens = FIRST((1, 2), 3) + SECOND(4, (5, 6));
+int empty_argument = ADD(, 7) + ADD(8, );
+int no_parameters = NOTHING() + NOTHING ( );
+int not_a_call = ID + 1;
+int through = CALL(ID, 9) + CALL(ID, (1, 2));
+int recursive = RECURSE(0);
+int mutual = F(3) + G(4);
+int spread = ADD(
+    10,
+    20
+);
+int twice = TWICE(ID(1) +) 0;
+int name_then_paren = ID NO_ARGS (12);
+#define APPLY_LATER ID
+int later = APPLY_LATER(13);
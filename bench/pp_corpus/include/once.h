@@ -0,0 +1,4 @@
+#pragma once
+
+#define ONCE_VALUE 2
+int once_included;
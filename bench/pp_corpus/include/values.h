@@ -0,0 +1,4 @@
+#ifndef VALUES_H
+#define VALUES_H
+int from_values = 3;
+#endif
@@ -0,0 +1,18 @@
+// #include with guards, #pragma once, computed includes and __has_include
+#include "guarded.h"
+#include "guarded.h"
+#include "once.h"
+#include "once.h"
+#include <guarded.h>
+
+#define HEADER "values.h"
+#include HEADER
+#define ANGLED <values.h>
+#undef VALUES_H
+#include ANGLED
+
+#if __has_include("guarded.h") && !__has_include("missing.h")
+int has_include;
+#endif
+
+int total = GUARDED_VALUE + ONCE_VALUE + from_values;
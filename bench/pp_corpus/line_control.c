@@ -0,0 +1,11 @@
+// __LINE__, #line, __COUNTER__ and tokens spread over lines
+int first_line = __LINE__;
+#define LINE_HERE __LINE__
+int macro_line = LINE_HERE;
+int joined = 1 + \
+    2;
+#line 100
+int after_line = __LINE__;
+int counters[] = {__COUNTER__, __COUNTER__, __COUNTER__};
+int spread_line = LINE_HERE
+    + __LINE__;
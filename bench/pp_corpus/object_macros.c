@@ -0,0 +1,25 @@
+// Object-like macros, redefinition and rescanning
+#define ZERO 0
+#define ONE 1
+#define TWO (ONE + ONE)
+#define EMPTY
+#define SELF SELF + 1
+#define INDIRECT_A INDIRECT_B
+#define INDIRECT_B INDIRECT_A
+#define PLUS +
+#define SAME_AGAIN 1 + 2
+#define SAME_AGAIN 1 + 2
+
+int zero = ZERO;
+int two = TWO * TWO;
+int empty = EMPTY 3 EMPTY;
+int self = SELF;
+int indirect = INDIRECT_A;
+int plus = 1 PLUS PLUS 2;
+int again = SAME_AGAIN;
+
+#undef ONE
+#define ONE 11
+int redefined = TWO;
+#undef ONE
+int undefined = ONE;
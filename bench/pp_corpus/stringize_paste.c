@@ -0,0 +1,27 @@
+// The # and ## operators
+#define STR(x) #x
+#define XSTR(x) STR(x)
+#define CAT(a, b) a ## b
+#define XCAT(a, b) CAT(a, b)
+#define CAT3(a, b, c) a ## b ## c
+#define VALUE 42
+#define PREFIX my_
+
+const char* plain = STR(hello world);
+const char* spaced = STR(  lots   of    space  );
+const char* quoted = STR("a \"string\"" and 'c' '\'' "\\");
+const char* unexpanded = STR(VALUE);
+const char* expanded = XSTR(VALUE);
+const char* empty = STR();
+const char* punctuation = STR(a+b; c->d [e] {f});
+
+int CAT(var, 1) = 1;
+int XCAT(PREFIX, name) = 2;
+int CAT(PREFIX, name) = 3;
+int CAT3(a, b, c) = 4;
+int number = CAT(12, 34);
+int CAT(, left_empty) = 5;
+int CAT(right_empty, ) = 6;
+int shift = 1 CAT(<, <) 2;
+int pasted_value = CAT(VAL, UE);
+double exponent = CAT(1e, 10);
@@ -0,0 +1,19 @@
+// Variadic macros, __VA_ARGS__ and the GNU comma swallowing extension
+#define COUNT(...) count(__VA_ARGS__)
+#define LOG(format, ...) printf(format, __VA_ARGS__)
+#define GNU_LOG(format, ...) printf(format, ## __VA_ARGS__)
+#define FIRST_OF(first, ...) first
+#define REST_OF(first, ...) __VA_ARGS__
+#define STR_ALL(...) #__VA_ARGS__
+#define PASS(...) COUNT(__VA_ARGS__)
+
+int none = COUNT();
+int one = COUNT(1);
+int many = COUNT(1, 2, (3, 4), 5);
+int log = LOG("%d %d", 1, 2);
+int gnu_some = GNU_LOG("%d", 1);
+int gnu_none = GNU_LOG("none");
+int first = FIRST_OF(7, 8, 9);
+int rest = REST_OF(7, 8, 9);
+const char* all = STR_ALL(a, b,c ,  d);
+int passed = PASS(x, y);
@@ -0,0 +1,178 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+// End to end check of code generation, by running what dcc builds
+//   dcc_run_check path/to/dcc [programs]
+// Generates programs whose main returns an expression over every operator the compiler supports, builds each one with
+// dcc file.c -o file, runs it and checks the exit status is the value of the expression, as worked out here
+// Exits with 1 and shows the first few programs that built wrongly or returned the wrong value
+
+#include <charconv>
+#include <climits>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <unistd.h>
+
+#include "../helpers/process.h"
+
+namespace {
+    struct Expression {
+        std::string text;
+        std::int64_t value;
+    };
+
+    // Values outside int, and anything else C leaves undefined, are thrown away so the program means one thing
+    bool fitsInt(std::int64_t value) {
+        return value >= INT_MIN && value <= INT_MAX;
+    }
+
+    // An expression nested up to depth levels, or nothing if the one picked would be undefined
+    std::optional<Expression> generate(std::mt19937& random, int depth) {
+        std::uniform_int_distribution<int> choice {0, depth > 0 ? 8 : 0};
+        switch (choice(random)) {
+            case 0: {
+                std::int64_t value {std::uniform_int_distribution<int>{0, 1000}(random)};
+                return Expression{std::to_string(value), value};
+            }
+            case 1: {
+                // Operands of unary operators are bracketed, since two minus signs in a row would lex as --, and an
+                // operand that is a binary operation would otherwise only take the unary operator on its left side
+                auto operand {generate(random, depth - 1)};
+                if (!operand || operand->value == INT_MIN) {
+                    return std::nullopt;
+                }
+                return Expression{"-(" + operand->text + ")", -operand->value};
+            }
+            case 2: {
+                auto operand {generate(random, depth - 1)};
+                if (!operand) {
+                    return std::nullopt;
+                }
+                return Expression{"~(" + operand->text + ")", ~operand->value};
+            }
+            case 3: {
+                auto operand {generate(random, depth - 1)};
+                if (!operand) {
+                    return std::nullopt;
+                }
+                return Expression{"(" + operand->text + ")", operand->value};
+            }
+            default: {
+                auto left {generate(random, depth - 1)};
+                auto right {generate(random, depth - 1)};
+                if (!left || !right) {
+                    return std::nullopt;
+                }
+                // Both sides are bracketed, so the text means what the value says whatever the precedence
+                std::string text {"(" + left->text + ")"};
+                std::int64_t a {left->value};
+                std::int64_t b {right->value};
+                std::int64_t value {};
+                switch (std::uniform_int_distribution<int>{0, 4}(random)) {
+                    case 0: text += " + "; value = a + b; break;
+                    case 1: text += " - "; value = a - b; break;
+                    case 2: text += " * "; value = a * b; break;
+                    case 3:
+                        if (b == 0 || (a == INT_MIN && b == -1)) {
+                            return std::nullopt;
+                        }
+                        text += " / ";
+                        value = a / b;
+                        break;
+                    default:
+                        if (b == 0 || (a == INT_MIN && b == -1)) {
+                            return std::nullopt;
+                        }
+                        text += " % ";
+                        value = a % b;
+                        break;
+                }
+                if (!fitsInt(value)) {
+                    return std::nullopt;
+                }
+                return Expression{text + "(" + right->text + ")", value};
+            }
+        }
+    }
+
+    Expression generateDefined(std::mt19937& random, int depth) {
+        while (true) {
+            if (auto expression {generate(random, depth)}) {
+                return *expression;
+            }
+        }
+    }
+
+    // Builds and runs one program. Returns what went wrong, or nothing if it returned the right value
+    std::optional<std::string> check(const std::string& dcc, const std::filesystem::path& directory,
+                                     const Expression& expression) {
+        std::filesystem::path source {directory / "program.c"};
+        std::filesystem::path executable {directory / "program"};
+        {
+            std::ofstream file {source};
+            file << "int main(void) {\n    return " << expression.text << ";\n}\n";
+        }
+        std::filesystem::remove(executable);
+
+        Proc::ProcessResult built {Proc::run({dcc, source.string(), "-o", executable.string()})};
+        if (!built.succeeded()) {
+            return "dcc failed with exit code " + std::to_string(built.exitCode) + ": " + built.output;
+        }
+        Proc::ProcessResult ran {Proc::run({executable.string()})};
+        int expected {static_cast<int>(expression.value & 0xff)};
+        if (ran.exitCode != expected) {
+            return "returned " + std::to_string(ran.exitCode) + " instead of " + std::to_string(expected);
+        }
+        return std::nullopt;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        std::cerr << "Usage: dcc_run_check path/to/dcc [programs]\n";
+        return 1;
+    }
+    std::string dcc {argv[1]};
+    std::size_t programs {200};
+    if (argc > 2) {
+        std::string_view count {argv[2]};
+        auto [ptr, ec] {std::from_chars(count.data(), count.data() + count.size(), programs)};
+        if (ec != std::errc{} || ptr != count.data() + count.size() || programs == 0) {
+            std::cerr << "Error: programs must be a positive number\n";
+            return 1;
+        }
+    }
+
+    std::filesystem::path directory {std::filesystem::temp_directory_path()
+                                     / ("dcc_run_check_" + std::to_string(getpid()))};
+    std::filesystem::create_directories(directory);
+
+    std::mt19937 random {12345};
+    std::size_t failures {0};
+    for (std::size_t i {0}; i < programs; ++i) {
+        // Small ones first, so the simplest failing program is the first one shown
+        Expression expression {generateDefined(random, 1 + static_cast<int>(i * 5 / programs))};
+        std::optional<std::string> problem;
+        try {
+            problem = check(dcc, directory, expression);
+        } catch (const std::exception& error) {
+            problem = error.what();
+        }
+        if (problem && ++failures <= 5) {
+            std::cout << "return " << expression.text << ";\n  " << *problem << "\n";
+        }
+    }
+    std::filesystem::remove_all(directory);
+
+    std::cout << programs << " programs, " << failures << " wrong\n";
+    return failures == 0 ? 0 : 1;
+}
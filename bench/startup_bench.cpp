@@ -0,0 +1,165 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+// Measures what dcc costs before it does any real work, since a build can start it thousands of times
+//   dcc_startup_bench path/to/dcc [runs]
+// Reports, for each of runs fresh processes:
+//   - /bin/true, the floor for starting any process at all
+//   - dcc --help, an early exit that runs all of dcc's static initialisation and nothing else
+//   - time to first token, from exec until a process linking the lexer gets its first token back from a Scanner
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../lexer/lexer.h"
+
+extern char** environ;
+
+namespace {
+    constexpr std::string_view g_firstTokenStr {"--first-token"};
+
+    std::uint64_t nowNanoseconds() {
+        timespec time {};
+        clock_gettime(CLOCK_MONOTONIC, &time);
+        return static_cast<std::uint64_t>(time.tv_sec) * 1'000'000'000 + static_cast<std::uint64_t>(time.tv_nsec);
+    }
+
+    // Runs the child's half of the time to first token measurement, printing when the token arrived
+    int firstToken() {
+        Sym::SymbolTable symbols;
+        Src::Diagnostics diagnostics;
+        Lexer::Scanner scanner {"int main(void) { return 0; }", symbols, diagnostics};
+        Token::Token token;
+        scanner.next(token);
+        std::uint64_t arrived {nowNanoseconds()};
+        std::cout << arrived << "\n";
+        return token.kind == Token::IntT ? 0 : 1;
+    }
+
+    // Starts arguments[0] with its output going to a pipe, waits for it to exit and returns everything it printed
+    // Returns false if it could not be started or did not exit cleanly
+    bool run(const std::vector<std::string>& arguments, std::string& output) {
+        int pipeEnds[2];
+        if (pipe(pipeEnds) == -1) {
+            return false;
+        }
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, pipeEnds[1], STDOUT_FILENO);
+        posix_spawn_file_actions_addclose(&actions, pipeEnds[0]);
+
+        std::vector<char*> argv;
+        for (const auto& argument : arguments) {
+            argv.push_back(const_cast<char*>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        pid_t child {};
+        int spawned {posix_spawn(&child, argv[0], &actions, nullptr, argv.data(), environ)};
+        posix_spawn_file_actions_destroy(&actions);
+        close(pipeEnds[1]);
+        if (spawned != 0) {
+            close(pipeEnds[0]);
+            return false;
+        }
+
+        output.clear();
+        char buffer[4096];
+        ssize_t count {};
+        while ((count = read(pipeEnds[0], buffer, sizeof(buffer))) > 0) {
+            output.append(buffer, static_cast<std::size_t>(count));
+        }
+        close(pipeEnds[0]);
+
+        int status {};
+        waitpid(child, &status, 0);
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    }
+
+    // Prints the median and mean of a set of times in microseconds
+    void report(std::string_view name, std::vector<double> micros) {
+        std::sort(micros.begin(), micros.end());
+        double total {0};
+        for (double time : micros) {
+            total += time;
+        }
+        std::cout << "\t" << name << "\tmedian " << micros[micros.size() / 2] << " us\tmean "
+                  << total / static_cast<double>(micros.size()) << " us\n";
+    }
+
+    // Times whole runs of a command, from just before it is spawned until it has exited
+    bool timeCommand(std::string_view name, const std::vector<std::string>& arguments, int runs) {
+        std::vector<double> micros;
+        std::string output;
+        for (int i {0}; i < runs; ++i) {
+            std::uint64_t start {nowNanoseconds()};
+            if (!run(arguments, output)) {
+                std::cout << "Could not run " << arguments[0] << "\n";
+                return false;
+            }
+            micros.push_back(static_cast<double>(nowNanoseconds() - start) / 1e3);
+        }
+        report(name, std::move(micros));
+        return true;
+    }
+
+    // Times from just before a child is spawned until it has its first token
+    bool timeFirstToken(const std::string& self, int runs) {
+        std::vector<double> micros;
+        std::string output;
+        for (int i {0}; i < runs; ++i) {
+            std::uint64_t start {nowNanoseconds()};
+            std::uint64_t arrived {0};
+            if (!run({self, std::string{g_firstTokenStr}}, output)
+                || std::from_chars(output.data(), output.data() + output.size(), arrived).ec != std::errc{}) {
+                std::cout << "First token child failed\n";
+                return false;
+            }
+            micros.push_back(static_cast<double>(arrived - start) / 1e3);
+        }
+        report("first token", std::move(micros));
+        return true;
+    }
+}
+
+int main(const int argc, char* argv[]) {
+    if (argc > 1 && argv[1] == g_firstTokenStr) {
+        return firstToken();
+    }
+    if (argc < 2) {
+        std::cout << "Usage: " << argv[0] << " path/to/dcc [runs]\n";
+        return 1;
+    }
+
+    std::string dcc {argv[1]};
+    int runs {200};
+    if (argc > 2) {
+        std::string_view count {argv[2]};
+        std::from_chars(count.data(), count.data() + count.size(), runs);
+    }
+
+    // posix_spawn does not search PATH, so the benchmark needs a full path to itself
+    std::string self {std::string{"/proc/self/exe"}};
+    std::vector<char> resolved(4096);
+    ssize_t length {readlink(self.c_str(), resolved.data(), resolved.size() - 1)};
+    if (length > 0) {
+        self.assign(resolved.data(), static_cast<std::size_t>(length));
+    }
+
+    std::cout << "Startup over " << runs << " runs\n";
+    bool ok {timeCommand("/bin/true", {"/bin/true"}, runs)
+             && timeCommand("dcc --help", {dcc, "--help"}, runs)
+             && timeFirstToken(self, runs)};
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,157 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <random>
+
+#include "synthetic_source.h"
+
+namespace Bench {
+    constexpr std::array<std::string_view, 5> mixNames {"identifiers", "operators", "literals", "long_lines", "mixed"};
+
+    std::string_view mixName(Mix mix) {
+        return mixNames[static_cast<std::size_t>(mix)];
+    }
+
+    std::optional<Mix> parseMix(std::string_view name) {
+        for (Mix mix : allMixes) {
+            if (mixName(mix) == name) {
+                return mix;
+            }
+        }
+        return std::nullopt;
+    }
+
+    // Appends one operand and operator at a time, in proportions set by the mix
+    class ExpressionWriter {
+        std::mt19937_64 m_rng;
+        Mix m_mix;
+        std::string& m_text;
+
+        static constexpr std::string_view binaryOperators[] {" + ", " - ", " * ", " / ", " % "};
+        static constexpr std::string_view unaryOperators[] {"-", "~", "--"};
+
+        std::uint64_t below(std::uint64_t limit) { return m_rng() % limit; }
+
+        void identifier() {
+            if (m_mix == Mix::Identifiers) {
+                m_text += "generated_identifier_with_a_long_prefix_";
+            } else {
+                m_text += "value_";
+            }
+            m_text += std::to_string(below(64));
+        }
+
+        void literal() {
+            m_text += std::to_string(below(m_mix == Mix::Literals ? 2'000'000'000 : 1000));
+        }
+
+        void operand() {
+            switch (m_mix) {
+                case Mix::Identifiers:
+                    below(8) == 0 ? literal() : identifier();
+                    return;
+                case Mix::Operators:
+                    // Single characters wrapped in as much punctuation as possible
+                    m_text += unaryOperators[below(std::size(unaryOperators))];
+                    m_text += "(~";
+                    m_text += below(2) == 0 ? "x" : "1";
+                    m_text += ")";
+                    return;
+                case Mix::Literals:
+                    below(8) == 0 ? identifier() : literal();
+                    return;
+                case Mix::LongLines:
+                case Mix::Mixed:
+                    if (below(4) == 0) {
+                        m_text += "(";
+                        m_text += unaryOperators[below(std::size(unaryOperators))];
+                        literal();
+                        m_text += ")";
+                    } else {
+                        below(2) == 0 ? identifier() : literal();
+                    }
+                    return;
+            }
+        }
+    public:
+        ExpressionWriter(std::uint64_t seed, Mix mix, std::string& text)
+            : m_rng{seed}
+            , m_mix{mix}
+            , m_text{text}
+        {}
+
+        void expression(int terms) {
+            operand();
+            for (int term {1}; term < terms; ++term) {
+                // The operators mix leaves out the spaces, so nearly every byte is a token
+                std::string_view op {binaryOperators[below(std::size(binaryOperators))]};
+                m_text += m_mix == Mix::Operators ? op.substr(1, 1) : op;
+                operand();
+            }
+        }
+
+        std::uint64_t functionNumber() { return below(100'000); }
+    };
+
+    std::string syntheticSource(std::size_t bytes, Mix mix, std::uint64_t seed) {
+        std::string text;
+        text.reserve(bytes + 16384);
+        ExpressionWriter writer {seed, mix, text};
+
+        // Long lines put each whole function on one line, with a few thousand terms in its return expression
+        bool longLines {mix == Mix::LongLines};
+        std::string_view indent {mix == Mix::Identifiers ? "                                                " : "    "};
+        // Small long line inputs get shorter lines, so they are not many times bigger than asked for
+        int terms {longLines ? static_cast<int>(std::clamp<std::size_t>(bytes / 16, 8, 1000)) : 8};
+
+        while (text.size() < bytes) {
+            text += "int f" + std::to_string(writer.functionNumber()) + "(void) {";
+            text += longLines ? " " : "\n";
+            if (!longLines) {
+                text += indent;
+            }
+            text += "return ";
+            writer.expression(terms);
+            text += longLines ? "; }\n" : ";\n}\n\n";
+        }
+        return text;
+    }
+
+    std::optional<std::size_t> parseSize(std::string_view text) {
+        std::size_t value {};
+        auto [ptr, ec] {std::from_chars(text.data(), text.data() + text.size(), value)};
+        if (ec != std::errc{} || ptr == text.data()) {
+            return std::nullopt;
+        }
+        std::string_view suffix {ptr, static_cast<std::size_t>(text.data() + text.size() - ptr)};
+        if (suffix.empty()) {
+            return value;
+        }
+        if (suffix == "K") {
+            return value << 10;
+        }
+        if (suffix == "M") {
+            return value << 20;
+        }
+        if (suffix == "G") {
+            return value << 30;
+        }
+        return std::nullopt;
+    }
+
+    std::string formatSize(std::size_t bytes) {
+        constexpr std::array<std::string_view, 3> suffixes {"G", "M", "K"};
+        constexpr std::array<int, 3> shifts {30, 20, 10};
+        for (std::size_t i {0}; i < suffixes.size(); ++i) {
+            std::size_t unit {std::size_t {1} << shifts[i]};
+            if (bytes >= unit && bytes % unit == 0) {
+                return std::to_string(bytes / unit) + std::string{suffixes[i]};
+            }
+        }
+        return std::to_string(bytes);
+    }
+}
@@ -0,0 +1,40 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_SYNTHETIC_SOURCE_H
+#define DCC_SYNTHETIC_SOURCE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Generates text that looks like gcc -E -P output, for benchmarking
+// The same size, mix and seed always give the same text, so results can be compared between versions
+namespace Bench {
+    enum class Mix {
+        Identifiers, // Long names and deep indentation, so most bytes are in identifier and whitespace runs
+        Operators,   // Dense punctuation with single character operands
+        Literals,    // Mostly integer constants
+        LongLines,   // Whole functions on lines of several kilobytes
+        Mixed,       // A bit of everything, the closest to ordinary code
+    };
+
+    inline constexpr Mix allMixes[] {Mix::Identifiers, Mix::Operators, Mix::Literals, Mix::LongLines, Mix::Mixed};
+
+    std::string_view mixName(Mix mix);
+
+    std::optional<Mix> parseMix(std::string_view name);
+
+    // At least bytes long, made of whole functions of the form int fN(void) { return expression; }
+    std::string syntheticSource(std::size_t bytes, Mix mix, std::uint64_t seed = 42);
+
+    // Parses sizes like 4096, 1K, 64M or 1G
+    std::optional<std::size_t> parseSize(std::string_view text);
+
+    // The shortest of those forms that is exact, such as 1K or 1536
+    std::string formatSize(std::size_t bytes);
+}
+
+#endif //DCC_SYNTHETIC_SOURCE_H
@@ -0,0 +1,318 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <string>
+
+#include <unistd.h>
+
+#include "command_line.h"
+#include "compile_cache.h"
+#include "../helpers/thread_pool.h"
+#include "../helpers/trace.h"
+
+namespace Driver {
+    constexpr std::string_view g_stopAtLexStr{ "--lex"};
+    constexpr Stop g_stopAtLexCode {Stop::Lex};
+
+    constexpr std::string_view g_stopAtParseStr { "--parse"};
+    constexpr Stop g_stopAtParseCode {Stop::Parse};
+
+    constexpr std::string_view g_stopAtCodegenStr { "--codegen"};
+    constexpr Stop g_stopAtCodegenCode {Stop::Codegen};
+
+    constexpr std::string_view g_stopAtEmissionStr {"-S"};
+    constexpr Stop g_stopAtEmissionCode {Stop::Emission};
+
+    // -c stops after assembling an object file. -o names the output, which is an executable unless -S or -c is given
+    // In both modes the assembly is piped straight into gcc, so no .s file is written. -o - writes assembly to stdout
+    constexpr std::string_view g_objectStr {"-c"};
+    constexpr std::string_view g_outputStr {"-o"};
+
+    constexpr std::string_view g_symbolStatsStr {"--symbol-stats"};
+
+    // -jN or -j N compiles N files at once, or lexes and parses a single file on N threads. -j on its own uses every core
+    constexpr std::string_view g_threadsStr {"-j"};
+
+    // Prints the wall and CPU time spent on each file
+    constexpr std::string_view g_timingsStr {"--timings"};
+
+    // Prints the time, CPU time and allocations of each phase of the compiler, with peak memory use and the number of
+    // tokens, nodes and instructions made
+    constexpr std::string_view g_timeReportStr {"--time-report"};
+
+    // --trace=<file> writes a Chrome trace of every unit and phase, for viewing in Perfetto or chrome://tracing
+    constexpr std::string_view g_traceStr {"--trace="};
+
+    // Preprocess with gcc -E instead of the built in preprocessor
+    constexpr std::string_view g_gccPreprocessStr {"--gcc-preprocess"};
+
+    // -I<dir> adds an include directory, -D<name>[=value] defines a macro and -U<name> undefines one, after every -D.
+    // All of them also accept the value as the next argument
+    constexpr std::string_view g_includeStr {"-I"};
+    constexpr std::string_view g_defineStr {"-D"};
+    constexpr std::string_view g_undefineStr {"-U"};
+
+    // --server keeps dcc running to compile for --client invocations, which talk to it over a Unix socket
+    constexpr std::string_view g_serverStr {"--server"};
+    constexpr std::string_view g_clientStr {"--client"};
+    constexpr std::string_view g_socketStr {"--socket="};
+
+    // --cache reuses output from earlier compiles of the same preprocessed source, kept in defaultCacheDirectory() or
+    // the directory given with --cache=. --cache-size= limits it to a number of megabytes
+    // --cache-stats prints how well it is doing, and can be given without any source files
+    constexpr std::string_view g_cacheStr {"--cache"};
+    constexpr std::string_view g_cacheDirectoryStr {"--cache="};
+    constexpr std::string_view g_cacheSizeStr {"--cache-size="};
+    constexpr std::string_view g_cacheStatsStr {"--cache-stats"};
+
+    // A source file named - is read from standard input
+    constexpr std::string_view g_standardInputStr {"-"};
+
+    constexpr std::string_view g_helpStr {"--help"};
+
+    // Printed for --help. Kept as a single constant so an early exit does no work beyond writing it out
+    constexpr std::string_view g_helpText {
+        "Usage: dcc path/to/file.c... [options]\n"
+        "Options:\n"
+        "  --lex            stop after lexing\n"
+        "  --parse          stop after parsing\n"
+        "  --codegen        stop after assembly generation\n"
+        "  -S               stop after writing the assembly file\n"
+        "  -c               stop after writing an object file\n"
+        "  -o <file>        write the output to file, linking an executable unless -S or -c is given\n"
+        "  --symbol-stats   print symbol table statistics\n"
+        "  -jN, -j N, -j    compile N files at once, or lex and parse one file on N threads. -j alone uses every core\n"
+        "  --timings        print the wall and CPU time taken by each file\n"
+        "  --time-report    print the time and allocations spent in each phase of the compiler\n"
+        "  --trace=<file>   write a Chrome trace of each file and phase to file\n"
+        "  -I<dir>          add a directory to the include search path\n"
+        "  -D<name>[=value] define a macro\n"
+        "  -U<name>         undefine a macro, after every -D\n"
+        "  --gcc-preprocess preprocess with gcc -E instead of the built in preprocessor\n"
+        "  --server         stay running and compile for --client invocations\n"
+        "  --client         send this compile to a running --server, or compile here if there is none\n"
+        "  --socket=<path>  socket for --server and --client to use\n"
+        "  --cache[=<dir>]  reuse the output of earlier compiles of the same code\n"
+        "  --cache-size=<N> keep the cache under N megabytes\n"
+        "  --cache-stats    print the cache's hit and miss counts\n"
+        "  -                read the source from standard input\n"
+        "  --help           print this message\n"
+    };
+
+    std::optional<int> parseCommandLine(const std::vector<std::string_view>& arguments, Invocation& invocation,
+                                        std::ostream& out, const FilePath& defaultCache) {
+        Options& options {invocation.options};
+        std::size_t& threads {invocation.threads};
+        options.preprocessor.systemPaths = Pp::defaultSystemPaths();
+
+        // Sort the arguments into the source files and options, ensuring that options use valid syntax
+        for (std::size_t i {0}; i < arguments.size(); ++i) {
+            std::string_view option {arguments[i]};
+
+            if (!option.starts_with('-') || option == g_standardInputStr) {
+                invocation.files.emplace_back(option);
+            } else if (option == g_helpStr) {
+                out << g_helpText;
+                return 0;
+            } else if (option == g_stopAtLexStr) {
+                options.stop = g_stopAtLexCode;
+            } else if (option == g_stopAtParseStr ) {
+                options.stop = g_stopAtParseCode;
+            } else if (option == g_stopAtCodegenStr) {
+                options.stop = g_stopAtCodegenCode;
+            } else if (option == g_stopAtEmissionStr) {
+                options.stop = g_stopAtEmissionCode;
+            } else if (option == g_objectStr) {
+                options.objectOnly = true;
+            } else if (option.starts_with(g_outputStr)) {
+                std::string_view path {option.substr(g_outputStr.size())};
+                if (path.empty() && i + 1 < arguments.size()) {
+                    path = arguments[++i];
+                }
+                if (path.empty()) {
+                    out << "Error: " << g_outputStr << " needs a file name\n";
+                    return 1;
+                }
+                options.outputFileName = path;
+            } else if (option == g_symbolStatsStr) {
+                options.printSymbolStats = true;
+            } else if (option == g_timingsStr) {
+                invocation.printTimings = true;
+            } else if (option == g_timeReportStr) {
+                options.timeReport = true;
+            } else if (option.starts_with(g_traceStr)) {
+                invocation.tracePath = option.substr(g_traceStr.size());
+                if (invocation.tracePath.empty()) {
+                    out << "Error: " << g_traceStr << " needs a file name\n";
+                    return 1;
+                }
+            } else if (option == g_gccPreprocessStr) {
+                options.gccPreprocess = true;
+            } else if (option == g_serverStr) {
+                invocation.server = true;
+            } else if (option == g_clientStr) {
+                invocation.client = true;
+            } else if (option.starts_with(g_socketStr)) {
+                invocation.socketPath = option.substr(g_socketStr.size());
+            } else if (option == g_cacheStr) {
+                options.cacheDirectory = defaultCache;
+            } else if (option.starts_with(g_cacheDirectoryStr)) {
+                options.cacheDirectory = option.substr(g_cacheDirectoryStr.size());
+            } else if (option.starts_with(g_cacheSizeStr)) {
+                std::string_view size {option.substr(g_cacheSizeStr.size())};
+                std::uint64_t megabytes {0};
+                auto [ptr, ec] {std::from_chars(size.data(), size.data() + size.size(), megabytes)};
+                if (ec != std::errc{} || ptr != size.data() + size.size() || megabytes == 0) {
+                    out << "Error: " << g_cacheSizeStr << " needs a positive number of megabytes\n";
+                    return 1;
+                }
+                options.cacheSize = megabytes << 20;
+            } else if (option == g_cacheStatsStr) {
+                invocation.printCacheStats = true;
+            } else if (option.starts_with(g_includeStr) || option.starts_with(g_defineStr)
+                       || option.starts_with(g_undefineStr)) {
+                std::string_view value {option.substr(2)};
+                if (value.empty() && i + 1 < arguments.size()) {
+                    value = arguments[++i];
+                }
+                if (value.empty()) {
+                    out << "Error: " << option << " needs a value\n";
+                    return 1;
+                }
+                if (option.starts_with(g_includeStr)) {
+                    options.preprocessor.includePaths.emplace_back(value);
+                } else if (option.starts_with(g_defineStr)) {
+                    options.preprocessor.defines.emplace_back(value);
+                } else {
+                    options.preprocessor.undefines.emplace_back(value);
+                }
+            } else if (option.starts_with(g_threadsStr)) {
+                std::string_view count {option.substr(g_threadsStr.size())};
+                // The count may be in the next argument, as long as it is a number and not the source file
+                if (count.empty() && i + 1 < arguments.size() && !arguments[i + 1].empty()
+                    && std::isdigit(static_cast<unsigned char>(arguments[i + 1].front()))) {
+                    count = arguments[++i];
+                }
+                if (count.empty()) {
+                    threads = Threads::hardwareThreads();
+                } else {
+                    auto [ptr, ec] {std::from_chars(count.data(), count.data() + count.size(), threads)};
+                    if (ec != std::errc{} || ptr != count.data() + count.size() || threads == 0) {
+                        out << "Error: " << g_threadsStr << " needs a positive number of threads\n";
+                        return 1;
+                    }
+                }
+            } else {
+                // If the option is not valid, exit with an error code
+                out <<"Error: unrecognised option. Valid options are: " << g_stopAtLexStr << ", " << g_stopAtParseStr
+                << ", " << g_stopAtCodegenStr << ", " << g_stopAtEmissionStr << ", " << g_objectStr << ", "
+                << g_outputStr << ", " << g_symbolStatsStr << ", " << g_threadsStr << "N, " << g_timingsStr << ", "
+                << g_timeReportStr << ", " << g_traceStr << "<file>, " << g_includeStr << "<dir>, " << g_defineStr << "<name>, " << g_undefineStr << "<name>, " << g_gccPreprocessStr
+                << ", " << g_serverStr << ", " << g_clientStr << ", " << g_socketStr << "<path>, " << g_cacheStr << "[=<dir>], " << g_cacheSizeStr
+                << "<N>, " << g_cacheStatsStr << ", " << g_helpStr << ". \n";
+                return 1;
+            }
+        }
+
+        if (invocation.server) {
+            return std::nullopt;
+        }
+        if (invocation.files.empty() && invocation.printCacheStats) {
+            if (options.cacheDirectory.empty()) {
+                options.cacheDirectory = defaultCache;
+            }
+            return std::nullopt;
+        }
+        if (invocation.files.empty()) {
+            out<<"No source file given";
+            return 1;
+        }
+        // One output name cannot be shared between several files
+        if (invocation.files.size() > 1 && !options.outputFileName.empty()) {
+            out << "Error: " << g_outputStr << " cannot be used with more than one source file\n";
+            return 1;
+        }
+        if (std::count(invocation.files.begin(), invocation.files.end(), FilePath{g_standardInputStr}) > 1) {
+            out << "Error: standard input can only be read once\n";
+            return 1;
+        }
+        return std::nullopt;
+    }
+
+    int runInvocation(Invocation& invocation, Pp::IncludeCache& includeCache, std::ostream& out) {
+        for (const FilePath& fileName : invocation.files) {
+            if (fileName == g_standardInputStr) {
+                continue;
+            }
+            //Check that the filename is a c file
+            if (fileName.extension().string() != ".c") {
+                out<<"File must be a .c file";
+                return 1;
+            }
+
+            // Check that file exists at the chosen location
+            if (!std::filesystem::exists(fileName)) {
+                out<<"File "<< fileName <<" could not be found\n";
+                return 1;
+            }
+        }
+
+        // Threads go to compiling several files at once if there are several, or to lexing and parsing the only one
+        std::size_t jobs {invocation.files.size() > 1 ? invocation.threads : 1};
+        invocation.options.frontEndThreads = invocation.files.size() > 1 ? 1 : invocation.threads;
+
+        if (!invocation.tracePath.empty()) {
+            Trace::enable();
+        }
+        Stopwatch stopwatch {true};
+        std::vector<UnitResult> results {compileFiles(invocation.files, invocation.options, jobs, includeCache)};
+        Timing total {stopwatch.stop()};
+
+        // Every worker has finished, so nothing is still recording
+        if (!invocation.tracePath.empty() && !Trace::write(invocation.tracePath)) {
+            out << "Error: could not write trace to " << invocation.tracePath.string() << "\n";
+        }
+
+        int exitCode {0};
+        for (const auto& result : results) {
+            out << result.output;
+            exitCode = std::max(exitCode, result.exitCode);
+        }
+        if (invocation.printTimings) {
+            printTimings(results, total, out);
+        }
+        if (invocation.options.timeReport) {
+            TimeReport report;
+            for (const auto& result : results) {
+                report.merge(*result.report);
+            }
+            printTimeReport(report, out);
+        }
+        if (invocation.printCacheStats && !invocation.options.cacheDirectory.empty()) {
+            Cache::CompileCache{invocation.options.cacheDirectory, invocation.options.cacheSize}.printStats(out);
+        }
+        return exitCode;
+    }
+
+    FilePath defaultCacheDirectory() {
+        if (const char* cacheHome {std::getenv("XDG_CACHE_HOME")}; cacheHome && *cacheHome) {
+            return FilePath{cacheHome} / "dcc";
+        }
+        if (const char* home {std::getenv("HOME")}; home && *home) {
+            return FilePath{home} / ".cache" / "dcc";
+        }
+        return FilePath{"/tmp"} / ("dcc-cache-" + std::to_string(getuid()));
+    }
+
+    FilePath defaultSocketPath() {
+        if (const char* runtimeDirectory {std::getenv("XDG_RUNTIME_DIR")}; runtimeDirectory && *runtimeDirectory) {
+            return FilePath{runtimeDirectory} / "dcc.sock";
+        }
+        return FilePath{"/tmp"} / ("dcc-" + std::to_string(getuid()) + ".sock");
+    }
+}
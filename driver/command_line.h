@@ -0,0 +1,54 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_COMMAND_LINE_H
+#define DCC_COMMAND_LINE_H
+
+#include <cstddef>
+#include <optional>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "driver.h"
+
+namespace Driver {
+    // Everything a dcc command line asks for
+    struct Invocation {
+        Options options;
+        // "-" stands for standard input, whose text goes in options.standardInput
+        std::vector<FilePath> files;
+        // From -j. Spent on compiling several files at once, or on lexing the only one
+        std::size_t threads {1};
+        bool printTimings {false};
+        // --trace=file. Empty means no tracing
+        FilePath tracePath;
+        // --cache-stats. Printed once every file has been compiled
+        bool printCacheStats {false};
+        // --server. Stay running and compile for clients instead of compiling anything now
+        bool server {false};
+        // --client. Hand the rest of the command line to a running server
+        bool client {false};
+        // --socket=path. Empty means defaultSocketPath()
+        FilePath socketPath;
+    };
+
+    // $XDG_CACHE_HOME/dcc, or ~/.cache/dcc if that is not set
+    FilePath defaultCacheDirectory();
+
+    // Reads arguments, not including the program name, into invocation
+    // Returns an exit code if dcc should stop straight away, having written the help text or the problem to out
+    // --cache without a directory means defaultCache, which a server is given by its client, whose environment it is
+    std::optional<int> parseCommandLine(const std::vector<std::string_view>& arguments, Invocation& invocation,
+                                        std::ostream& out, const FilePath& defaultCache = defaultCacheDirectory());
+
+    // Checks and compiles the files an invocation names, writes everything they printed to out and returns the exit code
+    // Headers are loaded through includeCache, so a caller compiling many invocations can keep them between runs
+    int runInvocation(Invocation& invocation, Pp::IncludeCache& includeCache, std::ostream& out);
+
+    // $XDG_RUNTIME_DIR/dcc.sock, or a per user path in /tmp if that is not set
+    FilePath defaultSocketPath();
+}
+
+#endif //DCC_COMMAND_LINE_H
@@ -0,0 +1,252 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+#include "compile_cache.h"
+#include "../helpers/sha256.h"
+
+namespace Cache {
+    namespace fs = std::filesystem;
+
+    // Bumped whenever the compiler's output changes, or the layout of the cache does
+    constexpr std::string_view g_version {"dcc 1"};
+
+    // Identifies the running compiler, so a rebuilt dcc never uses entries an older build made
+    // The executable's size and modification time are used rather than its hash, so finding them costs nothing
+    const std::string& compilerIdentity() {
+        static const std::string identity {[]() {
+            std::string text {g_version};
+            std::error_code error;
+            fs::path executable {fs::read_symlink("/proc/self/exe", error)};
+            if (!error) {
+                text += " " + std::to_string(fs::file_size(executable, error));
+                text += " " + std::to_string(fs::last_write_time(executable, error).time_since_epoch().count());
+            }
+            return text;
+        }()};
+        return identity;
+    }
+
+    Key makeKey(std::string_view preprocessedText, Kind kind) {
+        Hash::Sha256 hash;
+        hash.update(compilerIdentity());
+        // Each part ends in a byte that cannot appear in the identity or the kind, so no two inputs hash the same text
+        hash.update(std::string_view{"\0", 1});
+        hash.update(kind == Kind::Object ? "object" : "assembly");
+        hash.update(std::string_view{"\0", 1});
+        hash.update(preprocessedText);
+        return hash.hexDigest();
+    }
+
+    // Holds an exclusive flock on a file for as long as it exists
+    // flock locks belong to the open file, so threads of one process exclude each other as well as other processes
+    class FileLock {
+        int m_fd;
+    public:
+        explicit FileLock(const fs::path& file)
+            : m_fd{open(file.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644)}
+        {
+            if (m_fd >= 0 && flock(m_fd, LOCK_EX) != 0) {
+                close(m_fd);
+                m_fd = -1;
+            }
+        }
+
+        ~FileLock() {
+            if (m_fd >= 0) {
+                close(m_fd);
+            }
+        }
+
+        FileLock(const FileLock&) = delete;
+        FileLock& operator=(const FileLock&) = delete;
+
+        bool held() const { return m_fd >= 0; }
+    };
+
+    Stats readStats(const fs::path& file) {
+        Stats stats;
+        std::ifstream in {file};
+        std::string name;
+        std::uint64_t value;
+        while (in >> name >> value) {
+            if (name == "hits") stats.hits = value;
+            else if (name == "misses") stats.misses = value;
+            else if (name == "evictions") stats.evictions = value;
+            else if (name == "bytes") stats.bytes = value;
+        }
+        return stats;
+    }
+
+    void writeStats(const fs::path& file, const Stats& stats) {
+        std::ofstream out {file, std::ios::trunc};
+        out << "hits " << stats.hits << "\nmisses " << stats.misses << "\nevictions " << stats.evictions
+            << "\nbytes " << stats.bytes << "\n";
+    }
+
+    // Deletes the least recently used entries until the cache is comfortably under maxBytes, so the next few stores
+    // do not each have to evict again
+    // Counts the size afresh while doing so, which also corrects any drift in stats.bytes from entries deleted by hand
+    void evict(const fs::path& directory, std::uint64_t maxBytes, Stats& stats) {
+        struct Entry {
+            fs::file_time_type lastUsed;
+            std::uint64_t size;
+            fs::path path;
+        };
+        std::vector<Entry> entries;
+        std::uint64_t total {0};
+        std::error_code error;
+        // Entries live in subdirectories named after the first two characters of their key
+        for (const auto& subdirectory : fs::directory_iterator{directory, error}) {
+            if (subdirectory.path().filename().native().size() != 2 || !subdirectory.is_directory(error)) {
+                continue;
+            }
+            for (const auto& entry : fs::directory_iterator{subdirectory.path(), error}) {
+                std::uint64_t size {entry.file_size(error)};
+                if (error) {
+                    continue;
+                }
+                entries.push_back({entry.last_write_time(error), size, entry.path()});
+                total += size;
+            }
+        }
+
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastUsed < b.lastUsed; });
+        std::uint64_t target {maxBytes / 10 * 9};
+        for (const auto& entry : entries) {
+            if (total <= target) {
+                break;
+            }
+            if (fs::remove(entry.path, error)) {
+                total -= entry.size;
+                ++stats.evictions;
+            }
+        }
+        stats.bytes = total;
+    }
+
+    CompileCache::CompileCache(fs::path directory, std::uint64_t maxBytes)
+        : m_directory{std::move(directory)}
+        , m_maxBytes{maxBytes}
+    {}
+
+    CompileCache::~CompileCache() {
+        if (m_pendingHits.load() != 0 || m_pendingMisses.load() != 0) {
+            updateStats([](Stats&) {});
+        }
+    }
+
+    fs::path CompileCache::entryPath(const Key& key, Kind kind) const {
+        return m_directory / key.substr(0, 2) / (key.substr(2) + (kind == Kind::Object ? ".o" : ".s"));
+    }
+
+    template <typename Change>
+    bool CompileCache::updateStats(Change change) const {
+        std::error_code error;
+        fs::create_directories(m_directory, error);
+        FileLock lock {m_directory / "lock"};
+        if (!lock.held()) {
+            return false;
+        }
+        Stats stats {readStats(m_directory / "stats")};
+        stats.hits += m_pendingHits.exchange(0);
+        stats.misses += m_pendingMisses.exchange(0);
+        change(stats);
+        writeStats(m_directory / "stats", stats);
+        return true;
+    }
+
+    std::optional<std::string> CompileCache::find(const Key& key, Kind kind) const {
+        fs::path path {entryPath(key, kind)};
+        std::optional<std::string> contents;
+        // Entries are only ever renamed into place whole, so an entry that opens is complete. If it is evicted while
+        // being read, the open file still reads to the end
+        if (std::ifstream in {path, std::ios::binary}) {
+            std::string text {std::istreambuf_iterator<char>{in}, {}};
+            if (!in.bad()) {
+                contents = std::move(text);
+                std::error_code error;
+                fs::last_write_time(path, fs::file_time_type::clock::now(), error);
+            }
+        }
+        ++(contents ? m_pendingHits : m_pendingMisses);
+        return contents;
+    }
+
+    void CompileCache::store(const Key& key, Kind kind, std::string_view contents) const {
+        fs::path path {entryPath(key, kind)};
+        std::error_code error;
+        fs::create_directories(path.parent_path(), error);
+        fs::create_directories(m_directory / "tmp", error);
+        if (error) {
+            return;
+        }
+
+        // Written somewhere private first, so nobody can read the entry before it is complete
+        static std::atomic<std::uint64_t> s_temporaryCount {0};
+        fs::path temporary {m_directory / "tmp" / (key + "." + std::to_string(getpid()) + "."
+                                                    + std::to_string(s_temporaryCount++))};
+        {
+            std::ofstream out {temporary, std::ios::binary};
+            out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+            if (!out.flush()) {
+                out.close();
+                fs::remove(temporary, error);
+                return;
+            }
+        }
+
+        // Renamed under the lock so the size of any entry being replaced is known, and counted only once
+        bool updated {updateStats([&](Stats& stats) {
+            std::uint64_t replacedSize {fs::file_size(path, error)};
+            if (error) {
+                replacedSize = 0;
+            }
+            fs::rename(temporary, path, error);
+            if (error) {
+                fs::remove(temporary, error);
+                return;
+            }
+            stats.bytes = stats.bytes + contents.size() - std::min(replacedSize, stats.bytes + contents.size());
+            if (stats.bytes > m_maxBytes) {
+                evict(m_directory, m_maxBytes, stats);
+            }
+        })};
+        // Without the lock the entry is not added, so the temporary would otherwise be left behind uncounted
+        if (!updated) {
+            fs::remove(temporary, error);
+        }
+    }
+
+    Stats CompileCache::stats() const {
+        Stats stats;
+        {
+            FileLock lock {m_directory / "lock"};
+            stats = readStats(m_directory / "stats");
+        }
+        stats.hits += m_pendingHits.load();
+        stats.misses += m_pendingMisses.load();
+        return stats;
+    }
+
+    void CompileCache::printStats(std::ostream& out) const {
+        Stats stats {this->stats()};
+        std::uint64_t lookups {stats.hits + stats.misses};
+        out << "Compile cache: " << m_directory.string() << "\n";
+        out << "\thits:      " << stats.hits << "\n";
+        out << "\tmisses:    " << stats.misses << "\n";
+        out << "\thit rate:  " << (lookups == 0 ? 0 : stats.hits * 100 / lookups) << "%\n";
+        out << "\tevictions: " << stats.evictions << "\n";
+        out << "\tsize:      " << stats.bytes << " of " << m_maxBytes << " bytes\n";
+    }
+}
@@ -0,0 +1,85 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_COMPILE_CACHE_H
+#define DCC_COMPILE_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+// An on disk cache of compiler output, keyed by a hash of the preprocessed source, so a translation unit that has not
+// changed since it was last compiled skips lexing, parsing and code generation
+// Any number of dcc processes can share one cache directory. Entries are written to a temporary file and renamed into
+// place, so a reader never sees half an entry, and the stats are only changed under a lock
+// Lookups do not take the lock. Hits and misses are counted in memory and added to the stats when the next entry is
+// stored or the CompileCache goes away, so units that all hit never wait on each other
+// The cache is an optimisation only. Anything going wrong with it, such as a full disk, is treated as a miss
+namespace Cache {
+    // What an entry holds
+    enum class Kind {
+        Assembly,
+        Object,
+    };
+
+    // Names one entry. Two compiles share a key only if they would produce the same output
+    using Key = std::string;
+
+    // Counted across every process using the cache since it was created
+    struct Stats {
+        std::uint64_t hits {0};
+        std::uint64_t misses {0};
+        // Entries deleted to keep the cache under its size limit
+        std::uint64_t evictions {0};
+        // Total size of every entry
+        std::uint64_t bytes {0};
+    };
+
+    // Hashes preprocessed text together with the compiler's version and build and the kind of output wanted
+    // There are no options that change code generation, so nothing else about the command line affects the output
+    Key makeKey(std::string_view preprocessedText, Kind kind);
+
+    class CompileCache {
+        std::filesystem::path m_directory;
+        std::uint64_t m_maxBytes;
+        // Lookups since the stats were last written
+        mutable std::atomic<std::uint64_t> m_pendingHits {0};
+        mutable std::atomic<std::uint64_t> m_pendingMisses {0};
+
+        std::filesystem::path entryPath(const Key& key, Kind kind) const;
+
+        // Runs change on the stats while holding the cache's lock, adding in the pending lookups as well
+        // Returns false without running change if the lock could not be taken
+        template <typename Change>
+        bool updateStats(Change change) const;
+    public:
+        // The directory is created when the first entry is stored
+        // When storing takes the cache over maxBytes the least recently used entries are deleted
+        CompileCache(std::filesystem::path directory, std::uint64_t maxBytes);
+        // Writes out any lookups not yet added to the stats
+        ~CompileCache();
+
+        CompileCache(const CompileCache&) = delete;
+        CompileCache& operator=(const CompileCache&) = delete;
+
+        // Returns the entry for key, counting a hit or a miss
+        // A hit marks the entry as recently used. Takes no lock
+        std::optional<std::string> find(const Key& key, Kind kind) const;
+
+        // Adds or replaces the entry for key
+        void store(const Key& key, Kind kind, std::string_view contents) const;
+
+        // Includes this object's lookups not yet written out
+        Stats stats() const;
+
+        // Prints the stats, the size limit and where the cache is
+        void printStats(std::ostream& out) const;
+    };
+}
+
+#endif //DCC_COMPILE_CACHE_H
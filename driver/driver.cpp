@@ -0,0 +1,638 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <algorithm>
+#include <ctime>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <type_traits>
+
+#include <sys/resource.h>
+
+#include "driver.h"
+#include "compile_cache.h"
+#include "../lexer/lexer.h"
+#include "../parser/parser.h"
+#include "../assembly_generator/assembly_generator.h"
+#include "../tacky/tacky_generator.h"
+#include "../assembly_emitter/assembly_emitter.h"
+#include "../helpers/process.h"
+#include "../helpers/thread_pool.h"
+#include "../helpers/trace.h"
+
+namespace Driver {
+    std::chrono::nanoseconds cpuClock(clockid_t clock) {
+        timespec now {};
+        clock_gettime(clock, &now);
+        return std::chrono::seconds{now.tv_sec} + std::chrono::nanoseconds{now.tv_nsec};
+    }
+
+    std::chrono::nanoseconds childCpu() {
+        rusage usage {};
+        getrusage(RUSAGE_CHILDREN, &usage);
+        return std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec}
+            + std::chrono::microseconds{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+    }
+
+    Stopwatch::Stopwatch(bool wholeProcess)
+        : m_wall{std::chrono::steady_clock::now()}
+        , m_cpu{wholeProcess ? cpuClock(CLOCK_PROCESS_CPUTIME_ID) + childCpu() : cpuClock(CLOCK_THREAD_CPUTIME_ID)}
+        , m_wholeProcess{wholeProcess}
+    {}
+
+    Timing Stopwatch::stop() const {
+        auto cpu {m_wholeProcess ? cpuClock(CLOCK_PROCESS_CPUTIME_ID) + childCpu() : cpuClock(CLOCK_THREAD_CPUTIME_ID)};
+        return Timing{std::chrono::steady_clock::now() - m_wall, cpu - m_cpu};
+    }
+
+    void addTime(Timing& total, const Timing& time) {
+        total.wall += time.wall;
+        total.cpu += time.cpu;
+    }
+
+    // A file named - in the argument list stands for standard input, and -o - for standard output
+    bool isStandardInput(const FilePath& fileName) {
+        return fileName.native() == "-";
+    }
+
+    // Runs gcc -E and returns what it wrote, read through a pipe so nothing is written next to the source file
+    std::string runPreprocessor(const FilePath& fileName, const Options& driverOptions, Timing& time) {
+        const Pp::Options& options {driverOptions.preprocessor};
+        std::vector<std::string> command {"gcc", "-E", "-P"};
+        for (const auto& includePath : options.includePaths) {
+            command.push_back("-I" + includePath.string());
+        }
+        for (const auto& define : options.defines) {
+            command.push_back("-D" + define);
+        }
+        for (const auto& undefine : options.undefines) {
+            command.push_back("-U" + undefine);
+        }
+        std::string_view input;
+        if (isStandardInput(fileName)) {
+            command.emplace_back("-x");
+            command.emplace_back("c");
+            input = driverOptions.standardInput;
+        }
+        command.push_back(fileName.string());
+
+        Proc::ProcessResult result {Proc::run(command, input)};
+        time.cpu += result.cpuTime;
+        // If gcc could not preprocess the file, error and exit. It will already have said why on stderr
+        if (!result.succeeded()) {
+            throw std::runtime_error("Error: gcc preprocess aborted with error code " + std::to_string(result.exitCode)
+                                     + "\n");
+        }
+        return std::move(result.output);
+    }
+
+    // The cache only holds finished output, so it is not used when stopping early, or when the stats of a real run
+    // are wanted
+    bool usesCache(const Options& options) {
+        return !options.cacheDirectory.empty() && (options.stop == Stop::None || options.stop == Stop::Emission)
+            && !options.printSymbolStats && !(options.objectOnly && isStandardInput(options.outputFileName));
+    }
+
+    // -c caches the object file, so a hit skips gcc as well. Everything else caches the assembly
+    Cache::Kind cacheKind(const Options& options) {
+        return options.objectOnly && options.stop != Stop::Emission ? Cache::Kind::Object : Cache::Kind::Assembly;
+    }
+
+    // Where -c, or linking without -o, puts its output
+    FilePath objectFileName(const FilePath& source, const Options& options) {
+        if (!options.outputFileName.empty()) {
+            return options.outputFileName;
+        }
+        FilePath fileName {options.workingDirectory / (isStandardInput(source) ? FilePath{"stdin.o"} : source.filename())};
+        fileName.replace_extension(".o");
+        return fileName;
+    }
+
+    // Throws std::runtime_error if the file cannot be written
+    void writeFile(const FilePath& fileName, std::string_view contents) {
+        std::ofstream file {fileName, std::ios::binary};
+        if (!file.write(contents.data(), static_cast<std::streamsize>(contents.size()))) {
+            throw std::runtime_error("failed to write " + fileName.string() + "\n");
+        }
+    }
+
+    // Everything a unit carries from the front end to the back end
+    struct Unit {
+        UnitResult result;
+        std::ostringstream out;
+        Ctx::CompilationContext context;
+        // Empty if the unit failed or stopped before code generation
+        std::optional<Ast::Program> abstractSyntaxTree;
+        // Set once code generation has produced assembly that still needs to go through gcc
+        std::string assembly;
+        FilePath builtFileName;
+        // Set when the unit's output goes in the cache
+        std::optional<Cache::Key> cacheKey;
+        // Output of the kind cacheKind gives, found in the cache
+        std::optional<std::string> cachedOutput;
+    };
+
+    // Charges the time and allocations between its construction and destruction to a phase of the unit's time report,
+    // and records it as a span for --trace
+    // Without either option it does nothing, not even read a clock
+    class PhaseScope {
+        TimeReport* m_report;
+        std::string_view m_name;
+        std::optional<Stopwatch> m_stopwatch;
+        Alloc::Counts m_allocations;
+        Trace::Span m_span;
+    public:
+        PhaseScope(Unit& unit, std::string_view name)
+            : m_report{unit.result.report ? &*unit.result.report : nullptr}
+            , m_name{name}
+            , m_span{name}
+        {
+            m_span.arg("file", unit.result.source.native());
+            if (m_report) {
+                m_allocations = Alloc::threadCounts();
+                m_stopwatch.emplace();
+            }
+        }
+
+        ~PhaseScope() {
+            if (m_report) {
+                m_report->add(m_name, m_stopwatch->stop(), Alloc::threadCounts() - m_allocations);
+            }
+        }
+
+        PhaseScope(const PhaseScope&) = delete;
+        PhaseScope& operator=(const PhaseScope&) = delete;
+
+        // Metadata for the trace span. Does nothing unless tracing
+        Trace::Span& span() { return m_span; }
+    };
+
+    // Runs step as a phase of the unit and returns what it returns
+    // A step that takes a PhaseScope& is given the phase's scope, to attach metadata to its span
+    template <typename Step>
+    decltype(auto) measure(Unit& unit, std::string_view phase, Step step) {
+        PhaseScope scope {unit, phase};
+        if constexpr (std::is_invocable_v<Step, PhaseScope&>) {
+            return step(scope);
+        } else {
+            return step();
+        }
+    }
+
+    // Work done in a child process, which the thread's own clock does not see
+    void addChildTime(Unit& unit, std::string_view phase, const Timing& time) {
+        addTime(unit.result.time, time);
+        if (unit.result.report) {
+            unit.result.report->add(phase, time, {});
+        }
+    }
+
+    // Preprocess, lex and parse
+    void runFrontEnd(Unit& unit, const Options& options, Pp::IncludeCache& includeCache,
+                     const Cache::CompileCache* cache) {
+        const FilePath& source {unit.result.source};
+        // Diagnostics for standard input name it <stdin>, or whatever the caller chose
+        const FilePath fileName {isStandardInput(source) ? options.workingDirectory / options.standardInputName : source};
+        std::ostringstream& out {unit.out};
+
+        // Run preprocessor
+        // The built in one hands its output straight to the lexer, along with a map back to the original files and
+        // lines so errors point at what the user wrote. gcc -E is still available, and its output is read from a pipe
+        Src::SourceFile sourceFile;
+        if (options.gccPreprocess) {
+            try {
+                Timing gccTime;
+                sourceFile = Src::SourceFile{fileName, measure(unit, "preprocess", [&]() {
+                    return runPreprocessor(source, options, gccTime);
+                })};
+                addChildTime(unit, "preprocess", gccTime);
+            } catch (const std::runtime_error& preProcessorError){
+                out << preProcessorError.what() << "Preprocessor failed";
+                unit.result.exitCode = 1;
+                return;
+            }
+        } else {
+            Pp::Result preprocessed {measure(unit, "preprocess", [&]() {
+                return isStandardInput(source)
+                    ? Pp::preprocessText(fileName, options.standardInput, options.preprocessor, includeCache)
+                    : Pp::preprocessFile(fileName, options.preprocessor, includeCache);
+            })};
+            for (const auto& warning : preprocessed.warnings) {
+                out << warning << "\n";
+            }
+            for (const auto& error : preprocessed.errors) {
+                out << error << "\n";
+            }
+            if (!preprocessed.succeeded()) {
+                unit.result.exitCode = 1;
+                return;
+            }
+            sourceFile = Src::SourceFile{fileName, std::move(preprocessed.text)};
+            sourceFile.setLineMap(std::move(preprocessed.lineMap));
+        }
+
+        // The preprocessed text is everything the output depends on, so if it has been compiled before there is nothing
+        // left to do
+        if (cache) {
+            PhaseScope scope {unit, "cache lookup"};
+            unit.cacheKey = Cache::makeKey(sourceFile.text(), cacheKind(options));
+            unit.cachedOutput = cache->find(*unit.cacheKey, cacheKind(options));
+            scope.span().arg("result", unit.cachedOutput ? "hit" : "miss");
+            if (unit.cachedOutput) {
+                return;
+            }
+        }
+
+        // Every stage shares one symbol table, so each name is stored once however many stages refer to it
+        Sym::SymbolTable& symbols {unit.context.symbols()};
+        Src::Diagnostics& diagnostics {unit.context.diagnostics()};
+
+        // On one thread the scanner lexes on demand as the parser pulls tokens, so the full token stream is never held
+        // in memory. With more, the whole file is lexed in parallel up front and its functions are parsed in parallel
+        // from the finished buffer. --time-report and --trace also lex up front, so lexing and parsing can be timed apart
+        std::optional<Token::TokenBuffer> lexedTokens;
+        std::unique_ptr<Lexer::Scanner> scanner;
+        if (options.frontEndThreads > 1 || unit.result.report || Trace::enabled()) {
+            lexedTokens = measure(unit, "lex", [&](PhaseScope& scope) {
+                Token::TokenBuffer tokens {Lexer::lexFile(sourceFile, symbols, diagnostics, options.frontEndThreads)};
+                scope.span().arg("tokens", tokens.size());
+                return tokens;
+            });
+            if (unit.result.report) {
+                unit.result.report->tokens += lexedTokens->size();
+            }
+        } else {
+            scanner = std::make_unique<Lexer::Scanner>(sourceFile.text(), symbols, diagnostics);
+        }
+
+        // Scan whatever the parser did not reach, then print every lexing error
+        // A buffer lexed up front already has every diagnostic
+        // Returns true if there were any
+        auto reportLexerErrors = [&scanner, &diagnostics, &sourceFile, &out]() -> bool {
+            Token::Token discard;
+            while (scanner && scanner->next(discard)) {}
+            for (const auto& diagnostic : diagnostics) {
+                out << Src::formatDiagnostic(sourceFile, diagnostic) << "\n";
+            }
+            return !diagnostics.empty();
+        };
+
+        // check stopCode
+        if (options.stop == Stop::Lex) {
+            if (reportLexerErrors()) {
+                unit.result.exitCode = 1;
+                return;
+            }
+            out << "Stopped at lexer\n";
+            return;
+        }
+
+        // Run parser
+        try {
+            unit.abstractSyntaxTree = measure(unit, "parse", [&](PhaseScope& scope) {
+                Ast::Program program {lexedTokens ? Parser::parseProgram(*lexedTokens, options.frontEndThreads)
+                                                  : Parser::parseProgram(*scanner)};
+                if (scope.span().active()) {
+                    scope.span().arg("functions", program.functions().size());
+                    scope.span().arg("AST nodes", program.nodeCount());
+                    scope.span().arg("arena bytes", program.arenaBytes());
+                }
+                return program;
+            });
+        } catch (const std::exception& syntaxTreeError) {
+            // The parser reports malformed input with invalid_argument and running out of tokens with out_of_range
+            // A lexing error is the likelier root cause, so those are reported in preference
+            if (!reportLexerErrors()) {
+                out << syntaxTreeError.what();
+            }
+            unit.result.exitCode = 1;
+            return;
+        }
+
+        if (reportLexerErrors()) {
+            unit.abstractSyntaxTree.reset();
+            unit.result.exitCode = 1;
+            return;
+        }
+        if (unit.result.report) {
+            unit.result.report->astNodes += unit.abstractSyntaxTree->nodeCount();
+            unit.result.report->astArenaBytes += unit.abstractSyntaxTree->arenaBytes();
+        }
+
+        if (options.stop == Stop::Parse) {
+            unit.abstractSyntaxTree.reset();
+            out << "Stopped at parser\n";
+        }
+    }
+
+    // Tacky generation, assembly generation and emission
+    void runBackEnd(Unit& unit, const Options& options, const Cache::CompileCache* cache) {
+        const FilePath& fileName {unit.result.source};
+        std::string assembly;
+        if (unit.cachedOutput && cacheKind(options) == Cache::Kind::Assembly) {
+            assembly = std::move(*unit.cachedOutput);
+            unit.cachedOutput.reset();
+        } else if (unit.abstractSyntaxTree) {
+            Ctx::CompilationContext& context {unit.context};
+            const Sym::SymbolTable& symbols {context.symbols()};
+
+            // Instructions across every function, which each backend pass traces with what it left behind
+            auto countInstructions = [](const auto& functions) {
+                std::size_t instructions {0};
+                for (const auto& function : functions) {
+                    instructions += function->instructions().size();
+                }
+                return instructions;
+            };
+            // Each backend pass is traced with the function it worked on, or how many if there are several
+            auto describe = [&symbols, &countInstructions](PhaseScope& scope, const auto& functions) {
+                if (scope.span().active()) {
+                    if (functions.size() == 1) {
+                        scope.span().arg("function", symbols.name(functions.front()->identifier()));
+                    } else {
+                        scope.span().arg("functions", functions.size());
+                    }
+                    scope.span().arg("instructions", countInstructions(functions));
+                }
+            };
+
+            Tky::Program tackyTree {measure(unit, "tacky generation", [&](PhaseScope& scope) {
+                Tky::Program program {TkyGen::parseProgram(*unit.abstractSyntaxTree, context)};
+                describe(scope, program.functions());
+                return program;
+            })};
+
+            // Convert C Ast to assembly Ast
+            // TODO: add a type member to all base classes that can be used to determine what type to dynamic_cast to
+            AAst::Program assemblyAbstractSyntaxTree{measure(unit, "assembly generation", [&](PhaseScope& scope) {
+                AAst::Program program {AAstGen::generateProgram(tackyTree)};
+                describe(scope, program.functions());
+                return program;
+            })};
+            const auto& functions {assemblyAbstractSyntaxTree.functions()};
+
+            measure(unit, "pseudo operand replacement", [&](PhaseScope& scope) {
+                AAstGen::findAndReplacePseudoOperands(assemblyAbstractSyntaxTree, context);
+                describe(scope, functions);
+                if (scope.span().active()) {
+                    std::uint64_t stackBytes {0};
+                    for (const auto& function : functions) {
+                        stackBytes += static_cast<std::uint64_t>(function->stackSize());
+                    }
+                    scope.span().arg("stack bytes", stackBytes);
+                }
+            });
+            measure(unit, "stack and mov fixup", [&](PhaseScope& scope) {
+                AAstGen::getStackSizeAndAddMovRegisters(assemblyAbstractSyntaxTree);
+                describe(scope, functions);
+            });
+            unit.abstractSyntaxTree.reset();
+            if (unit.result.report) {
+                unit.result.report->tackyInstructions += countInstructions(tackyTree.functions());
+                unit.result.report->assemblyInstructions += countInstructions(functions);
+            }
+
+            if (options.stop == Stop::Codegen) {
+                return;
+            }
+
+            // Generate Assembly
+            assembly = measure(unit, "emission", [&](PhaseScope& scope) {
+                std::string text {AssemblyEmitter::emitAssemblyText(assemblyAbstractSyntaxTree, symbols)};
+                scope.span().arg("bytes", text.size());
+                return text;
+            });
+            if (unit.cacheKey && cacheKind(options) == Cache::Kind::Assembly) {
+                cache->store(*unit.cacheKey, Cache::Kind::Assembly, assembly);
+            }
+        } else {
+            return;
+        }
+
+        if (options.inMemory) {
+            unit.result.assembly = std::move(assembly);
+            return;
+        }
+
+        // With -S, or no output options at all, the assembly goes to a .s file, or to the unit's output for -o - and for
+        // standard input. Otherwise it is kept for assemble() to pipe into gcc to make an object file or executable
+        // without touching the disk in between
+        try {
+            PhaseScope scope {unit, "write output"};
+            bool writeAssembly {options.stop == Stop::Emission || (!options.objectOnly && options.outputFileName.empty())};
+            if (writeAssembly && (isStandardInput(options.outputFileName)
+                                  || (options.outputFileName.empty() && isStandardInput(fileName)))) {
+                unit.out << assembly;
+            } else if (writeAssembly) {
+                FilePath compiledFileName {options.outputFileName};
+                if (compiledFileName.empty()) {
+                    compiledFileName = fileName;
+                    compiledFileName.replace_extension(".s");
+                }
+                writeFile(compiledFileName, assembly);
+            } else {
+                unit.builtFileName = objectFileName(fileName, options);
+                unit.assembly = std::move(assembly);
+            }
+        } catch (std::runtime_error& syntaxError) {
+            unit.out << syntaxError.what();
+            unit.result.exitCode = 1;
+        }
+    }
+
+    // Pipes the unit's assembly into gcc, which assembles it into an object file, or links an executable without -c
+    void assemble(Unit& unit, const Options& options, const Cache::CompileCache* cache) {
+        if (unit.cachedOutput) {
+            // An object file from the cache, so gcc has nothing to do
+            try {
+                PhaseScope scope {unit, "write output"};
+                writeFile(objectFileName(unit.result.source, options), *unit.cachedOutput);
+            } catch (const std::runtime_error& writeError) {
+                unit.out << writeError.what();
+                unit.result.exitCode = 1;
+            }
+            unit.cachedOutput.reset();
+        } else if (!unit.assembly.empty()) {
+            bool link {!options.objectOnly};
+            std::vector<std::string> command {"gcc"};
+            if (!link) {
+                command.emplace_back("-c");
+            }
+            for (std::string_view argument : {"-x", "assembler", "-", "-o"}) {
+                command.emplace_back(argument);
+            }
+            command.push_back(unit.builtFileName.string());
+
+            // gcc reports any problems on stderr itself
+            Proc::ProcessResult result {measure(unit, "assemble", [&]() { return Proc::run(command, unit.assembly); })};
+            addChildTime(unit, "assemble", Timing{std::chrono::nanoseconds{0}, result.cpuTime});
+            if (!result.succeeded()) {
+                unit.out << "Error: gcc " << (link ? "link" : "assemble") << " failed with error code "
+                << result.exitCode << "\n";
+                unit.result.exitCode = 1;
+            } else if (unit.cacheKey && cacheKind(options) == Cache::Kind::Object) {
+                std::ifstream object {unit.builtFileName, std::ios::binary};
+                std::string contents {std::istreambuf_iterator<char>{object}, {}};
+                if (object) {
+                    cache->store(*unit.cacheKey, Cache::Kind::Object, contents);
+                }
+            }
+            unit.assembly.clear();
+        }
+
+        if (options.printSymbolStats && unit.result.exitCode == 0) {
+            Sym::printStats(unit.context.symbols().stats(), unit.out);
+        }
+    }
+
+    // Runs one step of a unit, adding the time it takes to the unit's total
+    template <typename Step>
+    void timed(Unit& unit, Step step) {
+        Stopwatch stopwatch;
+        step();
+        addTime(unit.result.time, stopwatch.stop());
+    }
+
+    UnitResult finish(Unit& unit) {
+        unit.result.output = std::move(unit.out).str();
+        return std::move(unit.result);
+    }
+
+    std::vector<UnitResult> compileFiles(const std::vector<FilePath>& files, const Options& options, std::size_t jobs,
+                                         Pp::IncludeCache& includeCache) {
+        // Headers are shared between units, so they are only read and tokenized once however many include them
+        std::vector<std::unique_ptr<Unit>> units;
+        if (options.timeReport) {
+            Alloc::enableCounting();
+        }
+        for (const auto& file : files) {
+            units.push_back(std::make_unique<Unit>());
+            units.back()->result.source = file;
+            if (options.timeReport) {
+                units.back()->result.report.emplace();
+            }
+        }
+
+        // Entries are files, so one cache object is safe to share between every unit
+        std::optional<Cache::CompileCache> cache;
+        if (usesCache(options)) {
+            cache.emplace(options.cacheDirectory, options.cacheSize);
+        }
+        const Cache::CompileCache* compileCache {cache ? &*cache : nullptr};
+
+        auto compileUnit = [&options, &includeCache, compileCache](Unit& unit) {
+            timed(unit, [&]() {
+                Trace::Span span {"compile"};
+                span.arg("file", unit.result.source.native());
+                runFrontEnd(unit, options, includeCache, compileCache);
+                runBackEnd(unit, options, compileCache);
+                assemble(unit, options, compileCache);
+            });
+        };
+
+        // A single job runs everything on this thread, so a one file compile never starts a thread
+        if (jobs <= 1 || files.size() <= 1) {
+            for (auto& unit : units) {
+                compileUnit(*unit);
+            }
+        } else {
+            // Units share nothing but the include cache, so each one goes through the whole pipeline on its own worker
+            Threads::ThreadPool pool {std::min(jobs, files.size())};
+            Threads::parallelFor(pool, units.size(), [&](std::size_t i) { compileUnit(*units[i]); });
+        }
+
+        std::vector<UnitResult> results;
+        for (auto& unit : units) {
+            results.push_back(finish(*unit));
+        }
+        return results;
+    }
+
+    std::string milliseconds(std::chrono::nanoseconds time) {
+        return std::to_string(time.count() / 1'000'000) + "." + std::to_string(time.count() / 100'000 % 10)
+            + std::to_string(time.count() / 10'000 % 10) + " ms";
+    }
+
+    // Right aligns text in a column width characters wide
+    std::string column(const std::string& text, std::size_t width) {
+        return std::string(width - std::min(width, text.size()), ' ') + text;
+    }
+
+    void printTimings(const std::vector<UnitResult>& results, const Timing& total, std::ostream& out) {
+        std::size_t width {5};
+        for (const auto& result : results) {
+            width = std::max(width, result.source.string().size());
+        }
+        auto row = [&](const std::string& name, const Timing& time) {
+            out << name << std::string(width + 2 - name.size(), ' ') << column(milliseconds(time.wall), 12)
+                << column(milliseconds(time.cpu), 12) << "\n";
+        };
+
+        out << "file" << std::string(width - 2, ' ') << "        wall         cpu\n";
+        for (const auto& result : results) {
+            row(result.source.string(), result.time);
+        }
+        row("total", total);
+    }
+
+    void TimeReport::add(std::string_view name, const Timing& time, const Alloc::Counts& allocations) {
+        auto phase {std::find_if(phases.begin(), phases.end(), [name](const Phase& row) { return row.name == name; })};
+        if (phase == phases.end()) {
+            phases.push_back(Phase{name, time, allocations});
+            return;
+        }
+        addTime(phase->time, time);
+        phase->allocations += allocations;
+    }
+
+    void TimeReport::merge(const TimeReport& other) {
+        for (const auto& phase : other.phases) {
+            add(phase.name, phase.time, phase.allocations);
+        }
+        tokens += other.tokens;
+        astNodes += other.astNodes;
+        astArenaBytes += other.astArenaBytes;
+        tackyInstructions += other.tackyInstructions;
+        assemblyInstructions += other.assemblyInstructions;
+    }
+
+    void printTimeReport(const TimeReport& report, std::ostream& out) {
+        std::size_t width {5};
+        for (const auto& phase : report.phases) {
+            width = std::max(width, phase.name.size());
+        }
+        // Without a counting operator new linked in, the allocation columns would only ever be zero
+        bool counted {Alloc::hasCounter()};
+        auto row = [&](std::string_view name, const Timing& time, const Alloc::Counts& allocations) {
+            out << name << std::string(width + 2 - name.size(), ' ') << column(milliseconds(time.wall), 12)
+                << column(milliseconds(time.cpu), 12)
+                << column(counted ? std::to_string(allocations.allocations) : "-", 14)
+                << column(counted ? std::to_string(allocations.bytes) : "-", 14) << "\n";
+        };
+
+        out << "phase" << std::string(width - 3, ' ') << "        wall         cpu   allocations         bytes\n";
+        Timing totalTime;
+        Alloc::Counts totalAllocations;
+        for (const auto& phase : report.phases) {
+            row(phase.name, phase.time, phase.allocations);
+            addTime(totalTime, phase.time);
+            totalAllocations += phase.allocations;
+        }
+        row("total", totalTime, totalAllocations);
+
+        // ru_maxrss is in kilobytes on Linux
+        rusage usage {};
+        getrusage(RUSAGE_SELF, &usage);
+        out << "peak RSS:              " << usage.ru_maxrss << " KB\n";
+        out << "tokens:                " << report.tokens << "\n";
+        out << "AST nodes:             " << report.astNodes << "\n";
+        out << "AST arena bytes:       " << report.astArenaBytes << "\n";
+        out << "Tacky instructions:    " << report.tackyInstructions << "\n";
+        out << "assembly instructions: " << report.assemblyInstructions << "\n";
+    }
+}
@@ -0,0 +1,134 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_DRIVER_H
+#define DCC_DRIVER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../preprocessor/preprocessor.h"
+#include "../helpers/allocation_counter.h"
+
+// Runs the whole pipeline over one or more translation units
+// Each unit has its own symbol table, diagnostics and output buffer, so units compiled together behave exactly as if
+// they had been compiled by separate dcc processes
+namespace Driver {
+    using FilePath = std::filesystem::path;
+
+    // The stage to stop after, as chosen by --lex, --parse, --codegen and -S
+    enum class Stop {
+        None,
+        Lex,
+        Parse,
+        Codegen,
+        Emission,
+    };
+
+    struct Options {
+        Stop stop {Stop::None};
+        // -c. Assemble to an object file instead of writing a .s file
+        bool objectOnly {false};
+        // -o. Empty means the output is named after the source file
+        FilePath outputFileName;
+        bool printSymbolStats {false};
+        // Threads used to lex and parse a single file
+        std::size_t frontEndThreads {1};
+        bool gccPreprocess {false};
+        Pp::Options preprocessor;
+        // Source text for a file named -
+        std::string standardInput;
+        // What diagnostics call a file named -
+        FilePath standardInputName {"<stdin>"};
+        // Keep the assembly in each unit's result rather than writing it anywhere, so nothing touches the disk or runs
+        // gcc. The output options are ignored
+        bool inMemory {false};
+        // Where outputs named after the source file's name alone, such as object files, are written, and what standard
+        // input is named relative to. Empty means the current directory
+        FilePath workingDirectory;
+        // --cache. Where compiled output is kept to be reused by later compiles of the same code. Empty means no caching
+        FilePath cacheDirectory;
+        // --cache-size. The least recently used entries are deleted to keep the cache under this
+        std::uint64_t cacheSize {std::uint64_t{1} << 30};
+        // --time-report. Measure each phase of each unit. When off no clock is read and nothing is counted
+        bool timeReport {false};
+    };
+
+    struct Timing {
+        std::chrono::nanoseconds wall {0};
+        // Includes any gcc processes run for the unit
+        std::chrono::nanoseconds cpu {0};
+    };
+
+    // One row of --time-report
+    struct Phase {
+        std::string_view name;
+        Timing time;
+        Alloc::Counts allocations;
+    };
+
+    // What --time-report prints, for one unit or summed over several
+    struct TimeReport {
+        // In the order each phase first ran
+        std::vector<Phase> phases;
+        std::uint64_t tokens {0};
+        std::uint64_t astNodes {0};
+        // Heap taken by the arenas the ASTs were made in
+        std::uint64_t astArenaBytes {0};
+        std::uint64_t tackyInstructions {0};
+        std::uint64_t assemblyInstructions {0};
+
+        // Adds to the phase called name, starting a new row if it has not run before
+        void add(std::string_view name, const Timing& time, const Alloc::Counts& allocations);
+        // Adds on every phase and count of other
+        void merge(const TimeReport& other);
+    };
+
+    struct UnitResult {
+        FilePath source;
+        int exitCode {0};
+        // Everything the unit would have printed, such as diagnostics, kept back so units finishing out of order are
+        // still printed in the order they were given
+        std::string output;
+        // With Options::inMemory, the assembly that would have been written
+        std::string assembly;
+        Timing time;
+        // Only filled in with --time-report
+        std::optional<TimeReport> report;
+    };
+
+    // Compiles files, with up to jobs of them in flight at once
+    // The results are in the same order as files and are identical whatever jobs is
+    // A file named - is compiled from options.standardInput. With no -o its assembly goes into the unit's output
+    std::vector<UnitResult> compileFiles(const std::vector<FilePath>& files, const Options& options, std::size_t jobs,
+                                         Pp::IncludeCache& includeCache);
+
+    // Prints a table of the wall and CPU time spent on each unit, and on the whole run
+    void printTimings(const std::vector<UnitResult>& results, const Timing& total, std::ostream& out);
+
+    // Prints each phase's wall and CPU time and allocations, the process's peak resident set size, and how many
+    // tokens, AST nodes and instructions were made
+    void printTimeReport(const TimeReport& report, std::ostream& out);
+
+    // Measures wall and CPU time from construction until stop() is called
+    // CPU time is taken from the calling thread, so start and stop must happen on the same thread
+    class Stopwatch {
+        std::chrono::steady_clock::time_point m_wall;
+        std::chrono::nanoseconds m_cpu;
+        bool m_wholeProcess;
+    public:
+        // With wholeProcess set, CPU time is counted across every thread and finished child process
+        explicit Stopwatch(bool wholeProcess = false);
+
+        Timing stop() const;
+    };
+}
+
+#endif //DCC_DRIVER_H
@@ -0,0 +1,317 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <semaphore>
+#include <sstream>
+#include <stdexcept>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "server.h"
+#include "command_line.h"
+#include "../helpers/thread_pool.h"
+
+namespace Server {
+    // Sent first in every request, so a client and server from different versions refuse each other cleanly
+    constexpr std::string_view g_protocolMagic {"DCC2"};
+
+    // Longest request or response accepted, as a guard against reading garbage as a length
+    constexpr std::uint32_t g_maxMessage {1u << 30};
+
+    // Closes a socket when it goes out of scope
+    struct Socket {
+        int fd {-1};
+
+        explicit Socket(int descriptor) : fd{descriptor} {}
+        ~Socket() {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+
+        Socket(const Socket&) = delete;
+        Socket& operator=(const Socket&) = delete;
+    };
+
+    void writeAll(int fd, std::string_view data) {
+        while (!data.empty()) {
+            ssize_t written {send(fd, data.data(), data.size(), MSG_NOSIGNAL)};
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error(std::string{"socket write failed: "} + std::strerror(errno));
+            }
+            data.remove_prefix(static_cast<std::size_t>(written));
+        }
+    }
+
+    void readAll(int fd, char* data, std::size_t size) {
+        while (size > 0) {
+            ssize_t count {recv(fd, data, size, 0)};
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+            if (count <= 0) {
+                throw std::runtime_error("connection closed mid message");
+            }
+            data += count;
+            size -= static_cast<std::size_t>(count);
+        }
+    }
+
+    // Messages are a 32 bit length followed by that many bytes. Strings within them are encoded the same way
+    void appendNumber(std::string& message, std::uint32_t value) {
+        message.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void appendString(std::string& message, std::string_view text) {
+        appendNumber(message, static_cast<std::uint32_t>(text.size()));
+        message.append(text);
+    }
+
+    void sendMessage(int fd, std::string_view message) {
+        std::string length;
+        appendNumber(length, static_cast<std::uint32_t>(message.size()));
+        writeAll(fd, length);
+        writeAll(fd, message);
+    }
+
+    std::string receiveMessage(int fd) {
+        std::uint32_t length {};
+        readAll(fd, reinterpret_cast<char*>(&length), sizeof(length));
+        if (length > g_maxMessage) {
+            throw std::runtime_error("message too long");
+        }
+        std::string message(length, '\0');
+        readAll(fd, message.data(), length);
+        return message;
+    }
+
+    // Reads the numbers and strings back out of a message in the order they were appended
+    class MessageReader {
+        std::string_view m_rest;
+    public:
+        explicit MessageReader(std::string_view message) : m_rest{message} {}
+
+        std::uint32_t number() {
+            std::uint32_t value {};
+            if (m_rest.size() < sizeof(value)) {
+                throw std::runtime_error("truncated message");
+            }
+            std::memcpy(&value, m_rest.data(), sizeof(value));
+            m_rest.remove_prefix(sizeof(value));
+            return value;
+        }
+
+        std::string_view string() {
+            std::uint32_t length {number()};
+            if (m_rest.size() < length) {
+                throw std::runtime_error("truncated message");
+            }
+            std::string_view text {m_rest.substr(0, length)};
+            m_rest.remove_prefix(length);
+            return text;
+        }
+    };
+
+    sockaddr_un socketAddress(const std::filesystem::path& socketPath) {
+        sockaddr_un address {};
+        address.sun_family = AF_UNIX;
+        const std::string& path {socketPath.native()};
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("socket path " + path + " is too long");
+        }
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return address;
+    }
+
+    // Returns a connected socket, or -1 if nothing is listening on socketPath
+    int connectTo(const std::filesystem::path& socketPath) {
+        sockaddr_un address {socketAddress(socketPath)};
+        int fd {socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+        if (fd < 0) {
+            return -1;
+        }
+        if (connect(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    // Paths from the client are relative to its directory, not ours
+    void makeAbsolute(std::filesystem::path& path, const std::filesystem::path& directory) {
+        if (!path.empty() && path.native() != "-" && path.is_relative()) {
+            path = directory / path;
+        }
+    }
+
+    // Compiles one request and returns the response to send back
+    std::string handleRequest(std::string_view request, Pp::IncludeCache& includeCache) {
+        MessageReader reader {request};
+        if (reader.string() != g_protocolMagic) {
+            throw std::runtime_error("client speaks a different protocol version");
+        }
+        std::filesystem::path directory {reader.string()};
+        // Where --cache goes by default depends on the environment, and the server's may not be the client's
+        std::filesystem::path defaultCache {reader.string()};
+        std::vector<std::string_view> arguments(reader.number());
+        for (auto& argument : arguments) {
+            argument = reader.string();
+        }
+        std::string_view standardInput {reader.string()};
+
+        std::ostringstream out;
+        Driver::Invocation invocation;
+        std::optional<int> exitCode {Driver::parseCommandLine(arguments, invocation, out, defaultCache)};
+        if (!exitCode && invocation.server) {
+            out << "Error: a client cannot start a server\n";
+            exitCode = 1;
+        }
+        // The trace is shared by the whole process, so would mix in every other client's compiles
+        if (!exitCode && !invocation.tracePath.empty()) {
+            out << "Error: --trace cannot be used through a server\n";
+            exitCode = 1;
+        }
+        if (!exitCode) {
+            // Every worker is already busy with a request of its own, so -j would only oversubscribe the cores
+            invocation.threads = 1;
+            for (auto& file : invocation.files) {
+                makeAbsolute(file, directory);
+            }
+            Driver::Options& options {invocation.options};
+            makeAbsolute(options.outputFileName, directory);
+            makeAbsolute(options.cacheDirectory, directory);
+            for (auto& includePath : options.preprocessor.includePaths) {
+                makeAbsolute(includePath, directory);
+            }
+            options.workingDirectory = directory;
+            options.standardInput = standardInput;
+            exitCode = Driver::runInvocation(invocation, includeCache, out);
+        }
+
+        std::string response;
+        appendNumber(response, static_cast<std::uint32_t>(*exitCode));
+        appendString(response, std::move(out).str());
+        return response;
+    }
+
+    void serveClient(int fd, Pp::IncludeCache& includeCache) {
+        Socket client {fd};
+        std::string response;
+        try {
+            std::string request {receiveMessage(client.fd)};
+            try {
+                response = handleRequest(request, includeCache);
+            } catch (const std::exception& problem) {
+                response.clear();
+                appendNumber(response, 1);
+                appendString(response, std::string{"Error: "} + problem.what() + "\n");
+            }
+            sendMessage(client.fd, response);
+        } catch (const std::exception&) {
+            // The client went away, so there is nobody to tell
+        }
+    }
+
+    int serve(const std::filesystem::path& socketPath, std::ostream& log) {
+        sockaddr_un address;
+        try {
+            address = socketAddress(socketPath);
+        } catch (const std::runtime_error& problem) {
+            log << "Error: " << problem.what() << "\n";
+            return 1;
+        }
+
+        // A socket file nobody is listening on is left over from a server that died, and can be replaced
+        if (int running {connectTo(socketPath)}; running >= 0) {
+            close(running);
+            log << "Error: a server is already listening on " << socketPath.string() << "\n";
+            return 1;
+        }
+        unlink(socketPath.c_str());
+
+        Socket listener {socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0)};
+        // Only this user may connect, since the server reads and writes files on the client's behalf
+        mode_t oldMask {umask(0077)};
+        bool bound {listener.fd >= 0 && bind(listener.fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0};
+        umask(oldMask);
+        if (!bound || listen(listener.fd, SOMAXCONN) != 0) {
+            log << "Error: could not listen on " << socketPath.string() << ": " << std::strerror(errno) << "\n";
+            return 1;
+        }
+        log << "dcc server listening on " << socketPath.string() << std::endl;
+
+        std::signal(SIGPIPE, SIG_IGN);
+        // Kept for the life of the server, so headers are only read once across every request
+        Pp::IncludeCache includeCache;
+        // One request per core at a time. Nothing is accepted while they are all busy, so the rest wait in the
+        // listen backlog rather than piling up as threads or queued jobs
+        std::size_t workerCount {Threads::hardwareThreads()};
+        // Declared before the pool, so it outlives the jobs still finishing when the pool is destroyed
+        std::counting_semaphore<> idleWorkers {static_cast<std::ptrdiff_t>(workerCount)};
+        Threads::ThreadPool workers {workerCount};
+        while (true) {
+            idleWorkers.acquire();
+            int client {accept4(listener.fd, nullptr, nullptr, SOCK_CLOEXEC)};
+            if (client < 0) {
+                idleWorkers.release();
+                if (errno == EINTR || errno == ECONNABORTED) {
+                    continue;
+                }
+                log << "Error: accept failed: " << std::strerror(errno) << "\n";
+                return 1;
+            }
+            workers.submit([client, &includeCache, &idleWorkers]() {
+                serveClient(client, includeCache);
+                idleWorkers.release();
+            });
+        }
+    }
+
+    std::optional<int> forward(const std::filesystem::path& socketPath, const std::vector<std::string_view>& arguments,
+                               std::string_view standardInput, std::ostream& out) {
+        int fd;
+        try {
+            fd = connectTo(socketPath);
+        } catch (const std::runtime_error&) {
+            return std::nullopt;
+        }
+        if (fd < 0) {
+            return std::nullopt;
+        }
+        Socket server {fd};
+
+        std::string request;
+        appendString(request, g_protocolMagic);
+        std::error_code error;
+        appendString(request, std::filesystem::current_path(error).native());
+        appendString(request, Driver::defaultCacheDirectory().native());
+        appendNumber(request, static_cast<std::uint32_t>(arguments.size()));
+        for (std::string_view argument : arguments) {
+            appendString(request, argument);
+        }
+        appendString(request, standardInput);
+
+        try {
+            sendMessage(server.fd, request);
+            std::string response {receiveMessage(server.fd)};
+            MessageReader reader {response};
+            int exitCode {static_cast<int>(reader.number())};
+            out << reader.string();
+            return exitCode;
+        } catch (const std::runtime_error&) {
+            // The server went away mid request, so compile here instead
+            return std::nullopt;
+        }
+    }
+}
@@ -0,0 +1,34 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_SERVER_H
+#define DCC_SERVER_H
+
+#include <filesystem>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Keeps one dcc process running to compile for many short lived client invocations, so a build that runs dcc
+// thousands of times only pays for process startup and cold caches once
+// Clients send their command line, working directory, default cache directory and standard input over a Unix socket.
+// The server compiles exactly as dcc would have in the client's directory and environment, writing any output files
+// itself, and sends back the exit code and everything that would have been printed
+namespace Server {
+    // Accepts clients on socketPath until killed, compiling each request on its own thread
+    // Headers stay cached between requests, while symbol tables and AST arenas are made afresh for each, as they cost
+    // little next to the round trip and a reused table would hand out different ids
+    // Returns only if the socket could not be set up, having said why on log
+    int serve(const std::filesystem::path& socketPath, std::ostream& log);
+
+    // Sends a command line, not including the program name, to the server on socketPath, and writes what the compile
+    // printed to out
+    // Returns the compile's exit code, or std::nullopt if there is no server to talk to
+    std::optional<int> forward(const std::filesystem::path& socketPath, const std::vector<std::string_view>& arguments,
+                               std::string_view standardInput, std::ostream& out);
+}
+
+#endif //DCC_SERVER_H
@@ -0,0 +1,28 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include "allocation_counter.h"
+
+namespace Alloc {
+    // Constant initialised, so it is already empty when a counter installs itself during static initialisation
+    constinit Counter g_counter {nullptr, nullptr};
+
+    void setCounter(const Counter& counter) {
+        g_counter = counter;
+    }
+
+    bool hasCounter() {
+        return g_counter.threadCounts != nullptr;
+    }
+
+    void enableCounting() {
+        if (g_counter.enable) {
+            g_counter.enable();
+        }
+    }
+
+    Counts threadCounts() {
+        return g_counter.threadCounts ? g_counter.threadCounts() : Counts{};
+    }
+}
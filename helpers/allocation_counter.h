@@ -0,0 +1,50 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_ALLOCATION_COUNTER_H
+#define DCC_ALLOCATION_COUNTER_H
+
+#include <cstdint>
+
+// Lets a phase of the compiler be charged for the allocations it makes
+// libdcc counts nothing itself, as a library replacing the global operator new would take over the allocator of every
+// program that links it. A program opts in by linking the dcc_counting_new object library, helpers/counting_new.cpp,
+// which replaces operator new and installs itself as the counter here before main. Without it every count is zero
+namespace Alloc {
+    struct Counts {
+        std::uint64_t allocations {0};
+        std::uint64_t bytes {0};
+
+        Counts operator-(const Counts& other) const {
+            return Counts{allocations - other.allocations, bytes - other.bytes};
+        }
+        Counts& operator+=(const Counts& other) {
+            allocations += other.allocations;
+            bytes += other.bytes;
+            return *this;
+        }
+    };
+
+    // What an operator new that counts provides
+    struct Counter {
+        void (*enable)();
+        Counts (*threadCounts)();
+    };
+
+    // Called once by whatever replaces operator new, before anything asks for counts
+    void setCounter(const Counter& counter);
+
+    // Whether a counter was installed, so a report can say the counts are missing rather than show zeros
+    bool hasCounter();
+
+    // Counting stays on for the rest of the process once started
+    void enableCounting();
+
+    // Allocations made by the calling thread since counting was enabled
+    // Counts are per thread so units compiled at once do not see each other's allocations. Work handed to other
+    // threads, such as the chunks of a parallel lex, is not counted against the thread that asked for it
+    Counts threadCounts();
+}
+
+#endif //DCC_ALLOCATION_COUNTER_H
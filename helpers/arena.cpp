@@ -0,0 +1,48 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <algorithm>
+
+#include "arena.h"
+
+namespace Mem {
+    // Blocks double in size up to this, so a large tree takes few allocations without a small one reserving much
+    constexpr std::size_t g_maximumBlockSize {1 << 20};
+
+    Arena::Arena(Arena&& other) noexcept
+        : m_blocks {std::move(other.m_blocks)}
+        , m_next {std::exchange(other.m_next, nullptr)}
+        , m_end {std::exchange(other.m_end, nullptr)}
+        , m_nextBlockSize {other.m_nextBlockSize}
+        , m_objects {std::exchange(other.m_objects, 0)}
+        , m_usedBytes {std::exchange(other.m_usedBytes, 0)}
+        , m_reservedBytes {std::exchange(other.m_reservedBytes, 0)}
+    {}
+
+    Arena& Arena::operator=(Arena&& other) noexcept {
+        if (this != &other) {
+            m_blocks = std::move(other.m_blocks);
+            m_next = std::exchange(other.m_next, nullptr);
+            m_end = std::exchange(other.m_end, nullptr);
+            m_nextBlockSize = other.m_nextBlockSize;
+            m_objects = std::exchange(other.m_objects, 0);
+            m_usedBytes = std::exchange(other.m_usedBytes, 0);
+            m_reservedBytes = std::exchange(other.m_reservedBytes, 0);
+        }
+        return *this;
+    }
+
+    void Arena::grow(std::size_t size, std::size_t alignment) {
+        // new[] of bytes is only aligned for the fundamental types, so anything stricter asks for room to line up in
+        std::size_t needed {size + (alignment > alignof(std::max_align_t) ? alignment : 0)};
+        std::size_t blockSize {std::max(m_nextBlockSize, needed)};
+        m_nextBlockSize = std::min(m_nextBlockSize * 2, g_maximumBlockSize);
+
+        m_blocks.push_back(std::make_unique_for_overwrite<std::byte[]>(blockSize));
+        m_next = m_blocks.back().get();
+        m_end = m_next + blockSize;
+        m_reservedBytes += blockSize;
+        m_next += static_cast<std::size_t>(-reinterpret_cast<std::uintptr_t>(m_next) & (alignment - 1));
+    }
+}
@@ -0,0 +1,66 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_ARENA_H
+#define DCC_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Mem {
+    // Bump allocator for objects that all die together, such as the nodes of one AST
+    // Objects are never destroyed one at a time, so only trivially destructible types can be made here, and the whole
+    // lot is freed in one step when the arena goes. Moving an arena does not move its objects, so pointers to them
+    // stay valid
+    class Arena {
+        std::vector<std::unique_ptr<std::byte[]>> m_blocks;
+        std::byte* m_next {nullptr};
+        std::byte* m_end {nullptr};
+        std::size_t m_nextBlockSize {4096};
+        std::uint64_t m_objects {0};
+        std::uint64_t m_usedBytes {0};
+        std::uint64_t m_reservedBytes {0};
+
+        // Starts a new block with room for at least size bytes aligned to alignment
+        void grow(std::size_t size, std::size_t alignment);
+    public:
+        Arena() = default;
+        Arena(Arena&& other) noexcept;
+        Arena& operator=(Arena&& other) noexcept;
+
+        // Uninitialised memory that lives as long as the arena
+        void* allocate(std::size_t size, std::size_t alignment) {
+            std::size_t padding {static_cast<std::size_t>(-reinterpret_cast<std::uintptr_t>(m_next) & (alignment - 1))};
+            if (static_cast<std::size_t>(m_end - m_next) < size + padding) {
+                grow(size, alignment);
+                padding = 0;
+            }
+            std::byte* memory {m_next + padding};
+            m_next = memory + size;
+            m_usedBytes += size + padding;
+            return memory;
+        }
+
+        template <typename T, typename... Args>
+        T* make(Args&&... args) {
+            static_assert(std::is_trivially_destructible_v<T>, "Arena objects are never destroyed");
+            ++m_objects;
+            return ::new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        }
+
+        // Objects made with make()
+        std::uint64_t objects() const { return m_objects; }
+        // Bytes handed out, including alignment padding
+        std::uint64_t usedBytes() const { return m_usedBytes; }
+        // Bytes taken from the heap, which is usedBytes plus the unused tail of each block
+        std::uint64_t reservedBytes() const { return m_reservedBytes; }
+    };
+}
+
+#endif //DCC_ARENA_H
@@ -0,0 +1,47 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_COMPILATION_CONTEXT_H
+#define DCC_COMPILATION_CONTEXT_H
+
+#include "symbol_table.h"
+#include "../lexer/source.h"
+
+namespace Ctx {
+    // Everything one compilation changes as it runs: names, diagnostics and the counters the back end hands out
+    // Each stage takes the context rather than keeping state of its own, so compilations with separate contexts can
+    // run one after another or at the same time on different threads without affecting each other's output
+    class CompilationContext {
+        Sym::SymbolTable m_symbols;
+        Src::Diagnostics m_diagnostics;
+        // Offset below the base pointer of the lowest stack slot handed out in the current function. Never positive
+        int m_stackOffset {0};
+    public:
+        CompilationContext() = default;
+
+        // Ids from the symbol table are only meaningful within one compilation, so a context is never copied
+        CompilationContext(const CompilationContext&) = delete;
+        CompilationContext& operator=(const CompilationContext&) = delete;
+
+        Sym::SymbolTable& symbols() { return m_symbols; }
+        const Sym::SymbolTable& symbols() const { return m_symbols; }
+
+        Src::Diagnostics& diagnostics() { return m_diagnostics; }
+        const Src::Diagnostics& diagnostics() const { return m_diagnostics; }
+
+        // Starts a function's stack frame off empty, so slots do not carry on from the previous function
+        void beginFunction() { m_stackOffset = 0; }
+
+        // Reserves bytes in the current function's frame and returns the new slot's offset from the base pointer
+        int allocateStack(int bytes) {
+            m_stackOffset -= bytes;
+            return m_stackOffset;
+        }
+
+        // Bytes reserved so far in the current function's frame
+        int stackSize() const { return -m_stackOffset; }
+    };
+}
+
+#endif //DCC_COMPILATION_CONTEXT_H
@@ -0,0 +1,58 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+// Replaces the global operator new to count allocations for Alloc, see allocation_counter.h
+// Only linked into programs, never into libdcc, so embedders keep their own allocator
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "allocation_counter.h"
+
+namespace {
+    // Constant initialised, as operator new can run before main
+    // Only ever read relaxed, which on x86 is a plain load
+    constinit std::atomic<bool> g_counting {false};
+    constinit thread_local Alloc::Counts t_counts {};
+
+    void enable() {
+        g_counting.store(true, std::memory_order_relaxed);
+    }
+
+    Alloc::Counts threadCounts() {
+        return t_counts;
+    }
+
+    const bool g_installed {(Alloc::setCounter({enable, threadCounts}), true)};
+}
+
+void* operator new(std::size_t size) {
+    if (g_counting.load(std::memory_order_relaxed)) {
+        ++t_counts.allocations;
+        t_counts.bytes += size;
+    }
+    // As the standard library's version does, ask the new handler to free memory until the allocation works
+    if (size == 0) {
+        size = 1;
+    }
+    while (true) {
+        if (void* memory {std::malloc(size)}) {
+            return memory;
+        }
+        std::new_handler handler {std::get_new_handler()};
+        if (!handler) {
+            throw std::bad_alloc{};
+        }
+        handler();
+    }
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
@@ -0,0 +1,129 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <array>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "process.h"
+
+extern char** environ;
+
+namespace Proc {
+    // Closes a file descriptor when it goes out of scope, unless it has already been closed by hand
+    struct Descriptor {
+        int fd {-1};
+
+        ~Descriptor() { close(); }
+
+        void close() {
+            if (fd >= 0) {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    };
+
+    struct Pipe {
+        Descriptor read;
+        Descriptor write;
+
+        Pipe() {
+            std::array<int, 2> ends {};
+            // Close on exec, so the child only keeps the ends dup2'd onto its stdin and stdout
+            if (pipe2(ends.data(), O_CLOEXEC) != 0) {
+                throw std::runtime_error(std::string{"could not create pipe: "} + std::strerror(errno));
+            }
+            read.fd = ends[0];
+            write.fd = ends[1];
+        }
+    };
+
+    ProcessResult run(const std::vector<std::string>& arguments, std::string_view input) {
+        if (arguments.empty()) {
+            throw std::runtime_error("no program to run");
+        }
+        // A child that exits without reading all its input would otherwise kill us with SIGPIPE
+        std::signal(SIGPIPE, SIG_IGN);
+
+        Pipe stdinPipe;
+        Pipe stdoutPipe;
+
+        posix_spawn_file_actions_t actions;
+        posix_spawn_file_actions_init(&actions);
+        posix_spawn_file_actions_adddup2(&actions, stdinPipe.read.fd, STDIN_FILENO);
+        posix_spawn_file_actions_adddup2(&actions, stdoutPipe.write.fd, STDOUT_FILENO);
+
+        std::vector<char*> argv;
+        for (const std::string& argument : arguments) {
+            argv.push_back(const_cast<char*>(argument.c_str()));
+        }
+        argv.push_back(nullptr);
+
+        pid_t pid {};
+        int spawnError {posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ)};
+        posix_spawn_file_actions_destroy(&actions);
+        if (spawnError != 0) {
+            throw std::runtime_error("could not run " + arguments[0] + ": " + std::strerror(spawnError));
+        }
+        // Only the child uses these ends. Closing ours lets it see end of file, and lets us see it exit
+        stdinPipe.read.close();
+        stdoutPipe.write.close();
+
+        if (input.empty()) {
+            stdinPipe.write.close();
+        } else {
+            fcntl(stdinPipe.write.fd, F_SETFL, O_NONBLOCK);
+        }
+
+        ProcessResult result {0, {}, {}};
+        std::array<char, 64 * 1024> buffer {};
+        while (stdoutPipe.read.fd >= 0) {
+            std::array<pollfd, 2> waiting {{{stdoutPipe.read.fd, POLLIN, 0}, {stdinPipe.write.fd, POLLOUT, 0}}};
+            // A negative fd is skipped by poll, which happens once all the input has been written
+            if (poll(waiting.data(), waiting.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+
+            if (waiting[1].revents != 0) {
+                ssize_t written {::write(stdinPipe.write.fd, input.data(), input.size())};
+                if (written > 0) {
+                    input.remove_prefix(static_cast<std::size_t>(written));
+                }
+                if (input.empty() || (written < 0 && errno != EAGAIN && errno != EINTR)) {
+                    stdinPipe.write.close();
+                }
+            }
+            if (waiting[0].revents != 0) {
+                ssize_t count {::read(stdoutPipe.read.fd, buffer.data(), buffer.size())};
+                if (count > 0) {
+                    result.output.append(buffer.data(), static_cast<std::size_t>(count));
+                } else if (count == 0 || errno != EINTR) {
+                    stdoutPipe.read.close();
+                }
+            }
+        }
+        stdinPipe.write.close();
+
+        int status {};
+        rusage usage {};
+        while (wait4(pid, &status, 0, &usage) < 0 && errno == EINTR) {}
+        result.cpuTime = std::chrono::seconds{usage.ru_utime.tv_sec + usage.ru_stime.tv_sec}
+            + std::chrono::microseconds{usage.ru_utime.tv_usec + usage.ru_stime.tv_usec};
+        result.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+        return result;
+    }
+}
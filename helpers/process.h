@@ -0,0 +1,32 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_PROCESS_H
+#define DCC_PROCESS_H
+
+#include <chrono>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Running other programs, such as gcc, without going through a shell or temporary files
+namespace Proc {
+    struct ProcessResult {
+        // The exit status, or 128 plus the signal number if the program was killed, as a shell would report it
+        int exitCode;
+        // Everything the program wrote to stdout. Its stderr goes straight to ours
+        std::string output;
+        // User plus system time the program used
+        std::chrono::microseconds cpuTime;
+
+        bool succeeded() const { return exitCode == 0; }
+    };
+
+    // Runs arguments[0], looked up on PATH, with input fed to its stdin and its stdout collected in memory
+    // Both happen at once, so a program that writes before it has read everything cannot deadlock against us
+    // Throws std::runtime_error if the program could not be started
+    ProcessResult run(const std::vector<std::string>& arguments, std::string_view input = {});
+}
+
+#endif //DCC_PROCESS_H
@@ -0,0 +1,109 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <bit>
+#include <cstring>
+
+#include "sha256.h"
+
+namespace Hash {
+    constexpr std::array<std::uint32_t, 64> g_roundConstants {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+
+    Sha256::Sha256()
+        : m_state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19}
+    {}
+
+    void Sha256::compress(const unsigned char* block) {
+        std::array<std::uint32_t, 64> schedule;
+        for (std::size_t i {0}; i < 16; ++i) {
+            schedule[i] = std::uint32_t{block[i * 4]} << 24 | std::uint32_t{block[i * 4 + 1]} << 16
+                | std::uint32_t{block[i * 4 + 2]} << 8 | std::uint32_t{block[i * 4 + 3]};
+        }
+        for (std::size_t i {16}; i < 64; ++i) {
+            std::uint32_t s0 {std::rotr(schedule[i - 15], 7) ^ std::rotr(schedule[i - 15], 18) ^ (schedule[i - 15] >> 3)};
+            std::uint32_t s1 {std::rotr(schedule[i - 2], 17) ^ std::rotr(schedule[i - 2], 19) ^ (schedule[i - 2] >> 10)};
+            schedule[i] = schedule[i - 16] + s0 + schedule[i - 7] + s1;
+        }
+
+        auto [a, b, c, d, e, f, g, h] {m_state};
+        for (std::size_t i {0}; i < 64; ++i) {
+            std::uint32_t s1 {std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25)};
+            std::uint32_t choice {(e & f) ^ (~e & g)};
+            std::uint32_t t1 {h + s1 + choice + g_roundConstants[i] + schedule[i]};
+            std::uint32_t s0 {std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22)};
+            std::uint32_t majority {(a & b) ^ (a & c) ^ (b & c)};
+            std::uint32_t t2 {s0 + majority};
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        m_state[0] += a;
+        m_state[1] += b;
+        m_state[2] += c;
+        m_state[3] += d;
+        m_state[4] += e;
+        m_state[5] += f;
+        m_state[6] += g;
+        m_state[7] += h;
+    }
+
+    void Sha256::update(std::string_view data) {
+        m_length += data.size();
+        const auto* bytes {reinterpret_cast<const unsigned char*>(data.data())};
+        std::size_t size {data.size()};
+
+        // Top up a partly filled block first, then hash whole blocks straight from data
+        if (m_blockSize > 0) {
+            std::size_t taken {std::min(size, m_block.size() - m_blockSize)};
+            std::memcpy(m_block.data() + m_blockSize, bytes, taken);
+            m_blockSize += taken;
+            bytes += taken;
+            size -= taken;
+            if (m_blockSize < m_block.size()) {
+                return;
+            }
+            compress(m_block.data());
+            m_blockSize = 0;
+        }
+        for (; size >= m_block.size(); bytes += m_block.size(), size -= m_block.size()) {
+            compress(bytes);
+        }
+        std::memcpy(m_block.data(), bytes, size);
+        m_blockSize = size;
+    }
+
+    std::string Sha256::hexDigest() {
+        // Pad with a 1 bit, zeros, then the length in bits as a big endian 64 bit number
+        std::uint64_t bits {m_length * 8};
+        std::array<unsigned char, 72> padding {0x80};
+        std::size_t padded {(m_blockSize < 56 ? 56 : 120) - m_blockSize};
+        for (std::size_t i {0}; i < 8; ++i) {
+            padding[padded + i] = static_cast<unsigned char>(bits >> (56 - i * 8));
+        }
+        update(std::string_view{reinterpret_cast<const char*>(padding.data()), padded + 8});
+
+        constexpr std::string_view digits {"0123456789abcdef"};
+        std::string digest;
+        for (std::uint32_t word : m_state) {
+            for (int shift {28}; shift >= 0; shift -= 4) {
+                digest += digits[(word >> shift) & 0xf];
+            }
+        }
+        return digest;
+    }
+}
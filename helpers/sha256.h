@@ -0,0 +1,33 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_SHA256_H
+#define DCC_SHA256_H
+
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Hash {
+    // SHA-256, for naming things by their contents where a collision would mean using the wrong thing
+    // Feed it with update() as many times as needed, then call hexDigest() once
+    class Sha256 {
+        std::array<std::uint32_t, 8> m_state;
+        std::array<unsigned char, 64> m_block {};
+        std::size_t m_blockSize {0};
+        std::uint64_t m_length {0};
+
+        void compress(const unsigned char* block);
+    public:
+        Sha256();
+
+        void update(std::string_view data);
+
+        // The 64 character lowercase hex digest of everything passed to update()
+        std::string hexDigest();
+    };
+}
+
+#endif //DCC_SHA256_H
@@ -0,0 +1,73 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <ostream>
+
+#include "symbol_table.h"
+
+namespace Sym {
+    // Returns the existing id for name, or stores it and returns a new one
+    SymbolId SymbolTable::intern(std::string_view name) {
+        ++m_requests;
+        m_requestedBytes += name.size();
+
+        auto found {m_lookup.find(name)};
+        if (found != m_lookup.end()) {
+            return found->second;
+        }
+
+        SymbolId id {size()};
+        const std::string& stored {m_names.emplace_back(name)};
+        m_lookup.emplace(stored, id);
+        m_storedBytes += stored.size();
+        return id;
+    }
+
+    // Interns every symbol of other in id order and returns the id each one has in this table
+    std::vector<SymbolId> SymbolTable::merge(const SymbolTable& other) {
+        std::vector<SymbolId> ids;
+        ids.reserve(other.size());
+        for (const std::string& name : other.m_names) {
+            auto found {m_lookup.find(name)};
+            if (found != m_lookup.end()) {
+                ids.push_back(found->second);
+                continue;
+            }
+
+            SymbolId id {size()};
+            const std::string& stored {m_names.emplace_back(name)};
+            m_lookup.emplace(stored, id);
+            m_storedBytes += stored.size();
+            ids.push_back(id);
+        }
+        m_requests += other.m_requests;
+        m_requestedBytes += other.m_requestedBytes;
+        return ids;
+    }
+
+    // Creates a new symbol named prefix.N that is distinct from every other symbol
+    SymbolId SymbolTable::createTemporary(std::string_view prefix) {
+        // Temporaries are unique by construction, so they skip the lookup table entirely
+        SymbolId id {size()};
+        m_names.emplace_back(std::string{prefix} + "." + std::to_string(++m_temporaryCount));
+        return id;
+    }
+
+    Stats SymbolTable::stats() const {
+        return Stats{m_requests, m_requestedBytes, m_names.size() - m_temporaryCount, m_storedBytes, m_temporaryCount};
+    }
+
+    // Prints a summary of the table's stats
+    void printStats(const Stats& stats, std::ostream& out) {
+        std::uint64_t savedBytes {stats.requestedBytes > stats.storedBytes ? stats.requestedBytes - stats.storedBytes : 0};
+        out << "Symbol table: " << stats.symbols << " symbols from " << stats.requests << " intern requests\n";
+        out << "\tbytes requested: " << stats.requestedBytes << "\n";
+        out << "\tbytes stored:    " << stats.storedBytes << "\n";
+        out << "\tbytes saved:     " << savedBytes << "\n";
+        out << "\ttemporaries:     " << stats.temporaries << "\n";
+        // Every stage now passes a 4 byte id around instead of its own copy of the string
+        out << "\tper reference:   " << sizeof(SymbolId) << " bytes instead of " << sizeof(std::string)
+            << " plus the text\n";
+    }
+}
@@ -0,0 +1,65 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_SYMBOL_TABLE_H
+#define DCC_SYMBOL_TABLE_H
+
+#include <cstdint>
+#include <deque>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Sym {
+    // Small integer handle for an interned string
+    // Ids are handed out densely from 0, so later stages can index arrays with them
+    using SymbolId = std::uint32_t;
+
+    // Counters describing how much copying interning has avoided
+    struct Stats {
+        std::uint64_t requests;       // Calls to intern
+        std::uint64_t requestedBytes; // Total length of every string passed to intern
+        std::uint64_t symbols;        // Distinct strings stored, not counting temporaries
+        std::uint64_t storedBytes;    // Total length of the distinct strings
+        std::uint64_t temporaries;    // Compiler generated names
+    };
+
+    // Stores each string once and hands out SymbolIds for it
+    // One table is shared by every stage of a compilation, from the lexer through to emission
+    class SymbolTable {
+        // A deque keeps the strings in place so the lookup keys stay valid
+        std::deque<std::string> m_names;
+        std::unordered_map<std::string_view, SymbolId> m_lookup;
+        std::uint64_t m_requests {0};
+        std::uint64_t m_requestedBytes {0};
+        std::uint64_t m_storedBytes {0};
+        std::uint64_t m_temporaryCount {0};
+    public:
+        // Returns the existing id for name, or stores it and returns a new one
+        SymbolId intern(std::string_view name);
+
+        // Creates a new symbol named prefix.N that is distinct from every other symbol
+        // Used for compiler generated names, which can never clash with source identifiers as they contain a '.'
+        SymbolId createTemporary(std::string_view prefix);
+
+        // Interns every symbol of other in id order and returns the id each one has in this table, indexed by its id in
+        // other. Merging several tables in order hands out the same ids as interning everything into one table would
+        // other's request counts are added on, so the stats come out the same as well
+        // other must not hold any temporaries
+        std::vector<SymbolId> merge(const SymbolTable& other);
+
+        const std::string& name(SymbolId id) const { return m_names[id]; }
+
+        SymbolId size() const { return static_cast<SymbolId>(m_names.size()); }
+
+        Stats stats() const;
+    };
+
+    // Prints a summary of the table's stats
+    void printStats(const Stats& stats, std::ostream& out);
+}
+
+#endif //DCC_SYMBOL_TABLE_H
@@ -0,0 +1,51 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include "thread_pool.h"
+
+namespace Threads {
+    std::size_t hardwareThreads() {
+        // hardware_concurrency is allowed to return 0 if it cannot tell
+        unsigned int threads {std::thread::hardware_concurrency()};
+        return threads == 0 ? 1 : threads;
+    }
+
+    ThreadPool::ThreadPool(std::size_t threads) {
+        if (threads == 0) {
+            threads = 1;
+        }
+        m_workers.reserve(threads);
+        for (std::size_t i {0}; i < threads; ++i) {
+            m_workers.emplace_back([this]() { work(); });
+        }
+    }
+
+    ThreadPool::~ThreadPool() {
+        {
+            std::lock_guard lock {m_mutex};
+            m_stopping = true;
+        }
+        m_wake.notify_all();
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    // Take jobs off the queue until the pool is stopping and the queue is empty
+    void ThreadPool::work() {
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock lock {m_mutex};
+                m_wake.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+                if (m_jobs.empty()) {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop();
+            }
+            job();
+        }
+    }
+}
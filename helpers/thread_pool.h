@@ -0,0 +1,75 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_THREAD_POOL_H
+#define DCC_THREAD_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Threads {
+    // Number of threads to use when the user asks for "as many as there are cores"
+    std::size_t hardwareThreads();
+
+    // A fixed set of worker threads that run jobs in the order they were submitted
+    // The destructor finishes every queued job before joining the workers
+    class ThreadPool {
+        std::vector<std::thread> m_workers;
+        std::queue<std::function<void()>> m_jobs;
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        bool m_stopping {false};
+
+        void work();
+    public:
+        explicit ThreadPool(std::size_t threads);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        std::size_t size() const { return m_workers.size(); }
+
+        // Queue job to run on a worker. Exceptions it throws are rethrown by the future's get()
+        template <typename Job>
+        std::future<std::invoke_result_t<Job>> submit(Job job) {
+            // packaged_task is move only, but std::function needs something copyable, so it goes behind a shared_ptr
+            auto task {std::make_shared<std::packaged_task<std::invoke_result_t<Job>()>>(std::move(job))};
+            auto result {task->get_future()};
+            {
+                std::lock_guard lock {m_mutex};
+                m_jobs.emplace([task]() { (*task)(); });
+            }
+            m_wake.notify_one();
+            return result;
+        }
+    };
+
+    // Runs job(0) to job(count - 1) on the pool and waits for all of them
+    // The first exception thrown by any job is rethrown once they have all finished
+    template <typename Job>
+    void parallelFor(ThreadPool& pool, std::size_t count, Job job) {
+        std::vector<std::future<void>> pending;
+        pending.reserve(count);
+        for (std::size_t i {0}; i < count; ++i) {
+            pending.push_back(pool.submit([&job, i]() { job(i); }));
+        }
+        for (auto& result : pending) {
+            result.wait();
+        }
+        for (auto& result : pending) {
+            result.get();
+        }
+    }
+}
+
+#endif //DCC_THREAD_POOL_H
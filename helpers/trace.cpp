@@ -0,0 +1,156 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "trace.h"
+
+namespace Trace {
+    // A complete event, "ph": "X" in the trace format, with times in nanoseconds since tracing was enabled
+    struct Event {
+        std::string_view name;
+        std::int64_t start;
+        std::int64_t duration;
+        std::string args;
+    };
+
+    // Only ever appended to by the thread that owns it
+    struct ThreadBuffer {
+        std::size_t id;
+        std::string name;
+        std::vector<Event> events;
+    };
+
+    constinit std::atomic<bool> g_enabled {false};
+    std::chrono::steady_clock::time_point g_epoch;
+    std::thread::id g_mainThread;
+
+    // Buffers live here rather than in the threads, so they outlive the workers that filled them
+    std::mutex g_buffersMutex;
+    std::vector<std::unique_ptr<ThreadBuffer>> g_buffers;
+    constinit thread_local ThreadBuffer* t_buffer {nullptr};
+
+    ThreadBuffer& threadBuffer() {
+        if (!t_buffer) {
+            std::lock_guard lock {g_buffersMutex};
+            auto buffer {std::make_unique<ThreadBuffer>()};
+            buffer->id = g_buffers.size() + 1;
+            buffer->name = std::this_thread::get_id() == g_mainThread ? "main" : "worker " + std::to_string(buffer->id);
+            t_buffer = buffer.get();
+            g_buffers.push_back(std::move(buffer));
+        }
+        return *t_buffer;
+    }
+
+    std::int64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - g_epoch).count();
+    }
+
+    void appendEscaped(std::string& out, std::string_view text) {
+        constexpr std::string_view hex {"0123456789abcdef"};
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+                out += c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                out += "\\u00";
+                out += hex[c >> 4];
+                out += hex[c & 0xf];
+            } else {
+                out += c;
+            }
+        }
+    }
+
+    void enable() {
+        g_epoch = std::chrono::steady_clock::now();
+        g_mainThread = std::this_thread::get_id();
+        g_enabled.store(true, std::memory_order_release);
+    }
+
+    bool enabled() {
+        return g_enabled.load(std::memory_order_acquire);
+    }
+
+    Span::Span(std::string_view name)
+        : m_name{name}
+    {
+        if (enabled()) {
+            m_start = now();
+        }
+    }
+
+    Span::~Span() {
+        if (active()) {
+            std::int64_t end {now()};
+            threadBuffer().events.push_back(Event{m_name, m_start, end - m_start, std::move(m_args)});
+        }
+    }
+
+    void Span::arg(std::string_view key, std::string_view value) {
+        if (!active()) {
+            return;
+        }
+        if (!m_args.empty()) {
+            m_args += ',';
+        }
+        m_args += '"';
+        appendEscaped(m_args, key);
+        m_args += "\":\"";
+        appendEscaped(m_args, value);
+        m_args += '"';
+    }
+
+    void Span::arg(std::string_view key, std::uint64_t value) {
+        if (!active()) {
+            return;
+        }
+        if (!m_args.empty()) {
+            m_args += ',';
+        }
+        m_args += '"';
+        appendEscaped(m_args, key);
+        m_args += "\":" + std::to_string(value);
+    }
+
+    // Trace times are in microseconds, kept to nanosecond precision
+    std::string microseconds(std::int64_t nanoseconds) {
+        std::string fraction {std::to_string(nanoseconds % 1000)};
+        return std::to_string(nanoseconds / 1000) + "." + std::string(3 - fraction.size(), '0') + fraction;
+    }
+
+    bool write(const std::filesystem::path& path) {
+        std::ofstream out {path};
+        if (!out) {
+            return false;
+        }
+        std::lock_guard lock {g_buffersMutex};
+        std::string pid {std::to_string(getpid())};
+        std::string text {"{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n"};
+        text += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"args\":{\"name\":\"dcc\"}}";
+        for (const auto& buffer : g_buffers) {
+            std::string tid {std::to_string(buffer->id)};
+            text += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + pid + ",\"tid\":" + tid
+                + ",\"args\":{\"name\":\"" + buffer->name + "\"}}";
+            for (const auto& event : buffer->events) {
+                text += ",\n{\"name\":\"";
+                appendEscaped(text, event.name);
+                text += "\",\"cat\":\"dcc\",\"ph\":\"X\",\"ts\":" + microseconds(event.start) + ",\"dur\":"
+                    + microseconds(event.duration) + ",\"pid\":" + pid + ",\"tid\":" + tid + ",\"args\":{" + event.args
+                    + "}}";
+            }
+        }
+        text += "\n]}\n";
+        out << text;
+        return static_cast<bool>(out.flush());
+    }
+}
@@ -0,0 +1,51 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_TRACE_H
+#define DCC_TRACE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+// Records spans of time in the Chrome trace event format, for viewing in Perfetto or chrome://tracing
+// Each thread appends to a buffer of its own, so recording an event takes no lock and threads never wait on each other.
+// A thread only takes a lock the first time it records anything, to register its buffer
+// Until enable() is called a span costs one load and a branch
+namespace Trace {
+    // Starts recording, with times measured from now
+    void enable();
+
+    bool enabled();
+
+    // A span of time on the calling thread, from construction to destruction
+    // Spans on one thread nest by time, so a span made inside another shows up beneath it
+    class Span {
+        std::string_view m_name;
+        std::int64_t m_start {-1};
+        // Already formatted as the members of a JSON object
+        std::string m_args;
+    public:
+        // name must outlive the trace, which a string literal does
+        explicit Span(std::string_view name);
+        ~Span();
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+        // False if tracing was off when the span started. Worth checking before working out an expensive argument
+        bool active() const { return m_start >= 0; }
+
+        // Attaches metadata, which is shown alongside the span. Does nothing if the span is not active
+        void arg(std::string_view key, std::string_view value);
+        void arg(std::string_view key, std::uint64_t value);
+    };
+
+    // Writes every event recorded so far as a JSON trace
+    // No other thread may be recording while this runs. Returns false if the file could not be written
+    bool write(const std::filesystem::path& path);
+}
+
+#endif //DCC_TRACE_H
@@ -1,78 +1,216 @@
+
+
 // Generate a list of tokens from an inputted file
 
+#include <algorithm>
+#include <charconv>
 #include <vector>
-#include <array>
-#include <fstream>
-#include <iostream>
-#include <functional>
 #include "lexer.h"
+#include "../helpers/thread_pool.h"
 
 namespace Lexer {
 
-    void shrinkLine(std::string& line, std::smatch& match) {
-        line = line.substr(match.position(0) + match.length());
+    // Works out the kind of a single punctuation character (or the start of a two character one)
+    // Returns the number of characters consumed, or 0 if the character is not a known token
+    std::size_t lexPunctuation(std::string_view rest, Token::Kind& kind) {
+        switch (rest.front()) {
+            case '(': kind = Token::OpenParenT;  return 1;
+            case ')': kind = Token::CloseParenT; return 1;
+            case '{': kind = Token::OpenBraceT;  return 1;
+            case '}': kind = Token::CloseBraceT; return 1;
+            case ';': kind = Token::SemicolonT;  return 1;
+            case '~': kind = Token::BitwisenotT; return 1;
+            case '+': kind = Token::AddT;        return 1;
+            case '/': kind = Token::DivideT;     return 1;
+            case '*': kind = Token::MultiplyT;   return 1;
+            case '%': kind = Token::ModuloT;     return 1;
+            case '-':
+                // Longest match wins, so -- is a decrement rather than two negates
+                if (rest.size() > 1 && rest[1] == '-') {
+                    kind = Token::DecrementT;
+                    return 2;
+                }
+                kind = Token::NegateT;
+                return 1;
+            default:
+                return 0;
+        }
     }
 
-    // Iterate over file token by token, generating a vector of tokens as it goes.
-    std::vector<Token::Token> lexFile(const std::filesystem::path& inputFile) {
-        // Create the vector to be outputted
-        std::vector<Token::Token> tokens;
-        tokens.reserve(100);
-
-        // Open the inputted file
-        std::ifstream file { inputFile };
-
-        // Iterate over the file line by line
-        std::string line {};
-        int lineCounter {0};
-        while (std::getline(file, line)) {
-            ++lineCounter;
-            // While input isn't empty
-            while (!line.empty()) {
-                std::smatch match;
-                //  if input starts with whitespace, trim it
-                if (std::regex_search(line, match, initialWhitespace)) {
-                    shrinkLine(line, match);
+    // Most runs are only a few characters long, so the start of each run is checked inline and the vector kernel
+    // is only called for runs that carry on past that
+    template <bool (*inRun)(char)>
+    const char* skipRun(const char* current, const char* end, Scan::RunScanner kernel) {
+        constexpr std::ptrdiff_t inlineLength {16};
+        const char* inlineEnd {end - current > inlineLength ? current + inlineLength : end};
+        while (current != inlineEnd && inRun(*current)) {
+            ++current;
+        }
+        if (current == inlineEnd && current != end) {
+            return kernel(current, end);
+        }
+        return current;
+    }
+
+    constexpr bool isWhitespace(char c) { return charClass(c) == WhitespaceC; }
+    constexpr bool isDigit(char c) { return charClass(c) == DigitC; }
+
+    bool Scanner::next(Token::Token& token) {
+        auto offsetOf = [this](const char* position) -> Src::Offset {
+            return static_cast<Src::Offset>(position - m_begin);
+        };
+
+        // Loop until a token is found, skipping whitespace and anything that has to be reported
+        while (m_current != m_end) {
+            const char* start {m_current};
+            switch (charClass(*m_current)) {
+                case WhitespaceC: {
+                    m_current = skipRun<isWhitespace>(m_current + 1, m_end, m_kernels.whitespace);
+                    break;
                 }
-                // else find longest regex match at start of input
-                else {
-                    int index {-1};
-                    bool firstMatch {true};
-                    bool matched {false};
-
-                    // Iterate over the list of patterns to find the longest match
-                    for (int i {0}; i < std::ssize(Token::patterns); ++i) {
-                        std::smatch tmp;
-                        // If the search returns anything, make sure it's the longest result
-                        if (std::regex_search(line, tmp, Token::patterns.data()[i].first)) {
-                            // Note that this relies on keywords being lower down in patterns than identifiers
-                            if (tmp.length(0)>= match.length(0) || firstMatch) {
-                                match = tmp;
-                                index = i;
-                            }
-                            firstMatch = false;
-                            matched = true;
-                        }
+                case IdentifierStartC: {
+                    m_current = skipRun<isIdentifierChar>(m_current + 1, m_end, m_kernels.identifier);
+                    std::string_view word {start, static_cast<std::size_t>(m_current - start)};
+                    auto length {static_cast<std::uint32_t>(word.size())};
+
+                    // Keywords take priority over identifiers of the same length
+                    Token::Kind kind {findKeyword(word)};
+                    if (kind == Token::IdentifierT) {
+                        token = Token::Token{kind, length, m_symbols.intern(word), offsetOf(start)};
+                    } else {
+                        token = Token::Token{kind, length, 0, offsetOf(start)};
                     }
-                    // If there are no matches, exit with an error message
-                    if (!matched) {
-                        std::cout << "Incorrect syntax in line " << lineCounter << "\n";
-                        exit(1);
+                    return true;
+                }
+                case DigitC: {
+                    m_current = skipRun<isDigit>(m_current + 1, m_end, m_kernels.digits);
+                    // A constant must end on a word boundary, so 123abc is an error rather than two tokens
+                    if (m_current != m_end && charClass(*m_current) == IdentifierStartC) {
+                        m_current = skipRun<isIdentifierChar>(m_current, m_end, m_kernels.identifier);
+                        m_diagnostics.push_back({offsetOf(start), "invalid suffix on integer constant \""
+                                                 + std::string{start, m_current} + "\""});
+                        break;
                     }
 
-                    // If there are, generate a token to match it and then append it to tokens
-                    tokens.emplace_back(Token::patterns.data()[index].second(match));
-
-                    shrinkLine(line, match);
+                    int value {};
+                    auto [ptr, ec] {std::from_chars(start, m_current, value)};
+                    if (ec != std::errc{}) {
+                        m_diagnostics.push_back({offsetOf(start), "integer constant \"" + std::string{start, m_current}
+                                                 + "\" is too large"});
+                        break;
+                    }
+                    token = Token::Token{Token::ConstantT, static_cast<std::uint32_t>(m_current - start),
+                                         std::bit_cast<std::uint32_t>(value), offsetOf(start)};
+                    return true;
+                }
+                case PunctuationC: {
+                    Token::Kind kind {};
+                    std::size_t consumed {lexPunctuation({m_current, static_cast<std::size_t>(m_end - m_current)}, kind)};
+                    m_current += consumed;
+                    token = Token::Token{kind, static_cast<std::uint32_t>(consumed), 0, offsetOf(start)};
+                    return true;
+                }
+                default: {
+                    // If the character cannot start any token, record it and carry on from the next character
+                    m_diagnostics.push_back({offsetOf(m_current), "unexpected character '" + std::string{*m_current} + "'"});
+                    ++m_current;
                 }
-                // Iterate over list of regexes to find the longest match
-                // if no match, raise error
-                // convert match to token
-                // remove match from input
             }
         }
+        return false;
+    }
+
+    // Iterate over the text once, generating a buffer of every token as it goes.
+    Token::TokenBuffer lexString(std::string_view text, Sym::SymbolTable& symbols, Src::Diagnostics& diagnostics,
+                                 const Scan::Kernels& kernels) {
+        // Create the buffer to be outputted
+        Token::TokenBuffer tokens;
+        tokens.reserve(text.size() / 4);
+
+        Scanner scanner {text, symbols, diagnostics, kernels};
+        Token::Token token;
+        while (scanner.next(token)) {
+            tokens.push(token);
+        }
         return tokens;
+    }
 
+    // Split text into up to count pieces of roughly equal size, each ending just after a newline (bar the last)
+    // No piece is made smaller than minimum, so small inputs are not worth splitting
+    std::vector<std::string_view> splitAtNewlines(std::string_view text, std::size_t count, std::size_t minimum) {
+        std::vector<std::string_view> chunks;
+        std::size_t target {std::max(text.size() / std::max<std::size_t>(count, 1), minimum)};
+        while (!text.empty()) {
+            if (text.size() <= target) {
+                chunks.push_back(text);
+                break;
+            }
+            // Move the cut forward to just after the next newline. With no newline left, the rest is one chunk
+            std::size_t newline {text.find('\n', target)};
+            std::size_t cut {newline == std::string_view::npos ? text.size() : newline + 1};
+            chunks.push_back(text.substr(0, cut));
+            text.remove_prefix(cut);
+        }
+        return chunks;
+    }
+
+    // Everything one chunk produces, with offsets and symbol ids local to the chunk
+    struct ChunkResult {
+        Token::TokenBuffer tokens;
+        Sym::SymbolTable symbols;
+        Src::Diagnostics diagnostics;
+    };
 
+    Token::TokenBuffer lexFile(const Src::SourceFile& file, Sym::SymbolTable& symbols, Src::Diagnostics& diagnostics,
+                               std::size_t threads, const Scan::Kernels& kernels) {
+        // A few chunks per thread evens out chunks that happen to lex slower than others
+        constexpr std::size_t chunksPerThread {4};
+        constexpr std::size_t minimumChunkBytes {1 << 18};
+
+        std::string_view text {file.text()};
+        std::vector<std::string_view> chunks {splitAtNewlines(text, threads * chunksPerThread, minimumChunkBytes)};
+        if (threads <= 1 || chunks.size() <= 1) {
+            return lexString(text, symbols, diagnostics, kernels);
+        }
+
+        Threads::ThreadPool pool {std::min(threads, chunks.size())};
+        std::vector<ChunkResult> results(chunks.size());
+        Threads::parallelFor(pool, chunks.size(), [&](std::size_t i) {
+            results[i].tokens = lexString(chunks[i], results[i].symbols, results[i].diagnostics, kernels);
+        });
+
+        // Merging the symbol tables in chunk order hands out ids in order of first appearance, as one scan would
+        // Each chunk's first token lands at the running total of the chunks before it
+        std::vector<std::vector<Sym::SymbolId>> symbolMaps(chunks.size());
+        std::vector<Token::TokenBuffer::Index> firstToken(chunks.size());
+        Token::TokenBuffer::Index totalTokens {0};
+        for (std::size_t i {0}; i < chunks.size(); ++i) {
+            auto base {static_cast<Src::Offset>(chunks[i].data() - text.data())};
+            symbolMaps[i] = symbols.merge(results[i].symbols);
+            for (auto& diagnostic : results[i].diagnostics) {
+                diagnostics.push_back({diagnostic.offset + base, std::move(diagnostic.message)});
+            }
+            firstToken[i] = totalTokens;
+            totalTokens += results[i].tokens.size();
+        }
+
+        // Every chunk copies its tokens into its own slice of the output, moving offsets and ids into file terms
+        Token::TokenBuffer tokens;
+        tokens.resize(totalTokens);
+        Threads::parallelFor(pool, chunks.size(), [&](std::size_t i) {
+            auto base {static_cast<Src::Offset>(chunks[i].data() - text.data())};
+            Token::TokenBuffer& local {results[i].tokens};
+            for (Token::TokenBuffer::Index j {0}; j < local.size(); ++j) {
+                Token::Token token {local[j]};
+                token.offset += base;
+                if (token.kind == Token::IdentifierT) {
+                    token.value = symbolMaps[i][token.value];
+                }
+                tokens.set(firstToken[i] + j, token);
+            }
+            // Free each chunk as soon as it is copied to keep peak memory down
+            local = Token::TokenBuffer{};
+        });
+        return tokens;
     }
 }
\ No newline at end of file
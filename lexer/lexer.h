@@ -5,18 +5,160 @@
 #ifndef DCC_LEXER_H
 #define DCC_LEXER_H
 
-#include <regex>
+#include <array>
+#include <cstdint>
 #include <string>
-#include <filesystem>
-#include "tokens.h"
+#include <string_view>
+#include "simd_scan.h"
+#include "source.h"
+#include "token_source.h"
 
 namespace Lexer {
-    static const std::regex initialWhitespace("^\\s+");
+    ///////////////////////////
+    /// Character Classes ///
+    //////////////////////////
+    // Every byte of input falls into exactly one of these classes
+    enum CharClass : std::uint8_t {
+        InvalidC,
+        WhitespaceC,
+        IdentifierStartC,
+        DigitC,
+        PunctuationC,
+        max_char_class
+    };
 
-    // Reduce size of line after regex match
-    void shrinkLine(std::string& line, std::smatch& match);
+    // Lookup table indexed by the raw byte value of a character
+    constexpr std::array<CharClass, 256> charClasses = [] {
+        std::array<CharClass, 256> table {};
+        for (auto c : std::string_view{" \t\n\v\f\r"}) {
+            table[static_cast<unsigned char>(c)] = WhitespaceC;
+        }
+        for (int c {'a'}; c <= 'z'; ++c) {
+            table[c] = IdentifierStartC;
+        }
+        for (int c {'A'}; c <= 'Z'; ++c) {
+            table[c] = IdentifierStartC;
+        }
+        table['_'] = IdentifierStartC;
+        for (int c {'0'}; c <= '9'; ++c) {
+            table[c] = DigitC;
+        }
+        for (auto c : std::string_view{"(){};-~+/*%"}) {
+            table[static_cast<unsigned char>(c)] = PunctuationC;
+        }
+        return table;
+    }();
 
-    // Iterate over file token by token, generating a vector of tokens as it goes.
-    std::vector<Token::Token> lexFile(const std::filesystem::path& inputFile);
+    constexpr CharClass charClass(char c) { return charClasses[static_cast<unsigned char>(c)]; }
+
+    // Identifiers may continue with digits as well as letters and underscores
+    constexpr bool isIdentifierChar(char c) {
+        CharClass cls {charClass(c)};
+        return cls == IdentifierStartC || cls == DigitC;
+    }
+
+    ////////////////
+    /// Keywords ///
+    ////////////////
+    // Keywords are recognised with a perfect hash over the identifier text, so telling a keyword from an identifier
+    // costs one hash and at most one string comparison.
+    // Update when add new keyword
+    constexpr std::array<std::string_view, 3> keywordStrings {"return", "int", "void"};
+    constexpr std::array<Token::Kind, 3> keywordKinds {Token::ReturnT, Token::IntT, Token::VoidT};
+    static_assert(std::size(keywordStrings) == std::size(keywordKinds)
+        && "keywordStrings and keywordKinds are different sizes");
+
+    // Size of the keyword hash table. Must be a power of two
+    constexpr std::size_t keywordTableSize {8};
+
+    constexpr std::size_t keywordHash(std::string_view word, std::size_t seed) {
+        auto first {static_cast<unsigned char>(word.front())};
+        auto last {static_cast<unsigned char>(word.back())};
+        return (first * seed + last + word.size()) & (keywordTableSize - 1);
+    }
+
+    // Search for a seed that places every keyword in its own slot
+    constexpr std::size_t keywordSeed = [] {
+        for (std::size_t seed {1}; seed < 1024; ++seed) {
+            std::array<bool, keywordTableSize> used {};
+            bool collision {false};
+            for (auto word : keywordStrings) {
+                std::size_t slot {keywordHash(word, seed)};
+                collision = collision || used[slot];
+                used[slot] = true;
+            }
+            if (!collision) {
+                return seed;
+            }
+        }
+        return std::size_t{0};
+    }();
+    static_assert(keywordSeed != 0 && "No perfect hash seed found for the keyword table");
+
+    // Hash slot -> index into keywordStrings, with -1 marking an empty slot
+    constexpr std::array<int, keywordTableSize> keywordTable = [] {
+        std::array<int, keywordTableSize> table {};
+        table.fill(-1);
+        for (std::size_t i {0}; i < std::size(keywordStrings); ++i) {
+            table[keywordHash(keywordStrings[i], keywordSeed)] = static_cast<int>(i);
+        }
+        return table;
+    }();
+
+    // Returns the keyword's kind, or IdentifierT if word is not a keyword
+    constexpr Token::Kind findKeyword(std::string_view word) {
+        int candidate {keywordTable[keywordHash(word, keywordSeed)]};
+        if (candidate != -1 && keywordStrings[candidate] == word) {
+            return keywordKinds[candidate];
+        }
+        return Token::IdentifierT;
+    }
+    static_assert(findKeyword("return") == Token::ReturnT && findKeyword("int") == Token::IntT
+        && findKeyword("void") == Token::VoidT);
+    static_assert(findKeyword("integer") == Token::IdentifierT && findKeyword("x") == Token::IdentifierT);
+
+    ///////////////
+    /// Scanner ///
+    ///////////////
+    // Produces tokens one at a time from a block of text, only scanning as far as it has been asked to
+    // Characters that cannot start a token are added to diagnostics and skipped, so every error in the input is
+    // reported in one run
+    // Identifier names are interned into symbols
+    // Runs of whitespace, identifier characters and digits are skipped with the kernels from simd_scan.h
+    class Scanner final : public Token::TokenSource {
+        const char* m_begin;
+        const char* m_current;
+        const char* m_end;
+        Sym::SymbolTable& m_symbols;
+        Src::Diagnostics& m_diagnostics;
+        const Scan::Kernels& m_kernels;
+    public:
+        Scanner(std::string_view text, Sym::SymbolTable& symbols, Src::Diagnostics& diagnostics,
+                const Scan::Kernels& kernels = Scan::bestKernels())
+            : m_begin{text.data()}
+            , m_current{text.data()}
+            , m_end{text.data() + text.size()}
+            , m_symbols{symbols}
+            , m_diagnostics{diagnostics}
+            , m_kernels{kernels}
+        {}
+
+        bool next(Token::Token& token) override;
+
+        // Bytes of text not yet scanned
+        std::size_t remaining() const { return static_cast<std::size_t>(m_end - m_current); }
+    };
+
+    // Iterate over the text once, generating a buffer of every token as it goes.
+    Token::TokenBuffer lexString(std::string_view text, Sym::SymbolTable& symbols, Src::Diagnostics& diagnostics,
+                                 const Scan::Kernels& kernels = Scan::bestKernels());
+
+    // Lex a whole file, splitting it at newlines into chunks that are lexed on threads worker threads
+    // Preprocessed text has no comments or multi-line tokens, so no token can cross a newline. Each chunk gets its own
+    // symbol table and the tables are merged in chunk order, so the tokens, symbol ids and diagnostics all come out
+    // exactly as a single threaded run would give them
+    // Small files, or threads of 1, are lexed on the calling thread
+    Token::TokenBuffer lexFile(const Src::SourceFile& file, Sym::SymbolTable& symbols, Src::Diagnostics& diagnostics,
+                               std::size_t threads = 1, const Scan::Kernels& kernels = Scan::bestKernels());
 }
 #endif //DCC_LEXER_H
\ No newline at end of file
@@ -0,0 +1,169 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <bit>
+#include <cstdint>
+
+#include "simd_scan.h"
+#include "lexer.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define DCC_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+namespace Lexer::Scan {
+    //////////////
+    /// Scalar ///
+    //////////////
+    const char* scalarWhitespace(const char* begin, const char* end) {
+        while (begin != end && charClass(*begin) == WhitespaceC) {
+            ++begin;
+        }
+        return begin;
+    }
+
+    const char* scalarIdentifier(const char* begin, const char* end) {
+        while (begin != end && isIdentifierChar(*begin)) {
+            ++begin;
+        }
+        return begin;
+    }
+
+    const char* scalarDigits(const char* begin, const char* end) {
+        while (begin != end && charClass(*begin) == DigitC) {
+            ++begin;
+        }
+        return begin;
+    }
+
+    const Kernels& scalarKernels() {
+        static constexpr Kernels kernels {"scalar", scalarWhitespace, scalarIdentifier, scalarDigits};
+        return kernels;
+    }
+
+#ifdef DCC_X86_KERNELS
+    ////////////
+    /// SSE2 ///
+    ////////////
+    // Each function works out a mask of which bytes are in the run, then finds the first byte that is not.
+    // Anything shorter than a full vector is finished by the scalar version, so nothing past end is ever read.
+    // These must accept exactly the characters the lexer's charClasses table does
+
+    // Bytes of x in the unsigned range [lo, hi]
+    // Shifting the range down to start at -128 lets one signed comparison check both ends
+    __attribute__((target("sse2")))
+    inline __m128i inRange16(__m128i x, char lo, char hi) {
+        __m128i shifted {_mm_add_epi8(x, _mm_set1_epi8(static_cast<char>(-128 - lo)))};
+        return _mm_cmplt_epi8(shifted, _mm_set1_epi8(static_cast<char>(-128 + (hi - lo) + 1)));
+    }
+
+    __attribute__((target("sse2")))
+    inline __m128i whitespace16(__m128i x) {
+        return _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), inRange16(x, '\t', '\r'));
+    }
+
+    __attribute__((target("sse2")))
+    inline __m128i digits16(__m128i x) {
+        return inRange16(x, '0', '9');
+    }
+
+    __attribute__((target("sse2")))
+    inline __m128i identifier16(__m128i x) {
+        // Setting bit 5 folds upper case letters onto lower case ones
+        __m128i letters {inRange16(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z')};
+        __m128i underscore {_mm_cmpeq_epi8(x, _mm_set1_epi8('_'))};
+        return _mm_or_si128(_mm_or_si128(letters, underscore), digits16(x));
+    }
+
+    template <__m128i (*classify)(__m128i), RunScanner finish>
+    __attribute__((target("sse2")))
+    const char* sse2Run(const char* begin, const char* end) {
+        while (end - begin >= 16) {
+            __m128i x {_mm_loadu_si128(reinterpret_cast<const __m128i*>(begin))};
+            auto outside {~static_cast<unsigned>(_mm_movemask_epi8(classify(x))) & 0xFFFFu};
+            if (outside != 0) {
+                return begin + std::countr_zero(outside);
+            }
+            begin += 16;
+        }
+        return finish(begin, end);
+    }
+
+    ////////////
+    /// AVX2 ///
+    ////////////
+    __attribute__((target("avx2")))
+    inline __m256i inRange32(__m256i x, char lo, char hi) {
+        __m256i shifted {_mm256_add_epi8(x, _mm256_set1_epi8(static_cast<char>(-128 - lo)))};
+        return _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + (hi - lo) + 1)), shifted);
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i whitespace32(__m256i x) {
+        return _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), inRange32(x, '\t', '\r'));
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i digits32(__m256i x) {
+        return inRange32(x, '0', '9');
+    }
+
+    __attribute__((target("avx2")))
+    inline __m256i identifier32(__m256i x) {
+        __m256i letters {inRange32(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z')};
+        __m256i underscore {_mm256_cmpeq_epi8(x, _mm256_set1_epi8('_'))};
+        return _mm256_or_si256(_mm256_or_si256(letters, underscore), digits32(x));
+    }
+
+    // Falls back to the SSE2 kernel for the last 16 to 31 bytes
+    template <__m256i (*classify)(__m256i), RunScanner finish>
+    __attribute__((target("avx2")))
+    const char* avx2Run(const char* begin, const char* end) {
+        while (end - begin >= 32) {
+            __m256i x {_mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin))};
+            auto outside {~static_cast<std::uint32_t>(_mm256_movemask_epi8(classify(x)))};
+            if (outside != 0) {
+                return begin + std::countr_zero(outside);
+            }
+            begin += 32;
+        }
+        return finish(begin, end);
+    }
+
+    constexpr RunScanner sse2Whitespace {sse2Run<whitespace16, scalarWhitespace>};
+    constexpr RunScanner sse2Identifier {sse2Run<identifier16, scalarIdentifier>};
+    constexpr RunScanner sse2Digits {sse2Run<digits16, scalarDigits>};
+
+    const Kernels* sse2Kernels() {
+        static constexpr Kernels kernels {"sse2", sse2Whitespace, sse2Identifier, sse2Digits};
+        return __builtin_cpu_supports("sse2") ? &kernels : nullptr;
+    }
+
+    const Kernels* avx2Kernels() {
+        static constexpr Kernels kernels {"avx2",
+            avx2Run<whitespace32, sse2Whitespace>,
+            avx2Run<identifier32, sse2Identifier>,
+            avx2Run<digits32, sse2Digits>};
+        return __builtin_cpu_supports("avx2") ? &kernels : nullptr;
+    }
+#else
+    const Kernels* sse2Kernels() { return nullptr; }
+    const Kernels* avx2Kernels() { return nullptr; }
+#endif
+
+    // Widest set of kernels the CPU supports, checked with CPUID the first time it is called
+    const Kernels& bestKernels() {
+        static const Kernels& best {[]() -> const Kernels& {
+            if (const Kernels* avx2 {avx2Kernels()}) {
+                return *avx2;
+            }
+            if (const Kernels* sse2 {sse2Kernels()}) {
+                return *sse2;
+            }
+            return scalarKernels();
+        }()};
+        return best;
+    }
+}
@@ -0,0 +1,34 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_SIMD_SCAN_H
+#define DCC_SIMD_SCAN_H
+
+#include <string_view>
+
+// Kernels that find the end of a run of whitespace, identifier characters or digits
+// The vector versions check 16 or 32 bytes at a time and must give exactly the same answer as the scalar ones
+namespace Lexer::Scan {
+    // Returns a pointer to the first character in [begin, end) that is not part of the run, or end
+    using RunScanner = const char* (*)(const char* begin, const char* end);
+
+    struct Kernels {
+        std::string_view name;
+        RunScanner whitespace;
+        RunScanner identifier;
+        RunScanner digits;
+    };
+
+    // One byte at a time, using the lexer's character class table
+    const Kernels& scalarKernels();
+
+    // Returns nullptr for kernel sets this build or CPU cannot run
+    const Kernels* sse2Kernels();
+    const Kernels* avx2Kernels();
+
+    // Widest set of kernels the CPU supports, checked with CPUID the first time it is called
+    const Kernels& bestKernels();
+}
+
+#endif //DCC_SIMD_SCAN_H
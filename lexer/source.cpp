@@ -0,0 +1,127 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "source.h"
+
+namespace Src {
+    SourceFile::SourceFile(std::filesystem::path path, std::string text)
+        : m_path{std::move(path)}
+    {
+        auto owned {std::make_shared<const std::string>(std::move(text))};
+        m_text = *owned;
+        m_storage = std::move(owned);
+    }
+
+    Location SourceFile::location(Offset offset) const {
+        // Build the line table on first use
+        if (m_lineStarts.empty()) {
+            m_lineStarts.push_back(0);
+            for (Offset i {0}; i < m_text.size(); ++i) {
+                if (m_text[i] == '\n') {
+                    m_lineStarts.push_back(i + 1);
+                }
+            }
+        }
+
+        // Find the last line that starts at or before the offset
+        auto next {std::upper_bound(m_lineStarts.begin(), m_lineStarts.end(), offset)};
+        auto lineIndex {static_cast<std::uint64_t>(next - m_lineStarts.begin()) - 1};
+        return Location{lineIndex + 1, offset - m_lineStarts[lineIndex] + 1};
+    }
+
+    Origin SourceFile::origin(Offset offset) const {
+        if (m_lineMap && !m_lineMap->empty()) {
+            return m_lineMap->origin(offset);
+        }
+        return Origin{m_path, location(offset)};
+    }
+
+    std::uint32_t LineMap::addFile(std::filesystem::path path) {
+        m_files.push_back(std::move(path));
+        return static_cast<std::uint32_t>(m_files.size() - 1);
+    }
+
+    void LineMap::addLine(Offset start, std::uint32_t file, std::uint64_t line, std::uint64_t column) {
+        m_lines.push_back(Line{start, file, line, column});
+    }
+
+    Origin LineMap::origin(Offset offset) const {
+        // Find the last line that starts at or before the offset
+        auto next {std::upper_bound(m_lines.begin(), m_lines.end(), offset,
+                                    [](Offset value, const Line& line) { return value < line.start; })};
+        if (next == m_lines.begin()) {
+            return Origin{m_files.empty() ? std::filesystem::path{} : m_files.front(), Location{1, offset + 1}};
+        }
+        const Line& line {*(next - 1)};
+        return Origin{m_files[line.file], Location{line.line, line.column + (offset - line.start)}};
+    }
+
+    // Read a whole file into a SourceFile
+    SourceFile readFile(const std::filesystem::path& path) {
+        std::ifstream file {path, std::ios::binary};
+        if (!file) {
+            throw std::runtime_error("Could not open " + path.string());
+        }
+
+        std::stringstream contents;
+        contents << file.rdbuf();
+        return SourceFile{path, std::move(contents).str()};
+    }
+
+    // Unmaps the file when the last SourceFile viewing it is destroyed
+    struct Mapping {
+        void* address;
+        std::size_t size;
+
+        ~Mapping() { munmap(address, size); }
+    };
+
+    // Memory map a whole file into a SourceFile
+    SourceFile mapFile(const std::filesystem::path& path) {
+        int descriptor {open(path.c_str(), O_RDONLY)};
+        if (descriptor == -1) {
+            throw std::runtime_error("Could not open " + path.string());
+        }
+
+        // Empty files cannot be mapped, and pipes or devices have no fixed size, so both are read normally
+        struct stat status {};
+        if (fstat(descriptor, &status) == -1 || !S_ISREG(status.st_mode) || status.st_size == 0) {
+            close(descriptor);
+            return readFile(path);
+        }
+
+        auto size {static_cast<std::size_t>(status.st_size)};
+        void* address {mmap(nullptr, size, PROT_READ, MAP_PRIVATE, descriptor, 0)};
+        // The mapping stays valid after the descriptor is closed
+        close(descriptor);
+        if (address == MAP_FAILED) {
+            return readFile(path);
+        }
+        // The lexer reads the file front to back, so ask for aggressive readahead
+        madvise(address, size, MADV_SEQUENTIAL);
+
+        auto mapping {std::make_shared<const Mapping>(address, size)};
+        return SourceFile{path, std::move(mapping), std::string_view{static_cast<const char*>(address), size}};
+    }
+
+    // Formats as path:line:column: error: message
+    std::string formatError(const Origin& origin, std::string_view message) {
+        return origin.path.string() + ":" + std::to_string(origin.location.line) + ":"
+                + std::to_string(origin.location.column) + ": error: " + std::string{message};
+    }
+
+    std::string formatDiagnostic(const SourceFile& file, const Diagnostic& diagnostic) {
+        return formatError(file.origin(diagnostic.offset), diagnostic.message);
+    }
+}
@@ -0,0 +1,115 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_SOURCE_H
+#define DCC_SOURCE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Src {
+    // Byte offset into a source file. Tokens carry only this; lines and columns are worked out when needed
+    using Offset = std::uint64_t;
+
+    // One-based line and column, as printed in diagnostics
+    struct Location {
+        std::uint64_t line;
+        std::uint64_t column;
+    };
+
+    // A file name and position within it
+    struct Origin {
+        std::filesystem::path path;
+        Location location;
+    };
+
+    // Records where each line of generated text, such as preprocessor output, came from
+    // Lines must be added in order of their start offsets
+    class LineMap {
+        struct Line {
+            Offset start;
+            std::uint32_t file;
+            std::uint64_t line;
+            // Column of the first byte of the generated line in the original one
+            std::uint64_t column;
+        };
+        std::vector<std::filesystem::path> m_files;
+        std::vector<Line> m_lines;
+    public:
+        // Returns the index to pass to addLine for path
+        std::uint32_t addFile(std::filesystem::path path);
+
+        // Text from start up to the next added line came from line of file, starting at column
+        void addLine(Offset start, std::uint32_t file, std::uint64_t line, std::uint64_t column = 1);
+
+        bool empty() const { return m_lines.empty(); }
+
+        const std::filesystem::path& file(std::uint32_t index) const { return m_files[index]; }
+
+        // Offsets past the start of a line map to columns to the right of the line's starting column
+        Origin origin(Offset offset) const;
+    };
+
+    // Holds the full text of an input file, either read into memory or mapped straight from disk
+    // The table of line starts is only built the first time a location is asked for, so error-free compiles never
+    // pay for it
+    class SourceFile {
+        std::filesystem::path m_path;
+        // Owns whatever m_text points into. Shared, so copies of a SourceFile all view the same text
+        std::shared_ptr<const void> m_storage;
+        std::string_view m_text;
+        mutable std::vector<Offset> m_lineStarts;
+        // Set when the text was generated from other files, so errors can point at those instead
+        std::shared_ptr<const LineMap> m_lineMap;
+    public:
+        SourceFile() = default;
+        SourceFile(std::filesystem::path path, std::string text);
+
+        // Text owned by storage, such as a memory mapping that is undone when the last copy goes away
+        SourceFile(std::filesystem::path path, std::shared_ptr<const void> storage, std::string_view text)
+            : m_path{std::move(path)}
+            , m_storage{std::move(storage)}
+            , m_text{text}
+        {}
+
+        const std::filesystem::path& path() const { return m_path; }
+        std::string_view text() const { return m_text; }
+
+        Location location(Offset offset) const;
+
+        void setLineMap(std::shared_ptr<const LineMap> lineMap) { m_lineMap = std::move(lineMap); }
+
+        // The file and position that the text at offset came from, which is this file unless there is a line map
+        Origin origin(Offset offset) const;
+    };
+
+    // Read a whole file into a SourceFile
+    // Throws std::runtime_error if the file cannot be opened
+    SourceFile readFile(const std::filesystem::path& path);
+
+    // Memory map a whole file into a SourceFile, so large inputs are paged in by the OS instead of copied
+    // Falls back to readFile if the file cannot be mapped
+    // Throws std::runtime_error if the file cannot be opened
+    SourceFile mapFile(const std::filesystem::path& path);
+
+    // An error found in the source, recorded so that compilation can carry on and report everything at once
+    struct Diagnostic {
+        Offset offset;
+        std::string message;
+    };
+
+    using Diagnostics = std::vector<Diagnostic>;
+
+    // Formats as path:line:column: error: message
+    std::string formatError(const Origin& origin, std::string_view message);
+
+    // Formats as path:line:column: error: message, using the diagnostic's origin
+    std::string formatDiagnostic(const SourceFile& file, const Diagnostic& diagnostic);
+}
+
+#endif //DCC_SOURCE_H
@@ -0,0 +1,36 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include "token_buffer.h"
+
+namespace Token {
+    void TokenBuffer::reserve(Index count) {
+        m_kinds.reserve(count);
+        m_offsets.reserve(count);
+        m_lengths.reserve(count);
+        m_values.reserve(count);
+    }
+
+    void TokenBuffer::resize(Index count) {
+        m_kinds.resize(count);
+        m_offsets.resize(count);
+        m_lengths.resize(count);
+        m_values.resize(count);
+    }
+
+    void TokenBuffer::push(Kind kind, Src::Offset offset, std::uint32_t length, std::uint32_t value) {
+        m_kinds.push_back(kind);
+        m_offsets.push_back(offset);
+        m_lengths.push_back(length);
+        m_values.push_back(value);
+    }
+
+    void TokenBuffer::pushIdentifier(Sym::SymbolId symbol, Src::Offset offset, std::uint32_t length) {
+        push(IdentifierT, offset, length, symbol);
+    }
+
+    void TokenBuffer::pushConstant(int value, Src::Offset offset, std::uint32_t length) {
+        push(ConstantT, offset, length, std::bit_cast<std::uint32_t>(value));
+    }
+}
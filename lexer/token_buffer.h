@@ -0,0 +1,59 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_TOKEN_BUFFER_H
+#define DCC_TOKEN_BUFFER_H
+
+#include <cstdint>
+#include <vector>
+
+#include "tokens.h"
+#include "../helpers/symbol_table.h"
+
+namespace Token {
+    // Stores the lexer's output as parallel arrays, one entry per token
+    // This works out at 17 bytes a token. Identifiers hold a SymbolId, so their names live in the symbol table
+    class TokenBuffer {
+    public:
+        // Indices are 64 bit so inputs with more than 2^31 tokens can be held
+        using Index = std::uint64_t;
+    private:
+        std::vector<Kind> m_kinds;
+        std::vector<Src::Offset> m_offsets;
+        std::vector<std::uint32_t> m_lengths;
+        std::vector<std::uint32_t> m_values;
+    public:
+        Index size() const { return m_kinds.size(); }
+        bool empty() const { return m_kinds.empty(); }
+
+        void reserve(Index count);
+
+        // Grow or shrink to count tokens. New tokens are left zeroed, to be filled in with set
+        void resize(Index count);
+
+        void push(Kind kind, Src::Offset offset, std::uint32_t length, std::uint32_t value = 0);
+
+        void push(const Token& token) { push(token.kind, token.offset, token.length, token.value); }
+
+        void pushIdentifier(Sym::SymbolId symbol, Src::Offset offset, std::uint32_t length);
+
+        void pushConstant(int value, Src::Offset offset, std::uint32_t length);
+
+        // Overwrite the token at index, letting several threads fill in separate parts of a buffer at once
+        void set(Index index, const Token& token) {
+            m_kinds[index] = token.kind;
+            m_offsets[index] = token.offset;
+            m_lengths[index] = token.length;
+            m_values[index] = token.value;
+        }
+
+        Kind kind(Index index) const { return m_kinds[index]; }
+
+        Token operator[](Index index) const {
+            return Token{m_kinds[index], m_lengths[index], m_values[index], m_offsets[index]};
+        }
+    };
+}
+
+#endif //DCC_TOKEN_BUFFER_H
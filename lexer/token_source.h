@@ -0,0 +1,51 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_TOKEN_SOURCE_H
+#define DCC_TOKEN_SOURCE_H
+
+#include "token_buffer.h"
+
+namespace Token {
+    // Anything the parser can pull tokens from one at a time
+    // Lets the lexer run on demand, so the full token stream never has to exist in memory at once
+    class TokenSource {
+    public:
+        virtual ~TokenSource() = default;
+
+        // Writes the next token into token
+        // Returns false once the input is exhausted
+        virtual bool next(Token& token) = 0;
+    };
+
+    // Serves tokens out of a buffer that has already been filled, such as one built by lexing in parallel
+    class BufferSource final : public TokenSource {
+        const TokenBuffer& m_buffer;
+        TokenBuffer::Index m_next;
+        TokenBuffer::Index m_end;
+    public:
+        explicit BufferSource(const TokenBuffer& buffer)
+            : m_buffer{buffer}
+            , m_next{0}
+            , m_end{buffer.size()}
+        {}
+
+        // Serve only the tokens in [begin, end)
+        BufferSource(const TokenBuffer& buffer, TokenBuffer::Index begin, TokenBuffer::Index end)
+            : m_buffer{buffer}
+            , m_next{begin}
+            , m_end{end}
+        {}
+
+        bool next(Token& token) override {
+            if (m_next == m_end) {
+                return false;
+            }
+            token = m_buffer[m_next++];
+            return true;
+        }
+    };
+}
+
+#endif //DCC_TOKEN_SOURCE_H
@@ -0,0 +1,42 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include "dcc.h"
+
+namespace Dcc {
+    Result compile(std::string_view source, const Options& options) {
+        // The source goes through the driver as standard input would, with the output kept in memory
+        Driver::Options driverOptions;
+        driverOptions.stop = options.stop;
+        driverOptions.inMemory = true;
+        driverOptions.standardInput = source;
+        driverOptions.standardInputName = options.name;
+        driverOptions.timeReport = options.collectStats;
+        driverOptions.preprocessor.defines = options.defines;
+        // An empty search path looks a name up exactly as written, which is how headers are keyed
+        driverOptions.preprocessor.includePaths.emplace_back();
+
+        // A cache that cannot see the disk, holding only the headers given
+        Pp::IncludeCache includeCache {false};
+        for (const auto& [name, text] : options.headers) {
+            includeCache.addFile(name, text);
+        }
+
+        std::vector<Driver::UnitResult> units {Driver::compileFiles({Driver::FilePath{"-"}}, driverOptions, 1,
+                                                                   includeCache)};
+        Driver::UnitResult& unit {units.front()};
+
+        Result result;
+        result.succeeded = unit.exitCode == 0;
+        result.assembly = std::move(unit.assembly);
+        result.stats = std::move(unit.report);
+        std::string_view output {unit.output};
+        while (!output.empty()) {
+            std::size_t end {output.find('\n')};
+            result.diagnostics.emplace_back(output.substr(0, end));
+            output.remove_prefix(end == std::string_view::npos ? output.size() : end + 1);
+        }
+        return result;
+    }
+}
@@ -0,0 +1,53 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_DCC_H
+#define DCC_DCC_H
+
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "../driver/driver.h"
+
+// The compiler as a library, for test runners and benchmarks that want to compile without a dcc process or temporary
+// files
+// compile() works entirely in memory. It never reads or writes a file, runs gcc or looks at the environment, and any
+// number of compiles can run at once on different threads
+namespace Dcc {
+    using Stop = Driver::Stop;
+    using TimeReport = Driver::TimeReport;
+
+    struct Options {
+        // Stop::Lex and Stop::Parse check the source without producing assembly. Stop::Codegen runs the backend without
+        // emitting it. Stop::None and Stop::Emission both give the assembly
+        Stop stop {Stop::None};
+        // What diagnostics call the source
+        std::string name {"<source>"};
+        // NAME or NAME=VALUE, as given to -D
+        std::vector<std::string> defines;
+        // Files #include can find, keyed by the name used in the directive, with either quotes or angle brackets
+        std::unordered_map<std::string, std::string> headers;
+        // Fill in Result::stats. Off by default, as measuring costs a little
+        bool collectStats {false};
+    };
+
+    struct Result {
+        bool succeeded {false};
+        // Empty if the compile failed or stopped before emission
+        std::string assembly;
+        // Everything dcc would have printed for the source, one line per entry, such as
+        // name:line:column: error: message
+        std::vector<std::string> diagnostics;
+        // Time and allocations per phase, and counts of tokens, AST nodes and instructions
+        // Allocations are only counted in programs that link dcc_counting_new, see helpers/allocation_counter.h
+        std::optional<TimeReport> stats;
+    };
+
+    Result compile(std::string_view source, const Options& options = {});
+}
+
+#endif //DCC_DCC_H
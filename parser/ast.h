@@ -10,13 +10,18 @@
 #include <variant>
 #include <iostream>
 #include <array>
+#include <vector>
+
+#include "../helpers/arena.h"
+#include "../helpers/symbol_table.h"
+#include "../lexer/tokens.h"
 
 // Holds the structure for the classes that make up the abstract syntax tree
+// Every node is made in the arena its Program owns and links to its children with plain pointers. Nodes are trivially
+// destructible, so dropping the Program frees the whole tree at once without visiting it
 namespace Ast {
-	class Ast {
-	public:
-		virtual ~Ast() = default;
-	};
+	// No virtual destructor, as nodes are never destroyed one at a time
+	class Ast {};
 
 	/////////////////
 	/// Operators ///
@@ -24,26 +29,26 @@ namespace Ast {
 
 	// Represents and stores the data for unary operators
 	class UnaryOperator : public Ast {
-		const std::string& m_unop;
+		Token::Unop m_unop;
 	public:
 		UnaryOperator() = delete;
-		UnaryOperator(const std::string& unop)
+		UnaryOperator(Token::Unop unop)
 			: m_unop {unop}
 		{}
 
-		const std::string& unop() const { return m_unop; }
+		Token::Unop unop() const { return m_unop; }
 	};
 
 	// Represents and stores the data for Binary Operators
 	class BinaryOperator : public Ast {
-		const std::string& m_binop;
+		Token::Binop m_binop;
 	public:
 		BinaryOperator() = delete;
-		BinaryOperator(const std::string& binop)
+		BinaryOperator(Token::Binop binop)
 			: m_binop {binop}
 		{}
 
-		const std::string& binop() const { return m_binop; }
+		Token::Binop binop() const { return m_binop; }
 	};
 
 	//////////////////
@@ -63,15 +68,15 @@ namespace Ast {
 	/// Identifier ///
 	//////////////////
 
-	// The string used to identify a funciton or a variable
+	// The interned string used to identify a funciton or a variable
 	class Identifier : public Ast {
-		const std::string m_name;
+		const Sym::SymbolId m_name;
 	public:
-		explicit Identifier(const std::string& name)
+		explicit Identifier(Sym::SymbolId name)
 			: m_name{name}
 		{};
 
-		const std::string& name() const { return m_name; }
+		Sym::SymbolId name() const { return m_name; }
 	};
 
 
@@ -84,20 +89,21 @@ namespace Ast {
 
 	// variant to allow polymorphic expressions
 	using ExpressionPtr =	std::variant<
-							std::unique_ptr<ConstantExpression>,
-							std::unique_ptr<UnopExpression>,
-							std::unique_ptr<BinopExpression>
+							ConstantExpression*,
+							UnopExpression*,
+							BinopExpression*
 						>;
 
 	// An expression that holds a particular constant
+	// The constant is stored inline, so a constant is one node rather than two
 	class ConstantExpression : public Ast {
-		std::unique_ptr<IntConstant> m_constant;
+		IntConstant m_constant;
 	public:
-		explicit ConstantExpression(std::unique_ptr<IntConstant>&& constant)
-			: m_constant{std::move(constant)}
+		explicit ConstantExpression(IntConstant constant)
+			: m_constant{constant}
 		{}
 
-		IntConstant& constant() const { return *m_constant;}
+		const IntConstant& constant() const { return m_constant;}
 	};
 
 	class BinopExpression : public Ast {
@@ -106,10 +112,10 @@ namespace Ast {
 		ExpressionPtr m_rightExpression{};
 	public:
 		BinopExpression() = delete;
-		BinopExpression(ExpressionPtr&& leftExpression, BinaryOperator binop, ExpressionPtr&& rightExpression)
-				: m_leftExpression {std::move(leftExpression)}
-				, m_binop		   {std::move(binop)}
-				, m_rightExpression{std::move(rightExpression)}
+		BinopExpression(ExpressionPtr leftExpression, BinaryOperator binop, ExpressionPtr rightExpression)
+				: m_leftExpression {leftExpression}
+				, m_binop		   {binop}
+				, m_rightExpression{rightExpression}
 		{}
 
 		ExpressionPtr&  leftExpression() { return m_leftExpression; }
@@ -124,9 +130,9 @@ namespace Ast {
 		ExpressionPtr m_expression;
 	public:
 		UnopExpression() = delete;
-		UnopExpression(UnaryOperator unop, ExpressionPtr&& expression)
-			: m_unop{std::move(unop)}
-			, m_expression{std::move(expression)}
+		UnopExpression(UnaryOperator unop, ExpressionPtr expression)
+			: m_unop{unop}
+			, m_expression{expression}
 		{}
 
 		UnaryOperator&    unop() { return m_unop; }
@@ -143,18 +149,18 @@ namespace Ast {
 						KeywordStatement
 					>;
 	// Class for simple statements such as return 5
-	// The keyword used will be taken from those in the Tokens file
+	// The keyword is the kind of its token
 	class KeywordStatement : public Ast {
-		const std::string& m_keyword;
+		Token::Kind m_keyword;
 		ExpressionPtr m_expression{};
 	public:
 		KeywordStatement() = delete;
-		KeywordStatement(const std::string& keyword, ExpressionPtr&& expression)
+		KeywordStatement(Token::Kind keyword, ExpressionPtr expression)
 			: m_keyword{keyword}
-			, m_expression{std::move(expression)}
+			, m_expression{expression}
 		{}
 
-		const std::string& keyword() const { return m_keyword; }
+		Token::Kind keyword() const { return m_keyword; }
 		ExpressionPtr& expression() { return m_expression; }
 	};
 
@@ -164,13 +170,13 @@ namespace Ast {
 
 	// The identifier string and main statement of a function
 	class Function : public Ast {
-		std::unique_ptr<Identifier> m_identifier;
-		std::unique_ptr<Statement> m_statement;
+		Identifier* m_identifier;
+		Statement* m_statement;
 	public:
 		Function() = delete;
-		Function(std::unique_ptr<Identifier>&& identifier, std::unique_ptr<Statement>&& statement)
-		: m_identifier{std::move(identifier)}
-		, m_statement{std::move(statement)} {}
+		Function(Identifier* identifier, Statement* statement)
+		: m_identifier{identifier}
+		, m_statement{statement} {}
 
 		const Identifier& identifier() const { return *m_identifier; }
 		Statement& statement() const { return *m_statement; }
@@ -181,16 +187,37 @@ namespace Ast {
 	/// Programs ///
 	////////////////
 
-	// Holds an abstract syntax tree for a whole program
+	// Holds an abstract syntax tree for a whole program, and the arena every node of it lives in
+	// The functions in source order, made in one arena or, when parsed on separate threads, one for each run of them
 	class Program : public Ast {
-		std::unique_ptr<Function> m_function;
+		std::vector<Mem::Arena> m_arenas;
+		std::vector<Function*> m_functions;
 	public:
 		Program() = default;
-		explicit Program(std::unique_ptr<Function>&& function)
-			: m_function{std::move(function)}
+		Program(std::vector<Mem::Arena>&& arenas, std::vector<Function*>&& functions)
+			: m_arenas{std::move(arenas)}
+			, m_functions{std::move(functions)}
 		{}
 
-		Function& function() const { return *m_function; }
+		const std::vector<Function*>& functions() const { return m_functions; }
+
+		// Nodes in the tree, not counting the Program itself. Operators live inside their expressions and are not
+		// counted separately
+		std::uint64_t nodeCount() const {
+			std::uint64_t count {0};
+			for (const auto& arena : m_arenas) {
+				count += arena.objects();
+			}
+			return count;
+		}
+		// Heap taken by the tree
+		std::uint64_t arenaBytes() const {
+			std::uint64_t bytes {0};
+			for (const auto& arena : m_arenas) {
+				bytes += arena.reservedBytes();
+			}
+			return bytes;
+		}
 	};
 
 
@@ -239,11 +266,16 @@ namespace Ast {
 	>;
 
 	struct PrettyPrinter {
+		// Needed to turn identifiers back into their names
+		const Sym::SymbolTable& symbols;
+
 		void operator()(Program& program) const {
-			(*this)(program.function());
+			for (Function* function : program.functions()) {
+				(*this)(*function);
+			}
 		}
 		void operator()(Function& function) const {
-			std::cout << "Function: " << function.identifier().name() << "\n";
+			std::cout << "Function: " << symbols.name(function.identifier().name()) << "\n";
 			std::cout << "\t";
 			Statement& statement {function.statement()};
 			NodeType type {std::visit(GetStatementType{}, statement)};
@@ -0,0 +1,53 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include "flat_ast.h"
+#include "../helpers/overload.h"
+
+namespace FlatAst {
+    Expression flatten(const Ast::ExpressionPtr& expression) {
+        // Each expression is on the stack twice, once to queue its operands and once to add it after they are done
+        struct Pending {
+            Ast::ExpressionPtr expression;
+            bool operandsDone;
+        };
+        std::vector<Pending> pending {{expression, false}};
+        // Indices of finished nodes whose parent has not been added yet
+        std::vector<NodeIndex> operands;
+        Expression flat;
+
+        while (!pending.empty()) {
+            auto [current, operandsDone] {pending.back()};
+            pending.pop_back();
+            std::visit(Ol::overloaded{
+                [&](Ast::ConstantExpression* constant) {
+                    operands.push_back(flat.addConstant(constant->constant().value()));
+                },
+                [&](Ast::UnopExpression* unop) {
+                    if (!operandsDone) {
+                        pending.push_back({current, true});
+                        pending.push_back({unop->expression(), false});
+                        return;
+                    }
+                    NodeIndex operand {operands.back()};
+                    operands.back() = flat.addUnop(unop->unop().unop(), operand);
+                },
+                [&](Ast::BinopExpression* binop) {
+                    if (!operandsDone) {
+                        // Pushed right first, so the left operand is finished first
+                        pending.push_back({current, true});
+                        pending.push_back({binop->rightExpression(), false});
+                        pending.push_back({binop->leftExpression(), false});
+                        return;
+                    }
+                    NodeIndex right {operands.back()};
+                    operands.pop_back();
+                    NodeIndex left {operands.back()};
+                    operands.back() = flat.addBinop(binop->binop().binop(), left, right);
+                },
+            }, current);
+        }
+        return flat;
+    }
+}
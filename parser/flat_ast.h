@@ -0,0 +1,78 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_FLAT_AST_H
+#define DCC_FLAT_AST_H
+
+#include <cstdint>
+#include <vector>
+
+#include "ast.h"
+#include "../lexer/tokens.h"
+
+// An expression stored as one array of small nodes rather than a tree of pointers
+// Nodes are in post-order, so every node comes after its operands and the root is last. Anything that only needs
+// each operand done before the operator, such as evaluating or lowering to Tacky, is one pass from front to back with
+// no recursion and no pointer chasing
+namespace FlatAst {
+    // Position of a node in its Expression
+    using NodeIndex = std::uint32_t;
+
+    enum class NodeKind : std::uint8_t {
+        Constant,
+        Unop,
+        Binop,
+    };
+
+    struct Node {
+        NodeKind kind;
+        // A Token::Unop or Token::Binop, depending on kind. Zero for a constant
+        std::uint8_t op;
+        // The value of a constant, the operand of a unop or the left operand of a binop
+        std::uint32_t first;
+        // The right operand of a binop. Unused otherwise
+        NodeIndex second;
+
+        int constant() const { return static_cast<int>(first); }
+        // Only meaningful for a node of that kind
+        Token::Unop unop() const { return static_cast<Token::Unop>(op); }
+        Token::Binop binop() const { return static_cast<Token::Binop>(op); }
+    };
+    static_assert(sizeof(Node) == 12, "FlatAst::Node should stay small enough for five to a cache line");
+
+    class Expression {
+        std::vector<Node> m_nodes;
+    public:
+        // Each returns the index of the node added. Operands must already have been added
+        NodeIndex addConstant(int value) {
+            return add(Node{NodeKind::Constant, 0, static_cast<std::uint32_t>(value), 0});
+        }
+        NodeIndex addUnop(Token::Unop op, NodeIndex operand) {
+            return add(Node{NodeKind::Unop, static_cast<std::uint8_t>(op), operand, 0});
+        }
+        NodeIndex addBinop(Token::Binop op, NodeIndex left, NodeIndex right) {
+            return add(Node{NodeKind::Binop, static_cast<std::uint8_t>(op), left, right});
+        }
+
+        void reserve(std::size_t nodes) { m_nodes.reserve(nodes); }
+
+        const std::vector<Node>& nodes() const { return m_nodes; }
+        const Node& operator[](NodeIndex index) const { return m_nodes[index]; }
+        std::size_t size() const { return m_nodes.size(); }
+        bool empty() const { return m_nodes.empty(); }
+        // Only valid if not empty
+        NodeIndex root() const { return static_cast<NodeIndex>(m_nodes.size() - 1); }
+    private:
+        NodeIndex add(const Node& node) {
+            m_nodes.push_back(node);
+            return static_cast<NodeIndex>(m_nodes.size() - 1);
+        }
+    };
+
+    // Copies a pointer tree into post-order
+    // Walks with a stack on the heap, so the depth of the tree does not matter
+    Expression flatten(const Ast::ExpressionPtr& expression);
+}
+
+#endif //DCC_FLAT_AST_H
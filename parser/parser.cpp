@@ -3,28 +3,86 @@
 //
 
 #include "parser.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
 #include <type_traits>
+#include <vector>
+
+#include "../helpers/thread_pool.h"
 
 // Implements recursive descent parsing
+// Expressions are the exception, as they can nest far deeper than anything else. They are parsed with a stack on the
+// heap
 namespace Parser {
 
-	//class to iterate over the vector of tokens
+	//class to iterate over the tokens pulled from a token source
+	// Tokens are pulled on demand into a fixed ring buffer, so only a small window of the stream is ever held.
+	// Lookahead and backtracking are both limited to that window
 	class VectorAndIterator {
-	private:
-		std::vector<Token::Token>& m_vectorRef;
-		int m_index {0};
 	public:
-		explicit VectorAndIterator(std::vector<Token::Token>& vec) : m_vectorRef(vec) {};
+		using Index = Token::TokenBuffer::Index;
+		// Must be a power of two
+		static constexpr Index windowSize {16};
+	private:
+		Token::TokenSource& m_source;
+		std::array<Token::Token, windowSize> m_window {};
+		// Absolute position of the current token in the stream
+		Index m_index {0};
+		// Number of tokens pulled from the source so far
+		Index m_pulled {0};
+		bool m_exhausted {false};
+
+		// Pull tokens until position is in the window
+		// Returns false if the stream ends first
+		bool fill(Index position) {
+			if (position >= m_index + windowSize) {
+				throw std::out_of_range("VectorAndIterator lookahead beyond the token window");
+			}
+			while (m_pulled <= position && !m_exhausted) {
+				if (m_source.next(m_window[m_pulled & (windowSize - 1)])) {
+					++m_pulled;
+				} else {
+					m_exhausted = true;
+				}
+			}
+			return position < m_pulled;
+		}
 
-		int index() const { return m_index; }
-		void setIndex(int index) { m_index = index; }
+		// Whether position has been pulled and not yet overwritten
+		bool inWindow(Index position) const {
+			return position < m_pulled && position + windowSize >= m_pulled;
+		}
+	public:
+		explicit VectorAndIterator(Token::TokenSource& source) : m_source(source) {};
+		// For a source that starts partway into a stream, so indices still count from the start of the stream
+		VectorAndIterator(Token::TokenSource& source, Index start) : m_source(source), m_index(start), m_pulled(start) {};
+
+		Index index() const { return m_index; }
+		void setIndex(Index index) {
+			if (index != m_index && !inWindow(index)) {
+				throw std::out_of_range("VectorAndIterator::setIndex outside the token window");
+			}
+			m_index = index;
+		}
 
-		const std::vector<Token::Token>& vectorRef() const { return m_vectorRef; }
+		// True once every token has been taken
+		bool atEnd() { return !fill(m_index); }
 
-		int size() const { return static_cast<int>(std::ssize(m_vectorRef)); }
+		// Pulls and counts every token left in the source
+		Index drainRemaining() {
+			Index remaining {atEnd() ? 0 : m_pulled - m_index};
+			Token::Token discard;
+			while (m_source.next(discard)) {
+				++remaining;
+			}
+			m_exhausted = true;
+			return remaining;
+		}
 
 		VectorAndIterator& operator++() {
-			if (m_index < m_vectorRef.size()) {
+			if (fill(m_index)) {
 				++m_index;
 			} else {
 				throw std::out_of_range("VectorAndIterator::operator++ going out of range");
@@ -33,7 +91,7 @@ namespace Parser {
 		}
 
 		VectorAndIterator& operator--() {
-			if (m_index > 0) {
+			if (m_index > 0 && inWindow(m_index - 1)) {
 				--m_index;
 			} else {
 				throw std::out_of_range("VectorAndIterator::operator-- going out of range");
@@ -41,8 +99,8 @@ namespace Parser {
 			return *this;
 		}
 
-		VectorAndIterator& operator+=(int add) {
-			if (m_index + add < m_vectorRef.size()) {
+		VectorAndIterator& operator+=(Index add) {
+			if (fill(m_index + add)) {
 				m_index += add;
 			} else {
 				throw std::out_of_range("VectorAndIterator::operator+= going out of range");
@@ -50,35 +108,41 @@ namespace Parser {
 			return *this;
 		}
 
-		VectorAndIterator& operator-=(int sub) {
-			if (m_index - sub > 0) {
+		VectorAndIterator& operator-=(Index sub) {
+			if (sub <= m_index && inWindow(m_index - sub)) {
 				m_index -= sub;
 			} else {
 				throw std::out_of_range("VectorAndIterator::operator-= going out of range");
 			}
-			m_index -= sub;
 			return *this;
 		}
 
-		Token::Token& operator[](const int index) const {
-			return m_vectorRef[index];
+		// Token at an absolute position, which must be inside the window
+		Token::Token operator[](const Index index) {
+			if (!fill(index) || !inWindow(index)) {
+				throw std::out_of_range("VectorAndIterator::operator[] outside the token window");
+			}
+			return m_window[index & (windowSize - 1)];
 		}
 
-		const Token::Token& peekCurrent() const {
-			return m_vectorRef[m_index];
+		Token::Token peekCurrent() {
+			if (!fill(m_index)) {
+				throw std::out_of_range("Unexpected end of input");
+			}
+			return m_window[m_index & (windowSize - 1)];
 		}
 
-		Token::Token& takeCurrent() {
-			Token::Token& tmp{m_vectorRef[m_index]};
+		Token::Token takeCurrent() {
+			Token::Token tmp{peekCurrent()};
 			++m_index;
 			return tmp;
 		}
 	};
 
-	Token::Token& expect(auto& expected, VectorAndIterator& tokens) {
-		Token::Token& actual {tokens.takeCurrent()};
-		if (Visitor::getTokenName(actual) != expected) {
-			std::string error = "Parser::expect found unexpected token " + Visitor::getTokenName(actual) +
+	Token::Token expect(Token::Kind expected, VectorAndIterator& tokens) {
+		Token::Token actual {tokens.takeCurrent()};
+		if (actual.kind != expected) {
+			std::string error = "Parser::expect found unexpected token " + Token::kindString(actual.kind) +
 								" at index " + std::to_string(tokens.index());
 			throw std::invalid_argument(error);
 		}
@@ -86,156 +150,246 @@ namespace Parser {
 	}
 
 
-	std::unique_ptr<Ast::Identifier> parseIdentifier(VectorAndIterator& tokens) {
+	Ast::Identifier* parseIdentifier(VectorAndIterator& tokens, Mem::Arena& arena) {
 		// Check that the token is an identifier
-		auto& id {expect(Token::identifierString, tokens)};
-
-		// Get the identifier string
-		std::string& identifier {std::get<Token::Identifier>(id.type).name};
+		auto id {expect(Token::IdentifierT, tokens)};
 
-		//return a pointer to an identifier object
-		return std::make_unique<Ast::Identifier>(identifier);
+		//return a pointer to an identifier object holding the interned name
+		return arena.make<Ast::Identifier>(id.value);
 	}
 
 	Ast::BinaryOperator parseBinaryOperator(VectorAndIterator& tokens) {
-		auto& currentTokenName {Visitor::getTokenName(tokens.takeCurrent())};
-		return Ast::BinaryOperator{currentTokenName};
+		return Ast::BinaryOperator{Token::infixOperator(tokens.takeCurrent().kind).binop};
 	}
 
 	Ast::UnaryOperator parseUnaryOperator (VectorAndIterator& tokens) {
-		auto& currentTokenName {Visitor::getTokenName(tokens.takeCurrent())};
-		return Ast::UnaryOperator{currentTokenName};
+		return Ast::UnaryOperator{Token::prefixOperator(tokens.takeCurrent().kind).unop};
 	}
 
-	// Parse Integer values and return a pointer
-	std::unique_ptr<Ast::IntConstant> parseIntConstant (Token::Token& token) {
+	// Parse Integer values
+	Ast::IntConstant parseIntConstant (const Token::Token& token) {
 		// Get the value stored in the token
-		int tokenValue {std::get<Token::Constant>(token.type).value};
+		int tokenValue {token.constant()};
 
-		// Make it a unique pointer and return it
-		return std::make_unique<Ast::IntConstant>(tokenValue);
+		return Ast::IntConstant{tokenValue};
 	}
 
-	Ast::ExpressionPtr parseConstantExpression(VectorAndIterator& tokens) {
-		auto& currentToken{tokens.takeCurrent()};
-		return std::make_unique<Ast::ConstantExpression>(parseIntConstant(currentToken));
+	Ast::ExpressionPtr parseConstantExpression(VectorAndIterator& tokens, Mem::Arena& arena) {
+		auto currentToken{tokens.takeCurrent()};
+		return arena.make<Ast::ConstantExpression>(parseIntConstant(currentToken));
 	}
 
-	// Construct the unary operator constant
-	// This can be nested an arbitrary number of times
-	Ast::ExpressionPtr parseUnaryOperatorExpression(VectorAndIterator& tokens) {
-		auto unop {parseUnaryOperator(tokens)};
-		auto constant{parseFactor(tokens)};
-		return std::make_unique<Ast::UnopExpression>(unop, std::move(constant));
-	}
+	// What parseExpression still has to do with an operand once it is finished
+	// Each level of nesting is one of these on the heap, rather than a native stack frame, so how deeply an expression
+	// nests is limited by memory and not by the size of the thread's stack
+	struct PendingExpression {
+		enum class Kind : std::uint8_t {
+			// A run of binary operators. The operand is its first factor, or the right side of op
+			Binop,
+			// The operand was inside parentheses, so a ')' must follow it
+			Parenthesis,
+			// The operand is what op applies to
+			Unop,
+		};
+		Kind kind;
+		int minPrecedence {0};
+		// Everything to the left of op, once the first factor has arrived
+		Ast::ExpressionPtr left {};
+		// For a Binop, whether the first binary operator has been taken yet
+		bool hasOp {false};
+		Token::Unop unop {};
+		Token::Binop binop {};
+	};
 
-	// Helper to work out what type of expression token to create
-	Ast::ExpressionPtr parseFactor(VectorAndIterator& tokens) {
-		Ast::ExpressionPtr expressionNode;
-
-		auto& currentToken {tokens.peekCurrent()};
-		auto& currentTokenName {Visitor::getTokenName(currentToken)};
-
-		// Go over the current token and choose the appropriate constant to generate
-		if (currentTokenName == Token::openParenString) {
-			++tokens;
-			expressionNode = parseExpression(tokens, 0);
-			expect(Token::closeParenString, tokens);
-		} else if (currentTokenName == Token::constantString) {
-			expressionNode = parseConstantExpression(tokens);
-		} else if (Token::isUnop(currentTokenName)){
-			expressionNode = Ast::ExpressionPtr{parseUnaryOperatorExpression(tokens)};
-		} else {
-			throw std::invalid_argument(currentTokenName + "is not a recognised constant");
+	// Takes tokens up to and including the first constant of a factor, and returns that constant
+	// Each '(' and unary operator on the way is pushed onto pending, to be closed off once the constant is built up
+	Ast::ExpressionPtr parseFactor(VectorAndIterator& tokens, Mem::Arena& arena, std::vector<PendingExpression>& pending) {
+		while (true) {
+			Token::Kind currentKind {tokens.peekCurrent().kind};
+
+			// Go over the current token and choose the appropriate constant to generate
+			if (currentKind == Token::OpenParenT) {
+				++tokens;
+				pending.push_back({PendingExpression::Kind::Parenthesis});
+				pending.push_back({PendingExpression::Kind::Binop, 0});
+			} else if (currentKind == Token::ConstantT) {
+				return parseConstantExpression(tokens, arena);
+			} else if (Token::prefixOperator(currentKind).isOperator) {
+				pending.push_back({PendingExpression::Kind::Unop, 0, {}, false, parseUnaryOperator(tokens).unop()});
+			} else {
+				throw std::invalid_argument(Token::kindString(currentKind) + "is not a recognised constant");
+			}
 		}
-
-		// Return a unique pointer to a constant Object
-		return expressionNode;
 	}
 
-	// Parse to create left-associative binary operations
+	// Precedence climbing, with each finished operand handed back to the innermost pending expression
 	// If there is another operation, the previous complete node becomes the left node of a new BinopExpression
-	Ast::ExpressionPtr parseExpression(VectorAndIterator& tokens, int minPrecedence) {
-		auto getPrecedence = [](auto& tok) -> int {
-			using T = std::decay_t<decltype(tok)>;
-			if constexpr (Token::isBinopT<T>) {
-				return tok.precedence;
+	// Takes tokens and makes nodes in exactly the order the recursive form of the same grammar would
+	Ast::ExpressionPtr parseExpression(VectorAndIterator& tokens, Mem::Arena& arena, int minPrecedence) {
+		std::vector<PendingExpression> pending {{PendingExpression::Kind::Binop, minPrecedence}};
+		Ast::ExpressionPtr operand {parseFactor(tokens, arena, pending)};
+		while (true) {
+			PendingExpression& innermost {pending.back()};
+			switch (innermost.kind) {
+				case PendingExpression::Kind::Unop:
+					operand = arena.make<Ast::UnopExpression>(Ast::UnaryOperator{innermost.unop}, operand);
+					pending.pop_back();
+					break;
+				case PendingExpression::Kind::Parenthesis:
+					expect(Token::CloseParenT, tokens);
+					pending.pop_back();
+					break;
+				case PendingExpression::Kind::Binop: {
+					innermost.left = innermost.hasOp
+						? arena.make<Ast::BinopExpression>(innermost.left, Ast::BinaryOperator{innermost.binop}, operand)
+						: operand;
+					// The infix table gives NOPRECEDENCE for anything that is not a binary operator
+					const Token::InfixOperator& next {Token::infixOperator(tokens.peekCurrent().kind)};
+					if (next.precedence != Token::NOPRECEDENCE && next.precedence >= innermost.minPrecedence) {
+						innermost.hasOp = true;
+						innermost.binop = parseBinaryOperator(tokens).binop();
+						// A left-associative operator's right side only takes operators that bind tighter, while a
+						// right-associative one's also takes its own level
+						int rightPrecedence {next.associativity == Token::Associativity::Left ? next.precedence + 1 : next.precedence};
+						pending.push_back({PendingExpression::Kind::Binop, rightPrecedence});
+						operand = parseFactor(tokens, arena, pending);
+					} else {
+						operand = innermost.left;
+						pending.pop_back();
+						if (pending.empty()) {
+							return operand;
+						}
+					}
+					break;
+				}
 			}
-			else {
-				throw std::invalid_argument("getPrecedence should only be called on binary operators");
-			}
-		};
-
-		auto leftNode {parseFactor(tokens)};
-		auto* nextTokenPtr {&tokens.peekCurrent()};
-		int nextTokenPrecedence {getPrecedence(*nextTokenPtr)};
-		while (Token::isBinop(*nextTokenPtr) && nextTokenPrecedence >= minPrecedence) {
-			auto binop {parseBinaryOperator(tokens)};
-			auto rightNode {parseExpression(tokens, nextTokenPrecedence + 1)};
-			leftNode = std::make_unique<Ast::BinopExpression> (std::move(leftNode), binop, std::move(rightNode));
-			nextTokenPtr = &tokens.peekCurrent();
-			nextTokenPrecedence = getPrecedence(*nextTokenPtr);
-		}
-		return leftNode;
+		}
 	}
 
-	Ast::Statement parseKeywordStatement (const std::string& keyword, VectorAndIterator& tokens) {
+	Ast::Statement parseKeywordStatement (Token::Kind keyword, VectorAndIterator& tokens, Mem::Arena& arena) {
 		// Get the return value
-		auto value {parseExpression(tokens, 0)};
+		auto value {parseExpression(tokens, arena, 0)};
 
-		return Ast::KeywordStatement{keyword, std::move(value)};
+		return Ast::KeywordStatement{keyword, value};
 	}
 
 	// Statements are complete lines that come before semicolons in C
 	// Helper function to select the correct type of statement
-	std::unique_ptr<Ast::Statement> parseStatement(VectorAndIterator& tokens) {
-		std::unique_ptr<Ast::Statement> statementNode;
+	Ast::Statement* parseStatement(VectorAndIterator& tokens, Mem::Arena& arena) {
+		Ast::Statement* statementNode;
 		
-		Token::Token& currentToken {tokens.takeCurrent()};
-		auto& currentTokenName {Visitor::getTokenName(currentToken)};
+		Token::Token currentToken {tokens.takeCurrent()};
 		
 		// Determine the subfunciton to pass the current token to
-		if (Token::isKeyword(currentTokenName)) {
-			statementNode = std::make_unique<Ast::Statement>(parseKeywordStatement(currentTokenName, tokens));
+		if (Token::isKeyword(currentToken.kind)) {
+			statementNode = arena.make<Ast::Statement>(parseKeywordStatement(currentToken.kind, tokens, arena));
 		} else {
-			throw std::invalid_argument(currentTokenName + "is not a recognised keyword");
+			throw std::invalid_argument(Token::kindString(currentToken.kind) + "is not a recognised keyword");
 		}
 
 		// Check the statement ends with a semicolon token
-		expect(Token::semicolonString, tokens);
+		expect(Token::SemicolonT, tokens);
 
-		// return a unique pointer to a statement object
 		return statementNode;
 	}
 
-	std::unique_ptr<Ast::Function> parseFunction(VectorAndIterator& tokens) {
+	Ast::Function* parseFunction(VectorAndIterator& tokens, Mem::Arena& arena) {
 		// Check return value
-		expect(Token::intString, tokens);
+		expect(Token::IntT, tokens);
 
 		// Check Identifier
-		auto identifier {parseIdentifier(tokens)};
+		auto identifier {parseIdentifier(tokens, arena)};
 
-		expect(Token::openParenString, tokens);
-		expect(Token::voidString, tokens);
-		expect(Token::closeParenString, tokens);
-		expect(Token::openBraceString, tokens);
+		expect(Token::OpenParenT, tokens);
+		expect(Token::VoidT, tokens);
+		expect(Token::CloseParenT, tokens);
+		expect(Token::OpenBraceT, tokens);
 
-		// Get a unique pointer to the statement body
-		auto statementBody {parseStatement(tokens)};
+		auto statementBody {parseStatement(tokens, arena)};
 
-		expect(Token::closeBraceString, tokens);
+		expect(Token::CloseBraceT, tokens);
 
-		return std::make_unique<Ast::Function>(std::move(identifier), std::move(statementBody));
+		return arena.make<Ast::Function>(identifier, statementBody);
 	}
 
-	Ast::Program parseProgram(std::vector<Token::Token>& t) {
-		VectorAndIterator tokens {t};
-		Ast::Program tmp {parseFunction(tokens)};
-		if (tokens.index() != (tokens.size())) {
-			int remaining {tokens.size() - tokens.index()};
-			throw std::out_of_range("Tokens remaining in tokens vector. Quantity: " + std::to_string(remaining));
+	Ast::Program parseProgram(Token::TokenSource& source) {
+		VectorAndIterator tokens {source};
+		// If parsing throws, the arena and everything made in it so far is freed on the way out
+		std::vector<Mem::Arena> arenas(1);
+		std::vector<Ast::Function*> functions;
+		do {
+			functions.push_back(parseFunction(tokens, arenas.front()));
+		} while (!tokens.atEnd());
+		return Ast::Program{std::move(arenas), std::move(functions)};
+	}
+
+	std::vector<Token::TokenBuffer::Index> findFunctionStarts(const Token::TokenBuffer& t) {
+		std::vector<Token::TokenBuffer::Index> starts {0};
+		int depth {0};
+		for (Token::TokenBuffer::Index i {0}; i < t.size(); ++i) {
+			Token::Kind kind {t.kind(i)};
+			if (kind == Token::OpenBraceT) {
+				++depth;
+			} else if (kind == Token::CloseBraceT && --depth == 0 && i + 1 < t.size()) {
+				starts.push_back(i + 1);
+			}
+		}
+		return starts;
+	}
+
+	Ast::Program parseProgram(const Token::TokenBuffer& t, std::size_t threads) {
+		// A few batches per thread evens out functions that take longer than others, and small batches are not worth
+		// the hand off
+		constexpr std::size_t batchesPerThread {4};
+		constexpr Token::TokenBuffer::Index minimumBatchTokens {1 << 14};
+
+		std::vector<Token::TokenBuffer::Index> starts {findFunctionStarts(t)};
+		auto functionEnd = [&](std::size_t i) { return i + 1 < starts.size() ? starts[i + 1] : t.size(); };
+
+		// Each batch is a run of neighbouring functions, given as the index of its first
+		std::vector<std::size_t> batches;
+		Token::TokenBuffer::Index target {std::max(t.size() / std::max<std::size_t>(threads * batchesPerThread, 1),
+		                                           minimumBatchTokens)};
+		for (std::size_t i {0}; i < starts.size(); ++i) {
+			if (batches.empty() || starts[i] - starts[batches.back()] >= target) {
+				batches.push_back(i);
+			}
+		}
+
+		if (threads <= 1 || batches.size() <= 1) {
+			Token::BufferSource source {t};
+			return parseProgram(source);
+		}
+
+		// A batch's functions share an arena, so small functions do not each start a block of their own
+		std::vector<Mem::Arena> arenas(batches.size());
+		std::vector<Ast::Function*> functions(starts.size());
+		std::atomic<bool> failed {false};
+		Threads::ThreadPool pool {std::min(threads, batches.size())};
+		Threads::parallelFor(pool, batches.size(), [&](std::size_t batch) {
+			std::size_t last {batch + 1 < batches.size() ? batches[batch + 1] : starts.size()};
+			for (std::size_t i {batches[batch]}; i < last && !failed.load(std::memory_order_relaxed); ++i) {
+				try {
+					Token::BufferSource source {t, starts[i], functionEnd(i)};
+					VectorAndIterator tokens {source, starts[i]};
+					functions[i] = parseFunction(tokens, arenas[batch]);
+					if (!tokens.atEnd()) {
+						failed = true;
+					}
+				} catch (const std::exception&) {
+					failed = true;
+				}
+			}
+		});
+
+		// A function that does not fill its range exactly may be one the sequential parse reads across a boundary,
+		// such as one missing its closing brace. Parsing the whole buffer again in order gives exactly its error
+		if (failed) {
+			arenas.clear();
+			Token::BufferSource source {t};
+			return parseProgram(source);
 		}
-		return tmp;
+		return Ast::Program{std::move(arenas), std::move(functions)};
 	}
 
 }
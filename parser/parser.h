@@ -5,46 +5,54 @@
 #ifndef DCC_PARSER_H
 #define DCC_PARSER_H
 
-#include "../lexer/tokens.h"
+#include "../lexer/token_source.h"
 #include "ast.h"
 namespace Parser {
 
 	//class to iterate over the vector of tokens
 	class VectorAndIterator;
 
-	Token::Token& expect(auto& expected, VectorAndIterator& tokens);
+	Token::Token expect(Token::Kind expected, VectorAndIterator& tokens);
 
-	std::unique_ptr<Ast::Identifier> parseIdentifier(VectorAndIterator& tokens);
+	// Nodes are made in arena, which the finished Program takes over
+	Ast::Identifier* parseIdentifier(VectorAndIterator& tokens, Mem::Arena& arena);
 
 	Ast::BinaryOperator parseBinaryOperator(VectorAndIterator& tokens);
 
 	Ast::UnaryOperator parseUnaryOperator (VectorAndIterator& tokens);
 
-	// Parse Integer values and return a pointer
-	std::unique_ptr<Ast::IntConstant> parseIntConstant (Token::Token& token);
+	// Parse Integer values
+	Ast::IntConstant parseIntConstant (const Token::Token& token);
 
-	Ast::ExpressionPtr parseConstantExpression(VectorAndIterator& tokens);
+	Ast::ExpressionPtr parseConstantExpression(VectorAndIterator& tokens, Mem::Arena& arena);
 
-	// Construct the unary operator constant
-	// This can be nested an arbitrary number of times
-	Ast::ExpressionPtr parseUnaryOperatorExpression(VectorAndIterator& tokens);
-
-	// Helper to work out what type of expression token to create
-	Ast::ExpressionPtr parseFactor(VectorAndIterator& tokens);
-
-	// Parse to create left-associative binary operations
+	// Parse to create binary operations, grouped by the associativity in the infix table, with any nesting of parentheses and unary operators
 	// If there is another operation, the previous complete node becomes the left node of a new BinopExpression
-	Ast::ExpressionPtr parseExpression(VectorAndIterator& tokens, int minPrecedence);
+	// Does not recurse, so nesting a million levels deep needs no more native stack than nesting one
+	Ast::ExpressionPtr parseExpression(VectorAndIterator& tokens, Mem::Arena& arena, int minPrecedence);
 
-	Ast::Statement parseKeywordStatement (const std::string& keyword, VectorAndIterator& tokens);
+	Ast::Statement parseKeywordStatement (Token::Kind keyword, VectorAndIterator& tokens, Mem::Arena& arena);
 
 	// Statements are complete lines that come before semicolons in C
 	// Helper function to select the correct type of statement
-	std::unique_ptr<Ast::Statement> parseStatement(VectorAndIterator& tokens);
+	Ast::Statement* parseStatement(VectorAndIterator& tokens, Mem::Arena& arena);
+
+	Ast::Function* parseFunction(VectorAndIterator& tokens, Mem::Arena& arena);
+
+	// Parse tokens as they are pulled from source, so the whole stream never has to be held at once
+	// A program is one or more function definitions
+	Ast::Program parseProgram(Token::TokenSource& source);
 
-	std::unique_ptr<Ast::Function> parseFunction(VectorAndIterator& tokens);
+	// Where each top-level function should start, found by matching braces
+	// Anything left after the last top-level '}' is taken as one more function, to fail when it is parsed
+	std::vector<Token::TokenBuffer::Index> findFunctionStarts(const Token::TokenBuffer& t);
 
-	Ast::Program parseProgram(std::vector<Token::Token>& t);
+	// Parse a buffer that has already been lexed, splitting it at top-level braces and parsing runs of functions on
+	// threads worker threads, each run into an arena of its own
+	// The functions are put together in source order, and any input that does not split cleanly is parsed again on the
+	// calling thread, so the program and any error come out exactly as a single threaded parse would give them
+	// Small inputs, or threads of 1, are parsed on the calling thread
+	Ast::Program parseProgram(const Token::TokenBuffer& t, std::size_t threads = 1);
 }
 
 #endif //DCC_PARSER_H
@@ -0,0 +1,135 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <stdexcept>
+
+#include "include_cache.h"
+
+namespace Pp {
+    std::shared_ptr<CachedFile> readFile(const std::filesystem::path& path, std::filesystem::file_time_type modified,
+                                         std::uintmax_t size) {
+        auto file {std::make_shared<CachedFile>()};
+        file->path = path;
+        file->source = Src::mapFile(path);
+        file->tokens = tokenize(file->source.text(), file->spliced, file->errors);
+        file->guard = findIncludeGuard(file->tokens);
+        file->modified = modified;
+        file->size = size;
+        return file;
+    }
+
+    std::shared_ptr<const CachedFile> IncludeCache::load(const std::filesystem::path& path) {
+        std::string key {path.lexically_normal().string()};
+        std::error_code error;
+        std::filesystem::file_time_type modified {};
+        std::uintmax_t size {0};
+        if (m_readsFiles) {
+            modified = std::filesystem::last_write_time(path, error);
+            size = std::filesystem::file_size(path, error);
+        }
+
+        {
+            std::lock_guard lock {m_mutex};
+            auto found {m_files.find(key)};
+            if (found != m_files.end() && (found->second->inMemory
+                || (!error && found->second->modified == modified && found->second->size == size))) {
+                ++m_hits;
+                return found->second;
+            }
+            if (!m_readsFiles) {
+                throw std::runtime_error(path.string() + ": No such file or directory");
+            }
+            ++m_misses;
+        }
+
+        // Loading happens outside the lock, so threads including different files do not wait on each other
+        // Two threads loading the same file at once both do the work, and the second one's copy is kept
+        auto file {readFile(path, modified, size)};
+
+        std::lock_guard lock {m_mutex};
+        m_files[key] = file;
+        return file;
+    }
+
+    std::shared_ptr<const CachedFile> IncludeCache::loadMain(const std::filesystem::path& path) {
+        {
+            std::lock_guard lock {m_mutex};
+            auto found {m_files.find(path.lexically_normal().string())};
+            if (found != m_files.end() && found->second->inMemory) {
+                return found->second;
+            }
+            if (!m_readsFiles) {
+                throw std::runtime_error(path.string() + ": No such file or directory");
+            }
+        }
+        return readFile(path, {}, 0);
+    }
+
+    void IncludeCache::addFile(const std::filesystem::path& path, std::string text) {
+        auto file {std::make_shared<CachedFile>()};
+        file->path = path;
+        file->source = Src::SourceFile{path, std::move(text)};
+        file->tokens = tokenize(file->source.text(), file->spliced, file->errors);
+        file->guard = findIncludeGuard(file->tokens);
+        file->size = file->source.text().size();
+        file->inMemory = true;
+
+        std::lock_guard lock {m_mutex};
+        m_files[path.lexically_normal().string()] = std::move(file);
+    }
+
+    bool IncludeCache::exists(const std::filesystem::path& path) const {
+        {
+            std::lock_guard lock {m_mutex};
+            auto found {m_files.find(path.lexically_normal().string())};
+            if (found != m_files.end() && found->second->inMemory) {
+                return true;
+            }
+        }
+        std::error_code error;
+        return m_readsFiles && std::filesystem::is_regular_file(path, error);
+    }
+
+    CacheStats IncludeCache::stats() const {
+        std::lock_guard lock {m_mutex};
+        return CacheStats{m_hits, m_misses, m_files.size()};
+    }
+
+    std::optional<std::string> findIncludeGuard(const PpTokens& tokens) {
+        // Looks for # ifndef NAME, # define NAME at the very start
+        if (tokens.size() < 7 || !tokens[0].is("#") || !tokens[0].lineStart || tokens[1].text != "ifndef"
+            || tokens[2].kind != Kind::Identifier || !tokens[3].is("#") || !tokens[3].lineStart
+            || tokens[4].text != "define" || tokens[5].text != tokens[2].text) {
+            return std::nullopt;
+        }
+
+        // and a # endif at the very end that closes the #ifndef, with nothing after it
+        std::size_t last {tokens.size() - 1};
+        while (last > 0 && !tokens[last].lineStart) {
+            --last;
+        }
+        if (!tokens[last].is("#") || last + 1 >= tokens.size() || tokens[last + 1].text != "endif") {
+            return std::nullopt;
+        }
+        int depth {0};
+        for (std::size_t i {0}; i < last; ++i) {
+            if (!tokens[i].lineStart || !tokens[i].is("#") || i + 1 >= tokens.size()) {
+                continue;
+            }
+            std::string_view directive {tokens[i + 1].text};
+            if (directive == "if" || directive == "ifdef" || directive == "ifndef") {
+                ++depth;
+            } else if (directive == "endif") {
+                --depth;
+                // The #ifndef closed early, so the guard does not cover everything
+                if (depth == 0) {
+                    return std::nullopt;
+                }
+            } else if ((directive == "else" || directive == "elif") && depth == 1) {
+                return std::nullopt;
+            }
+        }
+        return std::string{tokens[2].text};
+    }
+}
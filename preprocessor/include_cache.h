@@ -0,0 +1,81 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_INCLUDE_CACHE_H
+#define DCC_INCLUDE_CACHE_H
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pp_token.h"
+#include "../lexer/source.h"
+
+namespace Pp {
+    // A file that has been read and tokenized once, ready to be included any number of times
+    struct CachedFile {
+        std::filesystem::path path;
+        Src::SourceFile source;
+        // Holds the text with backslash-newlines removed, if there were any, for the tokens to point into
+        std::string spliced;
+        PpTokens tokens;
+        std::vector<TokenizeError> errors;
+        // Set if the whole file is wrapped in #ifndef GUARD / #define GUARD ... #endif, in which case including it
+        // again while GUARD is defined can be skipped without looking at it
+        std::optional<std::string> guard;
+        // Used to notice the file changing on disk between compiles
+        std::filesystem::file_time_type modified;
+        std::uintmax_t size;
+        // Given to IncludeCache::addFile rather than read from disk, so never goes out of date
+        bool inMemory {false};
+    };
+
+    struct CacheStats {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::uint64_t files;
+    };
+
+    // Keeps every file the preprocessor has loaded, so headers included by many files, or many times, are only
+    // read and tokenized once. Safe to share between threads and between compiles
+    // A file that has changed size or modification time since it was cached is loaded again
+    class IncludeCache {
+        std::unordered_map<std::string, std::shared_ptr<const CachedFile>> m_files;
+        mutable std::mutex m_mutex;
+        std::uint64_t m_hits {0};
+        std::uint64_t m_misses {0};
+        bool m_readsFiles {true};
+    public:
+        IncludeCache() = default;
+        // With readsFiles false nothing is ever read from disk, and only files given to addFile can be included
+        explicit IncludeCache(bool readsFiles)
+            : m_readsFiles{readsFiles}
+        {}
+
+        // Throws std::runtime_error if the file cannot be read
+        std::shared_ptr<const CachedFile> load(const std::filesystem::path& path);
+
+        // Like load, for the file being compiled rather than one being included. A file read from disk is not kept,
+        // since a server would otherwise hold on to every file it has ever compiled
+        std::shared_ptr<const CachedFile> loadMain(const std::filesystem::path& path);
+
+        // Makes text includable as path, in place of anything on disk there
+        void addFile(const std::filesystem::path& path, std::string text);
+
+        // True if load would find a file at path
+        bool exists(const std::filesystem::path& path) const;
+
+        CacheStats stats() const;
+    };
+
+    // Finds the include guard wrapping a whole file, if it has one
+    std::optional<std::string> findIncludeGuard(const PpTokens& tokens);
+}
+
+#endif //DCC_INCLUDE_CACHE_H
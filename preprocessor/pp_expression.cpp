@@ -0,0 +1,391 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "pp_expression.h"
+
+namespace Pp {
+    // A value in a #if expression, with its signedness
+    struct Value {
+        std::uint64_t bits {0};
+        bool isUnsigned {false};
+
+        std::int64_t asSigned() const { return static_cast<std::int64_t>(bits); }
+        bool isTrue() const { return bits != 0; }
+    };
+
+    Value signedValue(std::int64_t value) { return Value{static_cast<std::uint64_t>(value), false}; }
+    Value boolValue(bool value) { return Value{value ? 1u : 0u, false}; }
+
+    long long characterValue(std::string_view literal) {
+        // Skip any encoding prefix, then the quotes
+        std::size_t quote {literal.find('\'')};
+        if (quote == std::string_view::npos || literal.size() < quote + 3 || literal.back() != '\'') {
+            throw std::invalid_argument("empty character constant");
+        }
+        std::string_view body {literal.substr(quote + 1, literal.size() - quote - 2)};
+        if (body.front() != '\\') {
+            return static_cast<unsigned char>(body.front());
+        }
+        if (body.size() < 2) {
+            throw std::invalid_argument("invalid character constant " + std::string{literal});
+        }
+        switch (body[1]) {
+            case 'n': return '\n';
+            case 't': return '\t';
+            case 'r': return '\r';
+            case 'a': return '\a';
+            case 'b': return '\b';
+            case 'f': return '\f';
+            case 'v': return '\v';
+            case 'e': return 27;
+            case '\\': return '\\';
+            case '\'': return '\'';
+            case '"': return '"';
+            case '?': return '?';
+            case 'x': {
+                long long value {0};
+                std::from_chars(body.data() + 2, body.data() + body.size(), value, 16);
+                return value;
+            }
+            default:
+                if (body[1] >= '0' && body[1] <= '7') {
+                    long long value {0};
+                    std::from_chars(body.data() + 1, body.data() + std::min<std::size_t>(body.size(), 4), value, 8);
+                    return value;
+                }
+                throw std::invalid_argument("unknown escape sequence in " + std::string{literal});
+        }
+    }
+
+    // Reads an integer constant, with any base prefix and u/l suffixes
+    Value numberValue(std::string_view text) {
+        int base {10};
+        std::string_view digits {text};
+        if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+            base = 16;
+            digits.remove_prefix(2);
+        } else if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'b' || digits[1] == 'B')) {
+            base = 2;
+            digits.remove_prefix(2);
+        } else if (digits.size() > 1 && digits[0] == '0') {
+            base = 8;
+        }
+
+        std::uint64_t bits {0};
+        auto [ptr, ec] {std::from_chars(digits.data(), digits.data() + digits.size(), bits, base)};
+        if (ec != std::errc{}) {
+            throw std::invalid_argument("invalid integer constant " + std::string{text} + " in preprocessor expression");
+        }
+        std::string_view suffix {ptr, static_cast<std::size_t>(digits.data() + digits.size() - ptr)};
+        bool isUnsigned {false};
+        for (char c : suffix) {
+            if (c == 'u' || c == 'U') {
+                isUnsigned = true;
+            } else if (c != 'l' && c != 'L') {
+                throw std::invalid_argument("invalid suffix \"" + std::string{suffix} + "\" on integer constant");
+            }
+        }
+        // Constants too big for intmax_t are unsigned
+        return Value{bits, isUnsigned || bits > static_cast<std::uint64_t>(INT64_MAX)};
+    }
+
+    // What the evaluator still has to do with an operand once it has a value
+    // Each level of nesting is one of these on the heap rather than a native stack frame, so a deeply nested #if runs
+    // out of memory long before it could overflow the thread's stack
+    struct PendingValue {
+        enum class Kind : std::uint8_t {
+            // A run of binary operators. The operand is its first term, or the right side of op
+            Binary,
+            // The operand was inside parentheses, so a ')' must follow it
+            Parenthesis,
+            // The operand is what op applies to
+            Unary,
+            // The operand is the condition of a possible ?:
+            Condition,
+            // The operand is the side of ?: taken when the condition is true, or the side taken when it is false
+            IfTrue,
+            IfFalse,
+        };
+        Kind kind;
+        int minimumPrecedence {0};
+        // Everything to the left of op, once the first term has arrived
+        Value left {};
+        // Empty until the first binary operator, for a Binary
+        std::string_view op {};
+        Value condition {};
+        Value ifTrue {};
+        // m_evaluating from before the operand was started, to go back to once it is finished
+        bool outerEvaluating {true};
+    };
+
+    // Precedence climbing over the usual C precedence levels, with a stack on the heap
+    class Evaluator {
+        const PpTokens& m_tokens;
+        std::size_t m_position {0};
+        // False inside the side of &&, || or ?: that does not count, where dividing by zero is not an error
+        bool m_evaluating {true};
+        std::vector<PendingValue> m_pending;
+
+        bool atPunctuator(std::string_view punctuator) const {
+            return m_position < m_tokens.size() && m_tokens[m_position].is(punctuator);
+        }
+
+        // Takes punctuator, or reports message as gcc does when it is missing
+        void expect(std::string_view punctuator, const char* message) {
+            if (!atPunctuator(punctuator)) {
+                throw std::invalid_argument(message);
+            }
+            ++m_position;
+        }
+
+        // Starts a full expression, which may be a ?: and whose first term comes next
+        void pushConditional() {
+            m_pending.push_back({PendingValue::Kind::Condition});
+            m_pending.push_back({PendingValue::Kind::Binary, 1});
+        }
+
+        // Why the term after previous, the operator or '(' just taken, is missing, in gcc's words
+        // previous is empty at the start of the expression
+        static std::string missingOperand(std::string_view previous, const PpToken* next) {
+            if (previous == "(") {
+                if (!next) {
+                    return "missing ')' in expression";
+                }
+                if (next->is(")")) {
+                    return "missing expression between '(' and ')'";
+                }
+            }
+            if (previous.empty() || previous == "(") {
+                if (!next) {
+                    return "#if with no expression";
+                }
+                if (next->is(")")) {
+                    return "missing '(' in expression";
+                }
+                return "operator '" + std::string{next->text} + "' has no left operand";
+            }
+            return "operator '" + std::string{previous} + "' has no right operand";
+        }
+
+        // Takes tokens up to and including the first constant of a term, and returns its value
+        // Each '(' and unary operator on the way is pushed, to be applied once the value is known
+        Value term(std::string_view previous) {
+            while (true) {
+                if (m_position >= m_tokens.size()) {
+                    throw std::invalid_argument(missingOperand(previous, nullptr));
+                }
+                const PpToken& token {m_tokens[m_position++]};
+                switch (token.kind) {
+                    case Kind::Number:
+                        return numberValue(token.text);
+                    case Kind::CharLiteral:
+                        return signedValue(characterValue(token.text));
+                    case Kind::Identifier:
+                        // Anything still an identifier after expansion counts as 0, except true in C23
+                        return boolValue(token.text == "true");
+                    case Kind::Punctuator:
+                        if (token.text == "+" || token.text == "-" || token.text == "~" || token.text == "!") {
+                            m_pending.push_back({PendingValue::Kind::Unary, 0, {}, token.text});
+                            previous = token.text;
+                            continue;
+                        }
+                        if (token.text == "(") {
+                            m_pending.push_back({PendingValue::Kind::Parenthesis});
+                            pushConditional();
+                            previous = token.text;
+                            continue;
+                        }
+                        // Something that can only follow an operand, where an operand should be
+                        if (token.is(")") || token.is("?") || token.is(":") || precedence(token.text) != 0) {
+                            throw std::invalid_argument(missingOperand(previous, &token));
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                throw std::invalid_argument("token \"" + std::string{token.text} + "\" is not valid in preprocessor expressions");
+            }
+        }
+
+        static Value applyUnary(std::string_view op, Value value) {
+            if (op == "-") return Value{0 - value.bits, value.isUnsigned};
+            if (op == "~") return Value{~value.bits, value.isUnsigned};
+            if (op == "!") return boolValue(!value.isTrue());
+            return value;
+        }
+
+        // Binding power of each binary operator, higher binds tighter. 0 means not a binary operator
+        static int precedence(std::string_view op) {
+            constexpr std::array<std::pair<std::string_view, int>, 18> table {{
+                {"*", 10}, {"/", 10}, {"%", 10},
+                {"+", 9}, {"-", 9},
+                {"<<", 8}, {">>", 8},
+                {"<", 7}, {">", 7}, {"<=", 7}, {">=", 7},
+                {"==", 6}, {"!=", 6},
+                {"&", 5}, {"^", 4}, {"|", 3},
+                {"&&", 2}, {"||", 1},
+            }};
+            for (const auto& [text, level] : table) {
+                if (text == op) {
+                    return level;
+                }
+            }
+            return 0;
+        }
+
+        Value apply(std::string_view op, Value left, Value right) const {
+            bool isUnsigned {left.isUnsigned || right.isUnsigned};
+            std::uint64_t a {left.bits};
+            std::uint64_t b {right.bits};
+            std::int64_t sa {left.asSigned()};
+            std::int64_t sb {right.asSigned()};
+
+            if (op == "/" || op == "%") {
+                if (b == 0) {
+                    if (!m_evaluating) {
+                        return Value{0, isUnsigned};
+                    }
+                    throw std::invalid_argument("division by zero in preprocessor expression");
+                }
+                if (isUnsigned) {
+                    return Value{op == "/" ? a / b : a % b, true};
+                }
+                // INT64_MIN / -1 overflows, so give the wrapped answer rather than trapping
+                if (sa == INT64_MIN && sb == -1) {
+                    return op == "/" ? signedValue(INT64_MIN) : signedValue(0);
+                }
+                return signedValue(op == "/" ? sa / sb : sa % sb);
+            }
+            if (op == "*") return Value{a * b, isUnsigned};
+            if (op == "+") return Value{a + b, isUnsigned};
+            if (op == "-") return Value{a - b, isUnsigned};
+            // Shifts take the type of the left operand
+            if (op == "<<") return Value{b >= 64 ? 0 : a << b, left.isUnsigned};
+            if (op == ">>") {
+                if (left.isUnsigned) {
+                    return Value{b >= 64 ? 0 : a >> b, true};
+                }
+                return signedValue(b >= 64 ? (sa < 0 ? -1 : 0) : sa >> b);
+            }
+            if (op == "<") return boolValue(isUnsigned ? a < b : sa < sb);
+            if (op == ">") return boolValue(isUnsigned ? a > b : sa > sb);
+            if (op == "<=") return boolValue(isUnsigned ? a <= b : sa <= sb);
+            if (op == ">=") return boolValue(isUnsigned ? a >= b : sa >= sb);
+            if (op == "==") return boolValue(a == b);
+            if (op == "!=") return boolValue(a != b);
+            if (op == "&") return Value{a & b, isUnsigned};
+            if (op == "^") return Value{a ^ b, isUnsigned};
+            if (op == "|") return Value{a | b, isUnsigned};
+            if (op == "&&") return boolValue(left.isTrue() && right.isTrue());
+            return boolValue(left.isTrue() || right.isTrue());
+        }
+
+        // Starts the operand of pending, which counts only if counts is true
+        void startOperand(PendingValue& pending, bool counts) {
+            pending.outerEvaluating = m_evaluating;
+            m_evaluating = m_evaluating && counts;
+        }
+
+        Value conditional() {
+            pushConditional();
+            Value operand {term({})};
+            while (true) {
+                // Copied, as pushing more pending values can move it
+                PendingValue innermost {m_pending.back()};
+                m_pending.pop_back();
+                switch (innermost.kind) {
+                    case PendingValue::Kind::Unary:
+                        operand = applyUnary(innermost.op, operand);
+                        break;
+                    case PendingValue::Kind::Parenthesis:
+                        expect(")", "missing ')' in expression");
+                        break;
+                    case PendingValue::Kind::Binary: {
+                        if (innermost.op.empty()) {
+                            innermost.left = operand;
+                        } else {
+                            m_evaluating = innermost.outerEvaluating;
+                            innermost.left = apply(innermost.op, innermost.left, operand);
+                        }
+                        if (m_position < m_tokens.size() && m_tokens[m_position].kind == Kind::Punctuator) {
+                            std::string_view op {m_tokens[m_position].text};
+                            int level {precedence(op)};
+                            if (level != 0 && level >= innermost.minimumPrecedence) {
+                                ++m_position;
+                                innermost.op = op;
+                                // The right of && and || does not count once the left has settled the answer
+                                bool counts {!(op == "&&" && !innermost.left.isTrue())
+                                             && !(op == "||" && innermost.left.isTrue())};
+                                startOperand(innermost, counts);
+                                m_pending.push_back(innermost);
+                                // The right side only takes operators that bind tighter, so the run stays left-associative
+                                m_pending.push_back({PendingValue::Kind::Binary, level + 1});
+                                operand = term(op);
+                                break;
+                            }
+                        }
+                        operand = innermost.left;
+                        break;
+                    }
+                    case PendingValue::Kind::Condition:
+                        if (!atPunctuator("?")) {
+                            break;
+                        }
+                        ++m_position;
+                        innermost.kind = PendingValue::Kind::IfTrue;
+                        innermost.condition = operand;
+                        startOperand(innermost, operand.isTrue());
+                        m_pending.push_back(innermost);
+                        pushConditional();
+                        operand = term("?");
+                        break;
+                    case PendingValue::Kind::IfTrue:
+                        m_evaluating = innermost.outerEvaluating;
+                        expect(":", "'?' without following ':'");
+                        innermost.kind = PendingValue::Kind::IfFalse;
+                        innermost.ifTrue = operand;
+                        startOperand(innermost, !innermost.condition.isTrue());
+                        m_pending.push_back(innermost);
+                        pushConditional();
+                        operand = term(":");
+                        break;
+                    case PendingValue::Kind::IfFalse: {
+                        m_evaluating = innermost.outerEvaluating;
+                        bool isUnsigned {innermost.ifTrue.isUnsigned || operand.isUnsigned};
+                        operand = innermost.condition.isTrue() ? innermost.ifTrue : operand;
+                        operand.isUnsigned = isUnsigned;
+                        break;
+                    }
+                }
+                if (m_pending.empty()) {
+                    return operand;
+                }
+            }
+        }
+    public:
+        explicit Evaluator(const PpTokens& tokens)
+            : m_tokens{tokens}
+        {}
+
+        bool evaluate() {
+            Value value {conditional()};
+            if (m_position != m_tokens.size()) {
+                throw std::invalid_argument("missing binary operator before token \""
+                                            + std::string{m_tokens[m_position].text} + "\"");
+            }
+            return value.isTrue();
+        }
+    };
+
+    bool evaluateCondition(const PpTokens& tokens) {
+        return Evaluator{tokens}.evaluate();
+    }
+}
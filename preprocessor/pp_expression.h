@@ -0,0 +1,22 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_PP_EXPRESSION_H
+#define DCC_PP_EXPRESSION_H
+
+#include "pp_token.h"
+
+namespace Pp {
+    // Evaluates the controlling expression of a #if or #elif, after macros have been expanded, defined has been
+    // replaced and any identifiers left over have become 0
+    // Arithmetic is done in intmax_t, or uintmax_t when either side is unsigned, as the standard asks
+    // Throws std::invalid_argument if the expression is malformed or divides by zero
+    bool evaluateCondition(const PpTokens& tokens);
+
+    // Value of a character literal such as 'a' or '\n'
+    // Throws std::invalid_argument for an empty literal or an unknown escape
+    long long characterValue(std::string_view literal);
+}
+
+#endif //DCC_PP_EXPRESSION_H
@@ -0,0 +1,234 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <array>
+
+#include "pp_token.h"
+
+namespace Pp {
+    // Longest first within each starting character, so the first match is the longest one
+    constexpr std::array<std::string_view, 23> multiCharPunctuators {
+        "...", "<<=", ">>=",
+        "->", "++", "--", "<<", ">>", "<=", ">=", "==", "!=", "&&", "||",
+        "*=", "/=", "%=", "+=", "-=", "&=", "^=", "|=", "##"
+    };
+
+    constexpr std::string_view singleCharPunctuators {"[](){}.&*+-~!/%<>^|?:;=,#"};
+
+    constexpr bool isIdentifierStart(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '$';
+    }
+
+    constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+    constexpr bool isIdentifierChar(char c) { return isIdentifierStart(c) || isDigit(c); }
+
+    constexpr bool isHorizontalSpace(char c) {
+        return c == ' ' || c == '\t' || c == '\v' || c == '\f' || c == '\r';
+    }
+
+    // Walks the text a character at a time, keeping track of the line and column of the current character
+    // Backslash-newlines have already been removed, so lines that were joined are counted from the list of places
+    // where that happened
+    class Cursor {
+        std::string_view m_text;
+        const std::vector<std::size_t>& m_splices;
+        std::size_t m_nextSplice {0};
+        std::size_t m_position {0};
+        std::size_t m_lineStart {0};
+        std::uint32_t m_line {1};
+
+        // Count any splices at or before the current position as line breaks
+        void passSplices() {
+            while (m_nextSplice < m_splices.size() && m_splices[m_nextSplice] <= m_position) {
+                m_lineStart = m_splices[m_nextSplice];
+                ++m_line;
+                ++m_nextSplice;
+            }
+        }
+    public:
+        Cursor(std::string_view text, const std::vector<std::size_t>& splices)
+            : m_text{text}
+            , m_splices{splices}
+        {}
+
+        bool atEnd() const { return m_position >= m_text.size(); }
+        char peek(std::size_t ahead = 0) const {
+            return m_position + ahead < m_text.size() ? m_text[m_position + ahead] : '\0';
+        }
+        std::size_t position() const { return m_position; }
+        std::uint32_t line() const { return m_line; }
+        std::uint32_t column() const { return static_cast<std::uint32_t>(m_position - m_lineStart + 1); }
+        std::string_view rest() const { return m_text.substr(m_position); }
+
+        void advance(std::size_t count = 1) {
+            for (std::size_t i {0}; i < count && m_position < m_text.size(); ++i) {
+                if (m_text[m_position] == '\n') {
+                    ++m_line;
+                    m_lineStart = m_position + 1;
+                }
+                ++m_position;
+                passSplices();
+            }
+        }
+
+        std::string_view since(std::size_t start) const { return m_text.substr(start, m_position - start); }
+    };
+
+    // Moves past a character or string literal whose opening quote is under the cursor
+    // Returns false if the line ends first
+    bool skipLiteral(Cursor& cursor, char quote) {
+        cursor.advance();
+        while (!cursor.atEnd() && cursor.peek() != '\n') {
+            char c {cursor.peek()};
+            if (c == '\\') {
+                cursor.advance(2);
+                continue;
+            }
+            cursor.advance();
+            if (c == quote) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Works out the kind of the token starting under the cursor and moves past it
+    Kind scanToken(Cursor& cursor, std::vector<TokenizeError>* errors) {
+        char c {cursor.peek()};
+
+        // Encoding prefixes turn an identifier into the start of a literal
+        std::string_view rest {cursor.rest()};
+        for (std::string_view prefix : {"u8", "u", "U", "L"}) {
+            if (rest.starts_with(prefix) && rest.size() > prefix.size()
+                && (rest[prefix.size()] == '"' || rest[prefix.size()] == '\'')) {
+                cursor.advance(prefix.size());
+                c = cursor.peek();
+                break;
+            }
+        }
+
+        if (c == '"' || c == '\'') {
+            std::uint32_t line {cursor.line()};
+            std::uint32_t column {cursor.column()};
+            if (!skipLiteral(cursor, c) && errors) {
+                errors->push_back({line, column, std::string{"missing terminating "} + c + " character"});
+            }
+            return c == '"' ? Kind::StringLiteral : Kind::CharLiteral;
+        }
+        if (isIdentifierStart(c)) {
+            while (isIdentifierChar(cursor.peek())) {
+                cursor.advance();
+            }
+            return Kind::Identifier;
+        }
+        if (isDigit(c) || (c == '.' && isDigit(cursor.peek(1)))) {
+            // pp-numbers take in anything that could be part of a number, including exponent signs
+            cursor.advance();
+            while (isIdentifierChar(cursor.peek()) || cursor.peek() == '.') {
+                char consumed {cursor.peek()};
+                cursor.advance();
+                if ((consumed == 'e' || consumed == 'E' || consumed == 'p' || consumed == 'P')
+                    && (cursor.peek() == '+' || cursor.peek() == '-')) {
+                    cursor.advance();
+                }
+            }
+            return Kind::Number;
+        }
+        for (std::string_view punctuator : multiCharPunctuators) {
+            if (rest.starts_with(punctuator)) {
+                cursor.advance(punctuator.size());
+                return Kind::Punctuator;
+            }
+        }
+        cursor.advance();
+        return singleCharPunctuators.find(c) != std::string_view::npos ? Kind::Punctuator : Kind::Other;
+    }
+
+    PpTokens tokenize(std::string_view text, std::string& spliced, std::vector<TokenizeError>& errors) {
+        // Join lines ended with a backslash, remembering where each join was so line numbers stay right
+        std::vector<std::size_t> splices;
+        if (text.find("\\\n") != std::string_view::npos || text.find("\\\r\n") != std::string_view::npos) {
+            spliced.clear();
+            spliced.reserve(text.size());
+            for (std::size_t i {0}; i < text.size(); ++i) {
+                if (text[i] == '\\' && i + 1 < text.size() && text[i + 1] == '\n') {
+                    splices.push_back(spliced.size());
+                    ++i;
+                } else if (text[i] == '\\' && i + 2 < text.size() && text[i + 1] == '\r' && text[i + 2] == '\n') {
+                    splices.push_back(spliced.size());
+                    i += 2;
+                } else {
+                    spliced.push_back(text[i]);
+                }
+            }
+            text = spliced;
+        }
+
+        PpTokens tokens;
+        tokens.reserve(text.size() / 4);
+        Cursor cursor {text, splices};
+        bool spaceBefore {false};
+        bool lineStart {true};
+        while (!cursor.atEnd()) {
+            char c {cursor.peek()};
+            if (c == '\n') {
+                cursor.advance();
+                lineStart = true;
+                spaceBefore = false;
+                continue;
+            }
+            if (isHorizontalSpace(c)) {
+                cursor.advance();
+                spaceBefore = true;
+                continue;
+            }
+            if (c == '/' && cursor.peek(1) == '/') {
+                while (!cursor.atEnd() && cursor.peek() != '\n') {
+                    cursor.advance();
+                }
+                spaceBefore = true;
+                continue;
+            }
+            if (c == '/' && cursor.peek(1) == '*') {
+                std::uint32_t line {cursor.line()};
+                std::uint32_t column {cursor.column()};
+                std::size_t end {cursor.rest().find("*/", 2)};
+                if (end == std::string_view::npos) {
+                    errors.push_back({line, column, "unterminated comment"});
+                    cursor.advance(cursor.rest().size());
+                    break;
+                }
+                cursor.advance(end + 2);
+                // A comment counts as a single space, even one that spans several lines
+                spaceBefore = true;
+                continue;
+            }
+
+            PpToken token;
+            token.spaceBefore = spaceBefore;
+            token.lineStart = lineStart;
+            token.line = cursor.line();
+            token.column = cursor.column();
+            std::size_t start {cursor.position()};
+            token.kind = scanToken(cursor, &errors);
+            token.text = cursor.since(start);
+            tokens.push_back(token);
+            spaceBefore = false;
+            lineStart = false;
+        }
+        return tokens;
+    }
+
+    bool tokenizeOne(std::string_view text, PpToken& token) {
+        if (text.empty()) {
+            return false;
+        }
+        std::vector<std::size_t> noSplices;
+        Cursor cursor {text, noSplices};
+        token.kind = scanToken(cursor, nullptr);
+        token.text = text;
+        return cursor.atEnd();
+    }
+}
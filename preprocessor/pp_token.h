@@ -0,0 +1,64 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_PP_TOKEN_H
+#define DCC_PP_TOKEN_H
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Pp {
+    // Preprocessing tokens are coarser than the compiler's: every number is a Number however it is spelt, and any
+    // character that cannot start a token becomes an Other so it can still be passed through
+    enum class Kind : std::uint8_t {
+        Identifier,
+        Number,
+        CharLiteral,
+        StringLiteral,
+        Punctuator,
+        Other,
+        EndOfFile,
+    };
+
+    struct PpToken {
+        Kind kind {Kind::EndOfFile};
+        // Whitespace or a comment came before this token on its line
+        bool spaceBefore {false};
+        // First token on its line, which is what makes a # the start of a directive
+        bool lineStart {false};
+        // Produced by expanding a macro rather than read straight from a file
+        bool fromMacro {false};
+        std::string_view text;
+        // Where the token was written, or for macro output, where the macro was used
+        std::uint32_t file {0};
+        std::uint32_t line {0};
+        std::uint32_t column {0};
+        // Macros that must not be expanded again in this token, as an index into the preprocessor's hidesets
+        std::uint32_t hideset {0};
+
+        bool is(std::string_view punctuator) const { return kind == Kind::Punctuator && text == punctuator; }
+    };
+
+    using PpTokens = std::vector<PpToken>;
+
+    // An error found while tokenizing, at a line and column of the text
+    struct TokenizeError {
+        std::uint32_t line;
+        std::uint32_t column;
+        std::string message;
+    };
+
+    // Splits text into preprocessing tokens, dropping comments and joining lines ended by a backslash
+    // The returned tokens view text, or spliced if the text had any backslash-newlines, so both must outlive them
+    // Every token has file 0, which the caller replaces
+    PpTokens tokenize(std::string_view text, std::string& spliced, std::vector<TokenizeError>& errors);
+
+    // Tokenizes a single token's worth of text, as made by ## pasting
+    // Returns false unless text is exactly one token
+    bool tokenizeOne(std::string_view text, PpToken& token);
+}
+
+#endif //DCC_PP_TOKEN_H
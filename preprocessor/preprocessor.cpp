@@ -0,0 +1,1235 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#include <algorithm>
+#include <charconv>
+#include <deque>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "preprocessor.h"
+#include "pp_expression.h"
+
+namespace Pp {
+    // Deeper than this is almost certainly a file including itself
+    constexpr std::size_t maxIncludeDepth {200};
+    // Each level of macro call nested in another's argument keeps its own copy of the tokens inside it, so memory
+    // grows with the depth times the size of the argument. Real code stays far below this. Arguments are checked as
+    // they are read, so a call nested too deeply is caught before much of it has been copied
+    constexpr int maxArgumentDepth {256};
+
+    struct Macro {
+        enum Builtin : std::uint8_t { None, File, Line, Counter };
+
+        bool defined {false};
+        bool functionLike {false};
+        bool variadic {false};
+        Builtin builtin {None};
+        std::vector<std::string_view> parameters;
+        PpTokens body;
+        // For each body token, the index of the parameter it names, or -1
+        std::vector<int> bodyParameters;
+    };
+
+    // A file being read, and where reading has got to
+    struct IncludeFrame {
+        std::shared_ptr<const CachedFile> file;
+        std::size_t next {0};
+        // LineMap file index of the name errors should use, which #line can change
+        std::uint32_t mapFile {0};
+        // Added to physical line numbers, as set by #line
+        std::int64_t lineDelta {0};
+        // How many conditionals were open when the file was entered, so unterminated ones can be caught
+        std::size_t conditionalDepth {0};
+        // Index of the search path the file was found in, or -1 if found relative to the including file
+        int searchIndex {-1};
+    };
+
+    // A hideset is the one at parent with macro added. Hidesets are never changed once made, so they can share
+    struct HidesetNode {
+        std::uint32_t parent;
+        std::uint32_t macro;
+        std::uint32_t size;
+        // An ancestor further up than parent, for skipping up long hidesets
+        std::uint32_t jump;
+    };
+
+    // One level of #if nesting
+    struct Conditional {
+        // Lines are currently being kept
+        bool active;
+        // Some branch has been taken already, so later #elif and #else branches are skipped
+        bool taken;
+        bool seenElse;
+        PpToken where;
+    };
+
+    class Preprocessor {
+        const Options& m_options;
+        IncludeCache& m_cache;
+        Result m_result;
+
+        std::vector<IncludeFrame> m_frames;
+        // Tokens to be read before going back to the file, read from the back
+        PpTokens m_pending;
+        // While above 0, reading stops when m_pending runs out instead of going back to the file
+        int m_isolation {0};
+        std::vector<Conditional> m_conditionals;
+
+        std::vector<Macro> m_macros;
+        std::unordered_map<std::string_view, std::uint32_t> m_macroIds;
+
+        // Hideset 0 is empty. Each other one is an earlier hideset plus one macro, so adding to a hideset never copies it
+        std::vector<HidesetNode> m_hidesets {{0, 0, 0, 0}};
+        std::unordered_map<std::uint64_t, std::uint32_t> m_hidesetAdditions;
+        // For each macro id, the hidesets that added it
+        std::vector<std::vector<std::uint32_t>> m_hidesetsAdding;
+
+        // Text made by the preprocessor, such as pasted tokens, that tokens need to point into
+        std::deque<std::string> m_arena;
+        // Keeps every file used in this run alive, since tokens and macros point into their text
+        std::vector<std::shared_ptr<const CachedFile>> m_files;
+        std::unordered_map<std::string, std::uint32_t> m_mapFiles;
+        std::unordered_set<std::string> m_pragmaOnce;
+        std::unordered_map<std::string, std::optional<std::pair<std::filesystem::path, int>>> m_resolved;
+        std::uint64_t m_counter {0};
+
+        // Output state
+        std::uint32_t m_outFile {UINT32_MAX};
+        std::uint32_t m_outLine {0};
+        Src::Offset m_entryStart {0};
+        std::uint64_t m_entryColumn {0};
+        PpToken m_previous;
+
+        ///////////////
+        /// Helpers ///
+        ///////////////
+        std::string_view store(std::string text) {
+            return m_arena.emplace_back(std::move(text));
+        }
+
+        Src::Origin originOf(const PpToken& token) const {
+            return Src::Origin{m_result.lineMap->file(token.file), Src::Location{token.line, token.column}};
+        }
+
+        void error(const PpToken& token, std::string_view message) {
+            m_result.errors.push_back(Src::formatError(originOf(token), message));
+        }
+
+        void warning(const PpToken& token, std::string_view message) {
+            std::string text {Src::formatError(originOf(token), message)};
+            // formatError always says error
+            text.replace(text.find(": error: "), 9, ": warning: ");
+            m_result.warnings.push_back(std::move(text));
+        }
+
+        std::uint32_t mapFile(const std::string& name) {
+            auto [found, inserted] {m_mapFiles.try_emplace(name, 0)};
+            if (inserted) {
+                found->second = m_result.lineMap->addFile(name);
+            }
+            return found->second;
+        }
+
+        bool active() const {
+            return m_conditionals.empty() || m_conditionals.back().active;
+        }
+
+        const Macro* findMacro(std::string_view name) const {
+            auto found {m_macroIds.find(name)};
+            if (found == m_macroIds.end() || !m_macros[found->second].defined) {
+                return nullptr;
+            }
+            return &m_macros[found->second];
+        }
+
+        std::uint32_t macroId(std::string_view name) {
+            auto [found, inserted] {m_macroIds.try_emplace(name, static_cast<std::uint32_t>(m_macros.size()))};
+            if (inserted) {
+                m_macros.emplace_back();
+            }
+            return found->second;
+        }
+
+        ////////////////
+        /// Hidesets ///
+        ////////////////
+        // The ancestor of hideset, or hideset itself, with the given number of members
+        std::uint32_t hidesetAncestor(std::uint32_t hideset, std::uint32_t size) const {
+            while (m_hidesets[hideset].size > size) {
+                const HidesetNode& node {m_hidesets[hideset]};
+                hideset = m_hidesets[node.jump].size >= size ? node.jump : node.parent;
+            }
+            return hideset;
+        }
+
+        bool hidesetContains(std::uint32_t hideset, std::uint32_t macro) const {
+            if (hideset == 0 || macro >= m_hidesetsAdding.size()) {
+                return false;
+            }
+            // Either check whether any hideset that added macro is an ancestor of this one, or walk up the members,
+            // whichever is shorter. A chain of macros gets ever larger hidesets, but each macro in it is added once
+            const auto& adding {m_hidesetsAdding[macro]};
+            if (adding.size() * 8 < m_hidesets[hideset].size) {
+                for (std::uint32_t candidate : adding) {
+                    if (hidesetAncestor(hideset, m_hidesets[candidate].size) == candidate) {
+                        return true;
+                    }
+                }
+                return false;
+            }
+            for (; hideset != 0; hideset = m_hidesets[hideset].parent) {
+                if (m_hidesets[hideset].macro == macro) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        std::uint32_t hidesetAdd(std::uint32_t hideset, std::uint32_t macro) {
+            if (hidesetContains(hideset, macro)) {
+                return hideset;
+            }
+            std::uint64_t key {(static_cast<std::uint64_t>(hideset) << 32) | macro};
+            auto [found, inserted] {m_hidesetAdditions.try_emplace(key, static_cast<std::uint32_t>(m_hidesets.size()))};
+            if (!inserted) {
+                return found->second;
+            }
+            // Skew binary jump pointers, so finding an ancestor takes logarithmic time
+            const HidesetNode& parent {m_hidesets[hideset]};
+            const HidesetNode& jump {m_hidesets[parent.jump]};
+            bool evenJumps {hideset != 0 && parent.size - jump.size == jump.size - m_hidesets[jump.jump].size};
+            m_hidesets.push_back({hideset, macro, parent.size + 1, evenJumps ? jump.jump : hideset});
+            if (macro >= m_hidesetsAdding.size()) {
+                m_hidesetsAdding.resize(macro + 1);
+            }
+            m_hidesetsAdding[macro].push_back(found->second);
+            return found->second;
+        }
+
+        // True if every member of inner is in outer because outer was built on top of it
+        bool hidesetExtends(std::uint32_t outer, std::uint32_t inner) const {
+            return m_hidesets[inner].size <= m_hidesets[outer].size
+                   && hidesetAncestor(outer, m_hidesets[inner].size) == inner;
+        }
+
+        std::uint32_t hidesetUnion(std::uint32_t left, std::uint32_t right) {
+            // Body tokens have no hideset of their own, and arguments have an earlier hideset of the same chain of
+            // expansions, so this is nearly always just right
+            if (hidesetExtends(right, left)) {
+                return right;
+            }
+            if (hidesetExtends(left, right)) {
+                return left;
+            }
+            for (; right != 0; right = m_hidesets[right].parent) {
+                left = hidesetAdd(left, m_hidesets[right].macro);
+            }
+            return left;
+        }
+
+        std::uint32_t hidesetIntersection(std::uint32_t left, std::uint32_t right) {
+            if (hidesetExtends(right, left)) {
+                return left;
+            }
+            if (hidesetExtends(left, right)) {
+                return right;
+            }
+            std::uint32_t result {0};
+            for (; left != 0; left = m_hidesets[left].parent) {
+                if (hidesetContains(right, m_hidesets[left].macro)) {
+                    result = hidesetAdd(result, m_hidesets[left].macro);
+                }
+            }
+            return result;
+        }
+
+        ///////////////
+        /// Reading ///
+        ///////////////
+        // Next token with no macro expansion, handling any directives on the way
+        bool readRaw(PpToken& token) {
+            while (true) {
+                if (!m_pending.empty()) {
+                    token = m_pending.back();
+                    m_pending.pop_back();
+                    return true;
+                }
+                if (m_isolation > 0 || m_frames.empty()) {
+                    return false;
+                }
+
+                IncludeFrame& frame {m_frames.back()};
+                const PpTokens& tokens {frame.file->tokens};
+                if (frame.next == tokens.size()) {
+                    leaveFile();
+                    continue;
+                }
+                const PpToken& next {tokens[frame.next]};
+                if (next.lineStart && next.is("#")) {
+                    directive();
+                    continue;
+                }
+                ++frame.next;
+                if (!active()) {
+                    continue;
+                }
+                token = next;
+                token.file = frame.mapFile;
+                token.line = static_cast<std::uint32_t>(static_cast<std::int64_t>(next.line) + frame.lineDelta);
+                return true;
+            }
+        }
+
+        // Next token after macro expansion
+        bool next(PpToken& token) {
+            while (readRaw(token)) {
+                if (token.kind != Kind::Identifier || !expand(token)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Fully expand tokens on their own, without reading anything after them
+        PpTokens expandAll(const PpTokens& tokens) {
+            if (m_isolation >= maxArgumentDepth && !tokens.empty()) {
+                // collectArguments catches calls written nested too deeply, so this is only reached through nesting
+                // that macros build up. Dropped rather than left unexpanded, as rescanning would expand them anyway,
+                // one level at a time
+                error(tokens.front(), "macro arguments nested deeper than the maximum of "
+                      + std::to_string(maxArgumentDepth));
+                return {};
+            }
+            PpTokens saved {std::move(m_pending)};
+            m_pending.assign(tokens.rbegin(), tokens.rend());
+            ++m_isolation;
+            PpTokens expanded;
+            PpToken token;
+            while (next(token)) {
+                expanded.push_back(token);
+            }
+            --m_isolation;
+            m_pending = std::move(saved);
+            return expanded;
+        }
+
+        // Put tokens back to be read next, first token first
+        void pushBack(const PpTokens& tokens) {
+            m_pending.insert(m_pending.end(), tokens.rbegin(), tokens.rend());
+        }
+
+        /////////////////
+        /// Expansion ///
+        /////////////////
+        // If token names a macro that may be expanded here, expand it into m_pending and return true
+        bool expand(const PpToken& token) {
+            auto found {m_macroIds.find(token.text)};
+            if (found == m_macroIds.end()) {
+                return false;
+            }
+            std::uint32_t id {found->second};
+            const Macro& macro {m_macros[id]};
+            if (!macro.defined || hidesetContains(token.hideset, id)) {
+                return false;
+            }
+
+            if (macro.builtin != Macro::None) {
+                PpToken result {token};
+                result.fromMacro = true;
+                if (macro.builtin == Macro::File) {
+                    result.kind = Kind::StringLiteral;
+                    result.text = store(stringLiteral(m_result.lineMap->file(token.file).string()));
+                } else {
+                    result.kind = Kind::Number;
+                    result.text = store(std::to_string(macro.builtin == Macro::Line ? token.line : m_counter++));
+                }
+                m_pending.push_back(result);
+                return true;
+            }
+
+            if (!macro.functionLike) {
+                pushBack(substitute(macro, {}, hidesetAdd(token.hideset, id), token));
+                return true;
+            }
+
+            // A function-like macro name without a ( after it is just an identifier
+            PpToken paren;
+            if (!readRaw(paren)) {
+                return false;
+            }
+            if (!paren.is("(")) {
+                m_pending.push_back(paren);
+                return false;
+            }
+            std::vector<PpTokens> arguments;
+            PpToken closing;
+            if (!collectArguments(macro, token, arguments, closing)) {
+                return true;
+            }
+            std::uint32_t hideset {hidesetAdd(hidesetIntersection(token.hideset, closing.hideset), id)};
+            pushBack(substitute(macro, arguments, hideset, token));
+            return true;
+        }
+
+        // True if a ( after token would start a call of a function-like macro
+        bool startsCall(const PpToken& token) const {
+            if (token.kind != Kind::Identifier) {
+                return false;
+            }
+            auto found {m_macroIds.find(token.text)};
+            if (found == m_macroIds.end()) {
+                return false;
+            }
+            const Macro& macro {m_macros[found->second]};
+            return macro.defined && macro.functionLike && !hidesetContains(token.hideset, found->second);
+        }
+
+        // Reads the arguments of a function-like macro call up to the closing )
+        // Returns false, having reported an error, if they are malformed
+        bool collectArguments(const Macro& macro, const PpToken& name, std::vector<PpTokens>& arguments,
+                              PpToken& closing) {
+            arguments.emplace_back();
+            int depth {0};
+            // For each open (, whether it starts a call of a function-like macro, which will be expanded one level of
+            // argument nesting further in
+            std::vector<bool> callParens;
+            int callDepth {0};
+            bool tooDeep {false};
+            PpToken previous;
+            PpToken token;
+            while (true) {
+                if (!readRaw(token)) {
+                    error(name, "unterminated argument list invoking macro \"" + std::string{name.text} + "\"");
+                    return false;
+                }
+                if (token.is("(")) {
+                    ++depth;
+                    bool call {startsCall(previous)};
+                    callParens.push_back(call);
+                    callDepth += call;
+                    // Stop keeping the arguments as soon as they are known to nest too deeply, rather than copying
+                    // them at every level until expansion reaches the limit
+                    if (!tooDeep && m_isolation + callDepth >= maxArgumentDepth) {
+                        error(token, "macro arguments nested deeper than the maximum of "
+                              + std::to_string(maxArgumentDepth));
+                        tooDeep = true;
+                        arguments.clear();
+                    }
+                } else if (token.is(")")) {
+                    if (depth == 0) {
+                        closing = token;
+                        break;
+                    }
+                    --depth;
+                    callDepth -= callParens.back();
+                    callParens.pop_back();
+                }
+                previous = token;
+                if (tooDeep) {
+                    continue;
+                }
+                if (token.is(",") && depth == 0
+                    && !(macro.variadic && arguments.size() == macro.parameters.size())) {
+                    arguments.emplace_back();
+                    continue;
+                }
+                // Arguments spread over several lines are joined onto one
+                token.lineStart = false;
+                arguments.back().push_back(token);
+            }
+
+            if (tooDeep) {
+                return false;
+            }
+            std::size_t expected {macro.parameters.size()};
+            // f() passes one empty argument, which is no arguments for a macro with no parameters
+            if (expected == 0 && arguments.size() == 1 && arguments[0].empty()) {
+                arguments.clear();
+            }
+            // The variadic part may be left out entirely
+            if (macro.variadic && arguments.size() == expected - 1) {
+                arguments.emplace_back();
+            }
+            if (arguments.size() != expected) {
+                error(name, "macro \"" + std::string{name.text} + "\" " + (arguments.size() < expected
+                        ? "requires " + std::to_string(expected) + " arguments, but only "
+                          + std::to_string(arguments.size()) + " given"
+                        : "passed " + std::to_string(arguments.size()) + " arguments, but takes just "
+                          + std::to_string(expected)));
+                return false;
+            }
+            return true;
+        }
+
+        static std::string stringLiteral(std::string_view text) {
+            std::string quoted {"\""};
+            for (char c : text) {
+                if (c == '"' || c == '\\') {
+                    quoted += '\\';
+                }
+                quoted += c;
+            }
+            return quoted + "\"";
+        }
+
+        // The # operator
+        PpToken stringize(const PpTokens& argument, const PpToken& hash) {
+            std::string text {"\""};
+            for (std::size_t i {0}; i < argument.size(); ++i) {
+                const PpToken& token {argument[i]};
+                if (i > 0 && token.spaceBefore) {
+                    text += ' ';
+                }
+                bool literal {token.kind == Kind::StringLiteral || token.kind == Kind::CharLiteral};
+                for (char c : token.text) {
+                    if (literal && (c == '"' || c == '\\')) {
+                        text += '\\';
+                    }
+                    text += c;
+                }
+            }
+            text += '"';
+            PpToken result {hash};
+            result.kind = Kind::StringLiteral;
+            result.text = store(std::move(text));
+            return result;
+        }
+
+        // The ## operator. Reports an error and leaves the tokens apart if they do not make one token
+        bool paste(PpToken& left, const PpToken& right) {
+            std::string text {std::string{left.text} + std::string{right.text}};
+            PpToken pasted {left};
+            if (!tokenizeOne(text, pasted)) {
+                error(left, "pasting \"" + std::string{left.text} + "\" and \"" + std::string{right.text}
+                      + "\" does not give a valid preprocessing token");
+                return false;
+            }
+            pasted.text = store(std::move(text));
+            left = pasted;
+            return true;
+        }
+
+        // Replaces the parameters in a macro's body, then marks every resulting token as coming from the call site
+        PpTokens substitute(const Macro& macro, const std::vector<PpTokens>& arguments, std::uint32_t hideset,
+                            const PpToken& site) {
+            const PpTokens& body {macro.body};
+            const std::vector<int>& parameters {macro.bodyParameters};
+            std::vector<std::optional<PpTokens>> expandedArguments(arguments.size());
+            int variadicIndex {macro.variadic ? static_cast<int>(macro.parameters.size()) - 1 : -1};
+
+            PpTokens out;
+            // Set when the last thing added was an empty argument, which ## treats as nothing at all
+            bool placemarker {false};
+            for (std::size_t i {0}; i < body.size(); ++i) {
+                const PpToken& token {body[i]};
+                bool beforePaste {i + 1 < body.size() && body[i + 1].is("##")};
+
+                if (macro.functionLike && token.is("#") && i + 1 < body.size() && parameters[i + 1] >= 0) {
+                    out.push_back(stringize(arguments[parameters[i + 1]], token));
+                    ++i;
+                    placemarker = false;
+                    continue;
+                }
+
+                // GNU extension: , ## __VA_ARGS__ drops the comma if there are no variadic arguments
+                if (token.is(",") && beforePaste && i + 2 < body.size() && variadicIndex >= 0
+                    && parameters[i + 2] == variadicIndex) {
+                    const PpTokens& rest {arguments[variadicIndex]};
+                    if (!rest.empty()) {
+                        out.push_back(token);
+                        out.insert(out.end(), rest.begin(), rest.end());
+                    }
+                    i += 2;
+                    placemarker = false;
+                    continue;
+                }
+
+                if (token.is("##") && i + 1 < body.size()) {
+                    PpTokens right {parameters[i + 1] >= 0 ? arguments[parameters[i + 1]] : PpTokens{body[i + 1]}};
+                    ++i;
+                    if (right.empty()) {
+                        continue;
+                    }
+                    if (placemarker || out.empty()) {
+                        out.insert(out.end(), right.begin(), right.end());
+                    } else if (!paste(out.back(), right.front())) {
+                        out.insert(out.end(), right.begin(), right.end());
+                    } else {
+                        out.insert(out.end(), right.begin() + 1, right.end());
+                    }
+                    placemarker = false;
+                    continue;
+                }
+
+                if (parameters[i] >= 0) {
+                    std::size_t index {static_cast<std::size_t>(parameters[i])};
+                    // Arguments next to ## are used as written. Anywhere else they are expanded first
+                    if (beforePaste) {
+                        out.insert(out.end(), arguments[index].begin(), arguments[index].end());
+                        placemarker = arguments[index].empty();
+                    } else {
+                        if (!expandedArguments[index]) {
+                            expandedArguments[index] = expandAll(arguments[index]);
+                        }
+                        out.insert(out.end(), expandedArguments[index]->begin(), expandedArguments[index]->end());
+                        placemarker = false;
+                    }
+                    continue;
+                }
+
+                out.push_back(token);
+                placemarker = false;
+            }
+
+            for (std::size_t i {0}; i < out.size(); ++i) {
+                PpToken& token {out[i]};
+                token.hideset = hidesetUnion(token.hideset, hideset);
+                token.fromMacro = true;
+                token.lineStart = false;
+                token.file = site.file;
+                token.line = site.line;
+                token.column = site.column;
+                if (i == 0) {
+                    token.spaceBefore = site.spaceBefore;
+                }
+            }
+            return out;
+        }
+
+        //////////////////
+        /// Directives ///
+        //////////////////
+        // Takes the rest of the directive's line out of the current file
+        PpTokens directiveLine() {
+            IncludeFrame& frame {m_frames.back()};
+            const PpTokens& tokens {frame.file->tokens};
+            PpTokens line;
+            // Skip the #
+            ++frame.next;
+            while (frame.next < tokens.size() && !tokens[frame.next].lineStart) {
+                PpToken token {tokens[frame.next++]};
+                token.file = frame.mapFile;
+                token.line = static_cast<std::uint32_t>(static_cast<std::int64_t>(token.line) + frame.lineDelta);
+                line.push_back(token);
+            }
+            return line;
+        }
+
+        void directive() {
+            IncludeFrame& frame {m_frames.back()};
+            PpToken hash {frame.file->tokens[frame.next]};
+            hash.file = frame.mapFile;
+            hash.line = static_cast<std::uint32_t>(static_cast<std::int64_t>(hash.line) + frame.lineDelta);
+            std::uint32_t physicalLine {frame.file->tokens[frame.next].line};
+            PpTokens line {directiveLine()};
+            if (line.empty()) {
+                return;
+            }
+            std::string_view name {line.front().text};
+            PpTokens rest {line.begin() + 1, line.end()};
+
+            // Conditionals are followed even while skipping, to keep track of nesting
+            if (name == "if" || name == "ifdef" || name == "ifndef") {
+                bool parentActive {active()};
+                bool taken {parentActive && condition(name, line.front(), rest)};
+                // A skipped #if counts as taken so none of its branches are used
+                m_conditionals.push_back(Conditional{taken, taken || !parentActive, false, hash});
+                return;
+            }
+            if (name == "elif" || name == "else" || name == "endif") {
+                conditionalBranch(name, line.front(), rest);
+                return;
+            }
+            if (!active()) {
+                return;
+            }
+
+            if (line.front().kind == Kind::Number) {
+                // GNU line marker, # 12 "file.c" flags
+                lineDirective(line, physicalLine);
+            } else if (name == "define") {
+                define(line.front(), rest);
+            } else if (name == "undef") {
+                if (rest.empty() || rest.front().kind != Kind::Identifier) {
+                    error(line.front(), "macro names must be identifiers");
+                } else if (auto found {m_macroIds.find(rest.front().text)}; found != m_macroIds.end()) {
+                    m_macros[found->second].defined = false;
+                }
+            } else if (name == "include" || name == "include_next") {
+                include(line.front(), rest, name == "include_next");
+            } else if (name == "line") {
+                lineDirective(expandAll(rest), physicalLine);
+            } else if (name == "error" || name == "warning") {
+                std::string message {"#" + std::string{name}};
+                for (const PpToken& token : rest) {
+                    message += " ";
+                    message += token.text;
+                }
+                if (name == "error") {
+                    error(hash, message);
+                } else {
+                    warning(hash, message);
+                }
+            } else if (name == "pragma") {
+                if (!rest.empty() && rest.front().text == "once") {
+                    m_pragmaOnce.insert(frame.file->path.lexically_normal().string());
+                }
+                // Any other pragma means nothing to this compiler, so it is dropped
+            } else if (name == "ident" || name == "sccs") {
+                // Version strings, which gcc puts in the object file's comment section. Nothing to do
+            } else {
+                error(line.front(), "invalid preprocessing directive #" + std::string{name});
+            }
+        }
+
+        // Works out whether a #if, #ifdef, #ifndef or #elif is true
+        bool condition(std::string_view name, const PpToken& where, const PpTokens& rest) {
+            if (name == "ifdef" || name == "ifndef") {
+                if (rest.empty() || rest.front().kind != Kind::Identifier) {
+                    error(where, "no macro name given in #" + std::string{name} + " directive");
+                    return false;
+                }
+                return (findMacro(rest.front().text) != nullptr) == (name == "ifdef");
+            }
+            if (rest.empty()) {
+                error(where, "#" + std::string{name} + " with no expression");
+                return false;
+            }
+
+            try {
+                return evaluateCondition(expandAll(replaceDefined(rest)));
+            } catch (const std::invalid_argument& problem) {
+                error(where, problem.what());
+                return false;
+            }
+        }
+
+        // Replaces defined X, defined(X) and __has_include(...) with 1 or 0, before the line is macro expanded
+        PpTokens replaceDefined(const PpTokens& tokens) {
+            static constexpr std::string_view one {"1"};
+            static constexpr std::string_view zero {"0"};
+            PpTokens replaced;
+            for (std::size_t i {0}; i < tokens.size(); ++i) {
+                const PpToken& token {tokens[i]};
+                bool isDefined {token.text == "defined"};
+                bool isHasInclude {token.text == "__has_include" || token.text == "__has_include_next"};
+                if (token.kind != Kind::Identifier || (!isDefined && !isHasInclude)) {
+                    replaced.push_back(token);
+                    continue;
+                }
+
+                bool result {false};
+                bool parenthesised {i + 1 < tokens.size() && tokens[i + 1].is("(")};
+                std::size_t position {parenthesised ? i + 2 : i + 1};
+                if (isDefined) {
+                    if (position >= tokens.size() || tokens[position].kind != Kind::Identifier) {
+                        throw std::invalid_argument("operator \"defined\" requires an identifier");
+                    }
+                    result = findMacro(tokens[position].text) != nullptr;
+                    ++position;
+                } else {
+                    if (!parenthesised) {
+                        throw std::invalid_argument("missing '(' after \"" + std::string{token.text} + "\"");
+                    }
+                    std::size_t close {position};
+                    while (close < tokens.size() && !tokens[close].is(")")) {
+                        ++close;
+                    }
+                    PpTokens header {tokens.begin() + static_cast<std::ptrdiff_t>(position),
+                                     tokens.begin() + static_cast<std::ptrdiff_t>(close)};
+                    bool angled {};
+                    std::optional<std::string> headerName {includeName(header, angled)};
+                    result = headerName
+                        && resolve(*headerName, angled, token.text == "__has_include_next").has_value();
+                    position = close;
+                    parenthesised = true;
+                }
+                if (parenthesised) {
+                    if (position >= tokens.size() || !tokens[position].is(")")) {
+                        throw std::invalid_argument("missing ')' after \"" + std::string{token.text} + "\"");
+                    }
+                    ++position;
+                }
+
+                PpToken number {token};
+                number.kind = Kind::Number;
+                number.text = result ? one : zero;
+                replaced.push_back(number);
+                i = position - 1;
+            }
+            return replaced;
+        }
+
+        void conditionalBranch(std::string_view name, const PpToken& where, const PpTokens& rest) {
+            if (m_conditionals.size() <= m_frames.back().conditionalDepth) {
+                error(where, "#" + std::string{name} + " without #if");
+                return;
+            }
+            if (name == "endif") {
+                m_conditionals.pop_back();
+                return;
+            }
+
+            Conditional& current {m_conditionals.back()};
+            if (current.seenElse) {
+                error(where, "#" + std::string{name} + " after #else");
+                return;
+            }
+            bool parentActive {m_conditionals.size() == 1 || m_conditionals[m_conditionals.size() - 2].active};
+            if (name == "else") {
+                current.seenElse = true;
+                current.active = parentActive && !current.taken;
+                current.taken = true;
+                return;
+            }
+            // The #elif expression is only looked at if no earlier branch was taken
+            current.active = parentActive && !current.taken && condition("elif", where, rest);
+            current.taken = current.taken || current.active;
+        }
+
+        void define(const PpToken& where, const PpTokens& rest) {
+            if (rest.empty() || rest.front().kind != Kind::Identifier) {
+                error(where, "macro names must be identifiers");
+                return;
+            }
+            const PpToken& name {rest.front()};
+            if (name.text == "defined") {
+                error(name, "\"defined\" cannot be used as a macro name");
+                return;
+            }
+
+            Macro macro;
+            macro.defined = true;
+            std::size_t position {1};
+            // Only a ( straight after the name, with no space, makes a function-like macro
+            if (rest.size() > 1 && rest[1].is("(") && !rest[1].spaceBefore) {
+                macro.functionLike = true;
+                position = 2;
+                bool expectParameter {true};
+                while (true) {
+                    if (position >= rest.size()) {
+                        error(name, "missing ')' in macro parameter list");
+                        return;
+                    }
+                    const PpToken& token {rest[position++]};
+                    if (token.is(")") && (!expectParameter || macro.parameters.empty())) {
+                        break;
+                    }
+                    if (expectParameter && token.is("...")) {
+                        macro.variadic = true;
+                        macro.parameters.push_back("__VA_ARGS__");
+                        expectParameter = false;
+                        if (position >= rest.size() || !rest[position].is(")")) {
+                            error(name, "missing ')' after \"...\"");
+                            return;
+                        }
+                        continue;
+                    }
+                    if (expectParameter && token.kind == Kind::Identifier) {
+                        macro.parameters.push_back(token.text);
+                        // GNU named variadic parameter, args...
+                        if (position < rest.size() && rest[position].is("...")) {
+                            macro.variadic = true;
+                            ++position;
+                        }
+                        expectParameter = false;
+                        continue;
+                    }
+                    if (!expectParameter && token.is(",") && !macro.variadic) {
+                        expectParameter = true;
+                        continue;
+                    }
+                    error(token, "expected parameter name, found \"" + std::string{token.text} + "\"");
+                    return;
+                }
+            }
+
+            macro.body.assign(rest.begin() + static_cast<std::ptrdiff_t>(position), rest.end());
+            if (!macro.body.empty()) {
+                macro.body.front().spaceBefore = false;
+            }
+            for (const PpToken& token : macro.body) {
+                auto found {std::find(macro.parameters.begin(), macro.parameters.end(), token.text)};
+                bool isParameter {macro.functionLike && token.kind == Kind::Identifier && found != macro.parameters.end()};
+                macro.bodyParameters.push_back(isParameter ? static_cast<int>(found - macro.parameters.begin()) : -1);
+            }
+
+            if (!macro.body.empty() && (macro.body.front().is("##") || macro.body.back().is("##"))) {
+                error(name, "'##' cannot appear at either end of a macro expansion");
+                return;
+            }
+            if (macro.functionLike) {
+                for (std::size_t i {0}; i < macro.body.size(); ++i) {
+                    if (macro.body[i].is("#") && (i + 1 == macro.body.size() || macro.bodyParameters[i + 1] < 0)) {
+                        error(macro.body[i], "'#' is not followed by a macro parameter");
+                        return;
+                    }
+                }
+            }
+
+            std::uint32_t id {macroId(name.text)};
+            Macro& existing {m_macros[id]};
+            if (existing.defined && !sameDefinition(existing, macro)) {
+                warning(name, "\"" + std::string{name.text} + "\" redefined");
+            }
+            existing = std::move(macro);
+        }
+
+        static bool sameDefinition(const Macro& left, const Macro& right) {
+            if (left.functionLike != right.functionLike || left.variadic != right.variadic
+                || left.builtin != right.builtin || left.parameters != right.parameters
+                || left.body.size() != right.body.size()) {
+                return false;
+            }
+            for (std::size_t i {0}; i < left.body.size(); ++i) {
+                if (left.body[i].text != right.body[i].text
+                    || (i > 0 && left.body[i].spaceBefore != right.body[i].spaceBefore)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // #line 12 "file.c", or the GNU line marker # 12 "file.c"
+        void lineDirective(const PpTokens& tokens, std::uint32_t physicalLine) {
+            IncludeFrame& frame {m_frames.back()};
+            std::uint64_t line {};
+            if (tokens.empty() || tokens.front().kind != Kind::Number
+                || std::from_chars(tokens.front().text.data(), tokens.front().text.data() + tokens.front().text.size(),
+                                   line).ec != std::errc{}) {
+                if (!tokens.empty()) {
+                    error(tokens.front(), "\"" + std::string{tokens.front().text}
+                          + "\" after #line is not a positive integer");
+                }
+                return;
+            }
+            // The line after the directive becomes line
+            frame.lineDelta = static_cast<std::int64_t>(line) - static_cast<std::int64_t>(physicalLine) - 1;
+            if (tokens.size() > 1) {
+                if (tokens[1].kind != Kind::StringLiteral) {
+                    error(tokens[1], "invalid filename \"" + std::string{tokens[1].text} + "\"");
+                    return;
+                }
+                std::string_view name {tokens[1].text};
+                frame.mapFile = mapFile(std::string{name.substr(1, name.size() - 2)});
+            }
+        }
+
+        // The file name in a #include or __has_include, either "name" or <name>
+        std::optional<std::string> includeName(const PpTokens& tokens, bool& angled) {
+            if (tokens.empty()) {
+                return std::nullopt;
+            }
+            if (tokens.front().kind == Kind::StringLiteral && tokens.front().text.front() == '"') {
+                angled = false;
+                return std::string{tokens.front().text.substr(1, tokens.front().text.size() - 2)};
+            }
+            if (tokens.front().is("<")) {
+                angled = true;
+                std::string name;
+                for (std::size_t i {1}; i < tokens.size(); ++i) {
+                    if (tokens[i].is(">")) {
+                        return name;
+                    }
+                    if (i > 1 && tokens[i].spaceBefore) {
+                        name += ' ';
+                    }
+                    name += tokens[i].text;
+                }
+            }
+            return std::nullopt;
+        }
+
+        // Finds an included file. Lookups are remembered, since the same headers are included again and again
+        // Returns the path and the index of the search path it was found in, or -1 for the including file's directory
+        std::optional<std::pair<std::filesystem::path, int>> resolve(const std::string& name, bool angled, bool next) {
+            const IncludeFrame& frame {m_frames.back()};
+            std::filesystem::path directory {frame.file->path.parent_path()};
+            int start {next ? frame.searchIndex + 1 : 0};
+            std::string key {directory.string() + '\0' + name + '\0' + (angled ? "<" : "\"") + std::to_string(start)};
+            auto [found, inserted] {m_resolved.try_emplace(key)};
+            if (!inserted) {
+                return found->second;
+            }
+
+            auto exists = [this](const std::filesystem::path& path) {
+                return m_cache.exists(path);
+            };
+
+            std::optional<std::pair<std::filesystem::path, int>> result;
+            std::filesystem::path requested {name};
+            if (requested.is_absolute()) {
+                if (exists(requested)) {
+                    result.emplace(requested, -1);
+                }
+            } else if (!angled && !next && exists(directory / requested)) {
+                result.emplace(directory / requested, -1);
+            } else {
+                int index {0};
+                for (const auto* paths : {&m_options.includePaths, &m_options.systemPaths}) {
+                    for (const auto& searchPath : *paths) {
+                        if (index >= start && exists(searchPath / requested)) {
+                            result.emplace(searchPath / requested, index);
+                            break;
+                        }
+                        ++index;
+                    }
+                    if (result) {
+                        break;
+                    }
+                }
+            }
+            found->second = result;
+            return result;
+        }
+
+        void include(const PpToken& where, const PpTokens& rest, bool next) {
+            bool angled {false};
+            std::optional<std::string> name {includeName(rest, angled)};
+            if (!name) {
+                // #include MACRO, where the macro expands to one of the two forms
+                name = includeName(expandAll(rest), angled);
+            }
+            if (!name) {
+                error(where, "#include expects \"FILENAME\" or <FILENAME>");
+                return;
+            }
+
+            auto resolved {resolve(*name, angled, next)};
+            if (!resolved) {
+                error(where, *name + ": No such file or directory");
+                return;
+            }
+            if (m_frames.size() >= maxIncludeDepth) {
+                error(where, "#include nested depth " + std::to_string(m_frames.size()) + " exceeds maximum of "
+                      + std::to_string(maxIncludeDepth));
+                return;
+            }
+            if (m_pragmaOnce.contains(resolved->first.lexically_normal().string())) {
+                return;
+            }
+
+            std::shared_ptr<const CachedFile> file;
+            try {
+                file = m_cache.load(resolved->first);
+            } catch (const std::runtime_error& problem) {
+                error(where, problem.what());
+                return;
+            }
+            // A guarded header whose guard is already defined would produce nothing, so skip it unread
+            if (file->guard && findMacro(*file->guard)) {
+                return;
+            }
+            enterFile(std::move(file), resolved->second);
+        }
+
+        void enterFile(std::shared_ptr<const CachedFile> file, int searchIndex) {
+            IncludeFrame frame;
+            frame.mapFile = mapFile(file->path.string());
+            frame.conditionalDepth = m_conditionals.size();
+            frame.searchIndex = searchIndex;
+            for (const TokenizeError& problem : file->errors) {
+                m_result.errors.push_back(Src::formatError(
+                    Src::Origin{file->path, Src::Location{problem.line, problem.column}}, problem.message));
+            }
+            frame.file = file;
+            m_files.push_back(std::move(file));
+            m_frames.push_back(std::move(frame));
+        }
+
+        void leaveFile() {
+            IncludeFrame& frame {m_frames.back()};
+            // Any #if left open at the end of a file is an error, and is closed so the including file carries on
+            while (m_conditionals.size() > frame.conditionalDepth) {
+                error(m_conditionals.back().where, "unterminated conditional directive");
+                m_conditionals.pop_back();
+            }
+            m_frames.pop_back();
+        }
+
+        //////////////
+        /// Output ///
+        //////////////
+        // Whether two tokens would run together into different tokens if written with nothing between them
+        static bool wouldMerge(const PpToken& left, const PpToken& right) {
+            bool leftWord {left.kind == Kind::Identifier || left.kind == Kind::Number};
+            bool rightWord {right.kind == Kind::Identifier || right.kind == Kind::Number
+                            || right.kind == Kind::StringLiteral || right.kind == Kind::CharLiteral};
+            if (leftWord && rightWord) {
+                return true;
+            }
+            if (left.kind == Kind::Number && (right.is("+") || right.is("-") || right.is("."))) {
+                return true;
+            }
+            if (left.is(".") && right.kind == Kind::Number) {
+                return true;
+            }
+            return left.kind == Kind::Punctuator && right.kind == Kind::Punctuator;
+        }
+
+        void startEntry(const PpToken& token) {
+            m_entryStart = m_result.text.size();
+            m_entryColumn = token.column;
+            m_result.lineMap->addLine(m_entryStart, token.file, token.line, token.column);
+        }
+
+        // Writes a token to the output, on a new line whenever it comes from a different source line
+        // Tokens read straight from a file keep their columns where possible, and the line map is told wherever
+        // they do not, so errors from the lexer point at the right place in the original file
+        void emit(const PpToken& token) {
+            std::string& out {m_result.text};
+            if (token.file != m_outFile || token.line != m_outLine) {
+                if (!out.empty()) {
+                    out += '\n';
+                }
+                m_outFile = token.file;
+                m_outLine = token.line;
+                startEntry(token);
+            } else {
+                bool separate {token.spaceBefore
+                               || ((token.fromMacro || m_previous.fromMacro) && wouldMerge(m_previous, token))};
+                if (!token.fromMacro) {
+                    Src::Offset expected {m_entryStart + (token.column - m_entryColumn)};
+                    if (out.size() < expected && (separate || out.size() + 1 < expected)) {
+                        out.append(expected - out.size(), ' ');
+                    } else if (out.size() != expected || separate) {
+                        if (separate) {
+                            out += ' ';
+                        }
+                        startEntry(token);
+                    }
+                } else if (separate) {
+                    out += ' ';
+                }
+            }
+            out += token.text;
+            m_previous = token;
+        }
+
+        // Text of the built in and command line macros, read as if it were a file before the real one
+        std::string predefinedText() const {
+            std::string text {
+                "#define __STDC__ 1\n"
+                "#define __STDC_VERSION__ 201710L\n"
+                "#define __STDC_HOSTED__ 1\n"
+                "#define __DCC__ 1\n"
+                "#define __x86_64__ 1\n"
+                "#define __x86_64 1\n"
+                "#define __linux__ 1\n"
+                "#define __unix__ 1\n"
+                "#define __CHAR_BIT__ 8\n"
+                "#define __SIZEOF_INT__ 4\n"
+                "#define __SIZEOF_LONG__ 8\n"
+                "#define __SIZEOF_POINTER__ 8\n"
+                "#define __LP64__ 1\n"
+                // Used by the compiler's own stddef.h and stdint.h
+                "#define __SIZE_TYPE__ long unsigned int\n"
+                "#define __PTRDIFF_TYPE__ long int\n"
+                "#define __WCHAR_TYPE__ int\n"
+                "#define __WINT_TYPE__ unsigned int\n"
+                "#define __INT_MAX__ 0x7fffffff\n"
+                "#define __LONG_MAX__ 0x7fffffffffffffffL\n"
+                "#define __SCHAR_MAX__ 0x7f\n"
+                "#define __SHRT_MAX__ 0x7fff\n"
+                "#define __LONG_LONG_MAX__ 0x7fffffffffffffffLL\n"
+            };
+            for (const std::string& define : m_options.defines) {
+                std::size_t equals {define.find('=')};
+                text += "#define " + (equals == std::string::npos ? define + " 1"
+                                                                 : define.substr(0, equals) + " " + define.substr(equals + 1));
+                text += "\n";
+            }
+            for (const std::string& undefine : m_options.undefines) {
+                text += "#undef " + undefine + "\n";
+            }
+            return text;
+        }
+
+        void defineBuiltin(std::string_view name, Macro::Builtin builtin) {
+            Macro& macro {m_macros[macroId(name)]};
+            macro.defined = true;
+            macro.builtin = builtin;
+        }
+    public:
+        Preprocessor(const Options& options, IncludeCache& cache)
+            : m_options{options}
+            , m_cache{cache}
+        {
+            m_result.lineMap = std::make_shared<Src::LineMap>();
+        }
+
+        Result run(const std::filesystem::path& path) {
+            std::shared_ptr<const CachedFile> mainFile;
+            try {
+                mainFile = m_cache.loadMain(path);
+            } catch (const std::runtime_error& problem) {
+                m_result.errors.emplace_back(problem.what());
+                return std::move(m_result);
+            }
+            return run(std::move(mainFile));
+        }
+
+        Result run(std::shared_ptr<const CachedFile> mainFile) {
+            defineBuiltin("__FILE__", Macro::File);
+            defineBuiltin("__LINE__", Macro::Line);
+            defineBuiltin("__COUNTER__", Macro::Counter);
+
+            // The predefined macros go on top of the stack, so they are read before the main file
+            auto predefined {std::make_shared<CachedFile>()};
+            predefined->path = "<command-line>";
+            predefined->source = Src::SourceFile{predefined->path, predefinedText()};
+            predefined->tokens = tokenize(predefined->source.text(), predefined->spliced, predefined->errors);
+            enterFile(std::move(mainFile), -1);
+            enterFile(std::move(predefined), -1);
+
+            PpToken token;
+            while (next(token)) {
+                emit(token);
+            }
+            if (!m_result.text.empty()) {
+                m_result.text += '\n';
+            }
+            return std::move(m_result);
+        }
+    };
+
+    std::vector<std::filesystem::path> defaultSystemPaths() {
+        std::vector<std::filesystem::path> paths {"/usr/local/include"};
+        // The freestanding headers come with the compiler, under a directory named for its version. Use the newest
+        std::error_code error;
+        std::filesystem::path newest;
+        int newestVersion {-1};
+        for (const auto& entry : std::filesystem::directory_iterator{"/usr/lib/gcc/x86_64-linux-gnu", error}) {
+            std::string name {entry.path().filename().string()};
+            int version {};
+            if (std::from_chars(name.data(), name.data() + name.size(), version).ec == std::errc{}
+                && version > newestVersion && std::filesystem::is_directory(entry.path() / "include", error)) {
+                newest = entry.path() / "include";
+                newestVersion = version;
+            }
+        }
+        if (!newest.empty()) {
+            paths.push_back(newest);
+        }
+        paths.emplace_back("/usr/include/x86_64-linux-gnu");
+        paths.emplace_back("/usr/include");
+        return paths;
+    }
+
+    Result preprocessFile(const std::filesystem::path& path, const Options& options, IncludeCache& cache) {
+        return Preprocessor{options, cache}.run(path);
+    }
+
+    Result preprocessText(const std::filesystem::path& name, std::string text, const Options& options,
+                          IncludeCache& cache) {
+        auto file {std::make_shared<CachedFile>()};
+        file->path = name;
+        file->source = Src::SourceFile{name, std::move(text)};
+        file->tokens = tokenize(file->source.text(), file->spliced, file->errors);
+        return Preprocessor{options, cache}.run(std::move(file));
+    }
+}
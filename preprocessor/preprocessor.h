@@ -0,0 +1,59 @@
+//
+// Created by duncan on 10/15/26.
+//
+
+#ifndef DCC_PREPROCESSOR_H
+#define DCC_PREPROCESSOR_H
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "include_cache.h"
+#include "../lexer/source.h"
+
+// Built in C preprocessor, so compiling a file does not need a gcc process or a .i file on disk
+// Supports #include and #include_next with include guards and #pragma once, object and function-like #define
+// including # and ## and variadic macros, #undef, #if/#ifdef/#ifndef/#elif/#else/#endif with defined and
+// __has_include, #line and GNU line markers, #error and #warning. Other #pragmas are dropped
+namespace Pp {
+    // Where system headers are looked for, including gcc's own directory for stddef.h and stdarg.h
+    std::vector<std::filesystem::path> defaultSystemPaths();
+
+    struct Options {
+        // Searched in order for both "file" and <file>, after the including file's directory for "file"
+        std::vector<std::filesystem::path> includePaths;
+        // Searched after includePaths. Empty by default, so nothing looks at the disk unless asked to. dcc itself fills
+        // this in from defaultSystemPaths()
+        std::vector<std::filesystem::path> systemPaths;
+        // NAME or NAME=VALUE, as given to -D
+        std::vector<std::string> defines;
+        // As given to -U, applied after the defines
+        std::vector<std::string> undefines;
+    };
+
+    struct Result {
+        // The preprocessed text, one line per source line that had tokens on it
+        std::string text;
+        // Where each line of text came from, for reporting errors against the original files
+        std::shared_ptr<Src::LineMap> lineMap;
+        // Already formatted as path:line:column: error: message
+        std::vector<std::string> errors;
+        std::vector<std::string> warnings;
+
+        bool succeeded() const { return errors.empty(); }
+    };
+
+    // Preprocess path and everything it includes
+    // Files are loaded through cache, so headers shared with earlier compiles are not read again
+    // Errors are collected in the result rather than thrown, so every problem in the file is reported at once
+    Result preprocessFile(const std::filesystem::path& path, const Options& options, IncludeCache& cache);
+
+    // Preprocess text that is not in a file, such as standard input, as if it had been read from name
+    // "file" includes are looked for next to name
+    Result preprocessText(const std::filesystem::path& name, std::string text, const Options& options,
+                          IncludeCache& cache);
+}
+
+#endif //DCC_PREPROCESSOR_H
@@ -10,27 +10,30 @@
 #include <vector>
 #include <variant>
 
+#include "../helpers/symbol_table.h"
+#include "../lexer/tokens.h"
+
 namespace Tky {
      class Unop {
-          const std::string& m_unop;
+          Token::Unop m_unop;
      public:
           Unop() = delete;
-          Unop(const std::string& unop)
+          Unop(Token::Unop unop)
                : m_unop(unop)
           {}
 
-          const std::string& unop() const { return m_unop; }
+          Token::Unop unop() const { return m_unop; }
      };
 
      class Binop {
-          const std::string& m_binop;
+          Token::Binop m_binop;
      public:
           Binop() = delete;
-          Binop(const std::string& binop)
+          Binop(Token::Binop binop)
                : m_binop(binop)
           {}
 
-          const std::string& binop() const { return m_binop; }
+          Token::Binop binop() const { return m_binop; }
      };
 
      /////////////
@@ -38,14 +41,14 @@ namespace Tky {
      /////////////
      // Represents a variable value
      class VariableValue {
-          const std::string m_variable;
+          const Sym::SymbolId m_variable;
      public:
           VariableValue() = delete;
-          VariableValue(const std::string& variable)
+          VariableValue(Sym::SymbolId variable)
                : m_variable(variable)
           {}
 
-          const std::string& variable() const { return m_variable; }
+          Sym::SymbolId variable() const { return m_variable; }
      };
 
      // represents a const value
@@ -134,15 +137,15 @@ namespace Tky {
      // Root node of functions
      // Contains an identifier, and a list of instructions
      class Function {
-          const std::string m_identifier;
+          const Sym::SymbolId m_identifier;
           std::vector<std::unique_ptr<Instruction>> m_instructions;
      public:
           Function() = delete;
-          Function(const std::string& identifier, std::vector<std::unique_ptr<Instruction>>&& instructions)
+          Function(Sym::SymbolId identifier, std::vector<std::unique_ptr<Instruction>>&& instructions)
                : m_identifier(identifier)
                , m_instructions(std::move(instructions))
           {}
-          const std::string& identifier() const { return m_identifier; }
+          Sym::SymbolId identifier() const { return m_identifier; }
           const std::vector<std::unique_ptr<Instruction>>& instructions() const { return m_instructions; }
      };
 
@@ -150,16 +153,16 @@ namespace Tky {
      /// Program ///
      ///////////////
      // Root node of the tacky tree
-     // Contains a function
+     // Contains the functions in source order
      class Program {
-          std::unique_ptr<Function> m_function;
+          std::vector<std::unique_ptr<Function>> m_functions;
      public:
           Program() = delete;
-          explicit Program(std::unique_ptr<Function>&& function)
-               : m_function(std::move(function))
+          explicit Program(std::vector<std::unique_ptr<Function>>&& functions)
+               : m_functions(std::move(functions))
           {}
 
-          const Function& function() const { return *m_function; }
+          const std::vector<std::unique_ptr<Function>>& functions() const { return m_functions; }
 
 
      };
@@ -10,9 +10,9 @@
 namespace TkyGen {
     using InstructionList = std::vector<std::unique_ptr<Tky::Instruction>>;
 
-    std::string createTempName() {
-        static int counter {0};
-        return "tmp." + std::to_string(++counter);
+    // Temporaries are interned like any other name, but are guaranteed not to clash with source identifiers
+    Sym::SymbolId createTempName(Sym::SymbolTable& symbols) {
+        return symbols.createTemporary("tmp");
     }
 
     Tky::Binop parseBinop(Ast::BinaryOperator& binop) {
@@ -23,7 +23,7 @@ namespace TkyGen {
         return Tky::Unop {unop.unop()};
     }
 
-    Tky::ConstantValue parseConstantValue(Ast::IntConstant& constant) {
+    Tky::ConstantValue parseConstantValue(const Ast::IntConstant& constant) {
         return Tky::ConstantValue {constant.value()};
     }
 
@@ -32,58 +32,116 @@ namespace TkyGen {
         return Tky::ReturnInstruction{returnValue};
     }
 
-    // Recursively parse an instruction list
-    // Uses recursion to descend until a constant is encountered, then constructs a list of
+    // Parse an instruction list, descending until a constant is encountered, then constructing a list of
     // instructions that spell out each modification performed on the constant
-    Tky::Value parseInstructionList(Ast::ExpressionPtr& e, InstructionList& list) {
-        return std::visit(Ol::overloaded{
-            [&list](std::unique_ptr<Ast::ConstantExpression>& exp) -> Tky::Value {
-                return parseConstantValue(exp->constant());
-            },
-            [&list](std::unique_ptr<Ast::UnopExpression>& exp) ->Tky::Value {
-                Tky::Unop unop {parseUnop(exp->unop())};
-                Tky::Value src {parseInstructionList(exp->expression(), list)};
-                Tky::Value dst {createTempName()};
-                Tky::UnaryInstruction tmp {unop, src, dst};
+    // Walks with a stack on the heap rather than recursing, so the depth of the expression does not matter
+    Tky::Value parseInstructionList(Ast::ExpressionPtr& e, InstructionList& list, Ctx::CompilationContext& context) {
+        // Each expression is on the stack twice, once to queue its operands and once to lower it after they are done
+        struct Pending {
+            Ast::ExpressionPtr expression;
+            bool operandsDone;
+        };
+        std::vector<Pending> pending {{e, false}};
+        // Values of finished operands whose parent has not been lowered yet
+        std::vector<Tky::Value> values;
+
+        while (!pending.empty()) {
+            auto [current, operandsDone] {pending.back()};
+            pending.pop_back();
+            std::visit(Ol::overloaded{
+                [&values](Ast::ConstantExpression* exp) {
+                    values.emplace_back(parseConstantValue(exp->constant()));
+                },
+                [&](Ast::UnopExpression* exp) {
+                    if (!operandsDone) {
+                        pending.push_back({current, true});
+                        pending.push_back({exp->expression(), false});
+                        return;
+                    }
+                    Tky::Unop unop {parseUnop(exp->unop())};
+                    Tky::Value src {values.back()};
+                    values.pop_back();
+                    Tky::Value dst {Tky::VariableValue{createTempName(context.symbols())}};
+                    Tky::UnaryInstruction tmp {unop, src, dst};
+                    list.emplace_back(std::make_unique<Tky::Instruction>(tmp));
+                    values.push_back(dst);
+                },
+                [&](Ast::BinopExpression* exp) {
+                    if (!operandsDone) {
+                        // Pushed right first, so the left operand is lowered first
+                        pending.push_back({current, true});
+                        pending.push_back({exp->rightExpression(), false});
+                        pending.push_back({exp->leftExpression(), false});
+                        return;
+                    }
+                    Tky::Binop binop {parseBinop(exp->binop())};
+                    Tky::Value src2 {values.back()};
+                    values.pop_back();
+                    Tky::Value src1 {values.back()};
+                    values.pop_back();
+                    Tky::Value dst {Tky::VariableValue{createTempName(context.symbols())}};
+                    Tky::BinaryInstruction tmp {binop, src1, src2, dst};
+                    list.emplace_back(std::make_unique<Tky::Instruction>(tmp));
+                    values.push_back(dst);
+                }
+            }, current);
+        }
+        return values.back();
+    }
+
+    Tky::Value parseInstructionList(const FlatAst::Expression& expression, InstructionList& list,
+                                    Ctx::CompilationContext& context) {
+        // The value each node came to, by node index
+        std::vector<Tky::Value> values;
+        values.reserve(expression.size());
+        for (const FlatAst::Node& node : expression.nodes()) {
+            if (node.kind == FlatAst::NodeKind::Constant) {
+                values.emplace_back(Tky::ConstantValue{node.constant()});
+                continue;
+            }
+            Tky::Value dst {Tky::VariableValue{createTempName(context.symbols())}};
+            if (node.kind == FlatAst::NodeKind::Unop) {
+                Tky::Unop unop {node.unop()};
+                Tky::UnaryInstruction tmp {unop, values[node.first], dst};
                 list.emplace_back(std::make_unique<Tky::Instruction>(tmp));
-                return dst;
-            },
-            [&list](std::unique_ptr<Ast::BinopExpression>& exp) -> Tky::Value {
-                Tky::Binop binop {parseBinop(exp->binop())};
-                Tky::Value src1 {parseInstructionList(exp->leftExpression(), list)};
-                Tky::Value src2 {parseInstructionList(exp->rightExpression(), list)};
-                Tky::Value dst {createTempName()};
-                Tky::BinaryInstruction tmp {binop, src1, src2, dst};
+            } else {
+                Tky::Binop binop {node.binop()};
+                Tky::BinaryInstruction tmp {binop, values[node.first], values[node.second], dst};
                 list.emplace_back(std::make_unique<Tky::Instruction>(tmp));
-                return dst;
             }
-        }, e);
+            values.push_back(dst);
+        }
+        return values.back();
     }
 
     // Helper function to handle content in the Ast::Statement node
     // Directs to the parseInstructionList function
-    InstructionList preParseInstructionList(Ast::Statement& statement) {
+    InstructionList preParseInstructionList(Ast::Statement& statement, Ctx::CompilationContext& context) {
         Ast::NodeType type {std::visit(Ast::GetStatementType{}, statement)};
         InstructionList instructions;
         if (type == Ast::KeywordStatementT) {
-            const std::string& keyword {std::get<Ast::KeywordStatement>(statement).keyword()};
-            if (keyword == Token::returnString) {
+            Token::Kind keyword {std::get<Ast::KeywordStatement>(statement).keyword()};
+            if (keyword == Token::ReturnT) {
                 Ast::ExpressionPtr& expression {std::get<Ast::KeywordStatement>(statement).expression()};
-                Tky::Value returnVal = parseInstructionList(expression, instructions);
+                Tky::Value returnVal = parseInstructionList(expression, instructions, context);
                 instructions.push_back(std::make_unique<Tky::Instruction>(parseReturnInstruction(returnVal)));
             }
         }
         return instructions;
     }
 
-    std::unique_ptr<Tky::Function> parseFunction(const Ast::Function& function) {
-        const std::string& identifier {function.identifier().name()};
-        std::vector<std::unique_ptr<Tky::Instruction>> instructions {preParseInstructionList(function.statement())};
+    std::unique_ptr<Tky::Function> parseFunction(const Ast::Function& function, Ctx::CompilationContext& context) {
+        Sym::SymbolId identifier {function.identifier().name()};
+        std::vector<std::unique_ptr<Tky::Instruction>> instructions {preParseInstructionList(function.statement(), context)};
         return std::make_unique<Tky::Function>(identifier, std::move(instructions));
     }
 
-    Tky::Program parseProgram(Ast::Program& program) {
-        Tky::Program tmp {parseFunction(program.function())};
-        return tmp;
+    Tky::Program parseProgram(Ast::Program& program, Ctx::CompilationContext& context) {
+        std::vector<std::unique_ptr<Tky::Function>> functions;
+        functions.reserve(program.functions().size());
+        for (const Ast::Function* function : program.functions()) {
+            functions.push_back(parseFunction(*function, context));
+        }
+        return Tky::Program{std::move(functions)};
     }
 }
\ No newline at end of file
@@ -6,29 +6,38 @@
 #define DCC_TACKY_GENERATOR_H
 #include "tacky.h"
 #include "../parser/ast.h"
+#include "../parser/flat_ast.h"
+#include "../helpers/compilation_context.h"
 
 namespace TkyGen {
     using InstructionList = std::vector<std::unique_ptr<Tky::Instruction>>;
 
-    std::string createTempName();
+    // Temporaries are interned like any other name, but are guaranteed not to clash with source identifiers
+    Sym::SymbolId createTempName(Sym::SymbolTable& symbols);
 
     Tky::Unop parseUnop(Ast::UnaryOperator& unop);
 
-    Tky::ConstantValue parseConstantValue(Ast::IntConstant& constant);
+    Tky::ConstantValue parseConstantValue(const Ast::IntConstant& constant);
 
     Tky::ReturnInstruction parseReturnInstruction(Tky::Value& value);
 
-    // Recursively parse an instruction list
-    // Uses recursion to descend until a constant is encountered, then constructs a list of
+    // Parse an instruction list, descending until a constant is encountered, then constructing a list of
     // instructions that spell out each modification performed on the constant
-    Tky::Value parseInstructionList(Ast::ExpressionPtr& e, InstructionList& list);
+    // Keeps its own stack on the heap, so deeply nested expressions do not overflow the thread's stack
+    Tky::Value parseInstructionList(Ast::ExpressionPtr& e, InstructionList& list, Ctx::CompilationContext& context);
+
+    // The same for a flat expression, in one pass over its nodes
+    // Nodes are in post-order, so each one's operands already have values by the time it is reached, and temporaries
+    // are made in the same order as the tree version makes them
+    Tky::Value parseInstructionList(const FlatAst::Expression& expression, InstructionList& list,
+                                    Ctx::CompilationContext& context);
 
     // Helper function to handle content in the Ast::Statement node
     // Directs to the parseInstructionList function
-    InstructionList preParseInstructionList(Ast::Statement& statement);
+    InstructionList preParseInstructionList(Ast::Statement& statement, Ctx::CompilationContext& context);
 
-    std::unique_ptr<Tky::Function> parseFunction(const Ast::Function& function);
+    std::unique_ptr<Tky::Function> parseFunction(const Ast::Function& function, Ctx::CompilationContext& context);
 
-    Tky::Program parseProgram(Ast::Program& program);
+    Tky::Program parseProgram(Ast::Program& program, Ctx::CompilationContext& context);
 }
 #endif //DCC_TACKY_GENERATOR_H
\ No newline at end of file